@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include "BenchmarkTools.h"
+
+namespace {
+	std::atomic<uint64_t> allocations(0);
+
+	// jsonString: const std::string& -> std::string
+	// Returns the string quoted for a JSON file.
+	std::string jsonString(const std::string& s) {
+		std::string quoted = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\')
+				quoted += '\\';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+}
+
+// The replacements of the global allocation functions. The array and the non-throwing
+// forms of operator new call this one, so every allocation is counted here:
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+volatile uint64_t benchmarkSink = 0;
+
+uint64_t allocationCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+Benchmark::Benchmark(int minTimeMs, const std::string& _filter) : filter(_filter) {
+	minTime = minTimeMs / 1000.0;
+}
+
+// printResults: void -> void
+// Prints the results as a table, one operation and position per line.
+void Benchmark::printResults() const {
+	std::printf("%-36s %-12s %14s %12s %14s\n", "Operation", "Position", "ns/op", "allocs/op", "ops");
+	for (const BenchmarkResult& r : results)
+		std::printf("%-36s %-12s %14.1f %12.2f %14llu\n", r.name.c_str(), r.position.c_str(), r.nsPerOp, r.allocsPerOp,
+					(unsigned long long)r.ops);
+}
+
+// writeJSON: file name, error message -> bool
+// Writes the results into the file as a JSON object, for comparing the runs of two builds:
+// {"benchmarks": [{"name": ..., "position": ..., "ns_per_op": ..., "allocs_per_op": ..., "ops": ...}, ...]}
+// Returns false, with the reason in errorMsg, if the file cannot be written.
+bool Benchmark::writeJSON(const std::string& fileName, std::string& errorMsg) const {
+	std::ofstream out(fileName, std::ios::trunc);
+	if (!out.is_open()) {
+		errorMsg = "BENCHMARK ERROR: could not open the file " + fileName;
+		return false;
+	}
+
+	out << "{\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		char numbers[128];
+		std::snprintf(numbers, sizeof(numbers), "\"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, \"ops\": %llu",
+					  r.nsPerOp, r.allocsPerOp, (unsigned long long)r.ops);
+		out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << jsonString(r.name) << ", \"position\": "
+			<< jsonString(r.position) << ", " << numbers << "}";
+	}
+	out << "\n  ]\n}\n";
+
+	out.close();
+	if (out.fail()) {
+		errorMsg = "BENCHMARK ERROR: could not write the file " + fileName;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The measuring shared by the benchmark programs of this directory. The programs are
+// built from their own source file, BenchmarkTools.cpp and the sources of the game
+// (sources/*.cpp) except CLIChess.cpp, which has the main function of the game:
+//
+//   g++ -std=c++17 -O2 -Isources benchmarks/RulesBenchmark.cpp benchmarks/BenchmarkTools.cpp <sources> -o rulesbench
+//
+// BenchmarkTools.cpp replaces the global operator new, so that the allocations made by
+// the measured operations are counted along with their time.
+
+// allocationCount: void -> uint64_t
+// Returns the number of allocations made by the program so far.
+uint64_t allocationCount();
+
+// benchmarkSink keeps the results of the measured operations alive, so that the compiler
+// cannot leave out an operation whose result is not otherwise used:
+extern volatile uint64_t benchmarkSink;
+
+// BenchmarkResult is the measurement of one operation in one position:
+struct BenchmarkResult {
+	std::string name;
+	std::string position;
+	uint64_t ops;				// The operations made during the measurement.
+	double nsPerOp;
+	double allocsPerOp;
+};
+
+// Benchmark:
+// Measures operations and collects their results. An operation is repeated, doubling the
+// number of repetitions, until the repetitions take at least the minimum time, and the
+// last round gives the time and the allocations per operation.
+class Benchmark
+{
+private:
+	double minTime;				// Seconds.
+	std::string filter;
+	std::vector<BenchmarkResult> results;
+
+public:
+	Benchmark(int minTimeMs, const std::string& filter);
+
+	// run: name, position, operations per call, op -> void
+	// Measures op, which makes opsPerCall operations each time it is called. Operations
+	// whose name does not contain the filter are skipped.
+	template <class Op>
+	void run(const std::string& name, const std::string& position, uint64_t opsPerCall, Op op) {
+		if (opsPerCall == 0 || name.find(filter) == std::string::npos)
+			return;
+
+		op();			// Warms up the caches and the allocator.
+		for (uint64_t calls = 1; ; calls *= 2) {
+			uint64_t allocations = allocationCount();
+			auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < calls; i++)
+				op();
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			allocations = allocationCount() - allocations;
+
+			if (elapsed >= minTime) {
+				uint64_t ops = calls * opsPerCall;
+				results.push_back(BenchmarkResult{ name, position, ops, elapsed * 1e9 / ops, double(allocations) / ops });
+				return;
+			}
+		}
+	}
+
+	const std::vector<BenchmarkResult>& getResults() const { return results; }
+	void printResults() const;
+	bool writeJSON(const std::string& fileName, std::string& errorMsg) const;
+};
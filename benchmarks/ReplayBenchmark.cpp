@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include "BenchmarkTools.h"
+#include "GameManager.h"
+#include "MoveGen.h"
+#include "Notation.h"
+#include "Position.h"
+
+// ReplayBenchmark measures GameManager::load, save and takeBack on a corpus of random
+// legal games of fixed lengths. Loading and taking back replay the game from its start,
+// so their cost grows with the length of the game: the cost per ply is reported for
+// every length, and it stays level as long as the replay is linear in the length.
+//
+// Usage: replaybench [-games n] [-seed n] [-dir directory] [-time ms] [-json file]
+//   -games  the games of each length (20)
+//   -seed   the seed of the random games; the same seed gives the same corpus (1)
+//   -dir    the directory the corpus is written into (replaybench_games)
+//   -time   the minimum time each operation is measured for (200 ms)
+//   -json   writes the results into the file
+
+namespace {
+	// The lengths of the games of the corpus, in plies:
+	const int gameLengths[] = { 16, 32, 64, 128, 256 };
+
+	// The attempts made for every game of the corpus before giving up on a length:
+	const int maxAttempts = 1000;
+
+	// CorpusCounts are the special moves in the corpus, which the rules handle apart:
+	struct CorpusCounts {
+		int castlings;
+		int enPassants;
+		int promotions;
+	};
+
+	// randomGame: rng, plies, moves, CorpusCounts& -> bool
+	// Plays a random game of the given length, both in the engine's position and in the
+	// GameManager, so that every move is legal by the rules of both. Castling, en passant
+	// and promotions are preferred when there are any, and captures avoided, so that the
+	// games last. Returns false if the game ends before its length.
+	bool randomGame(std::mt19937_64& rng, int plies, std::vector<std::string>& moves, CorpusCounts& counts) {
+		Position pos;
+		pos.setFromFEN(Position::startFEN);
+		GameManager game;
+		CorpusCounts gameCounts = CorpusCounts();
+		std::vector<Move> choices;
+		moves.clear();
+
+		while (int(moves.size()) < plies) {
+			if (game.isCheckmate() || game.isStalemate())
+				return false;
+
+			// Every move is put into the choices as many times as it is weighted:
+			choices.clear();
+			for (const ScoredMove& sm : MoveList(pos)) {
+				int weight = moveKind(sm.move) != NormalMove ? 16 : pos.isCapture(sm.move) ? 1 : 3;
+				choices.insert(choices.end(), weight, sm.move);
+			}
+			if (choices.empty())
+				return false;
+
+			Move m = choices[rng() % choices.size()];
+			std::string san = moveToSAN(pos, m);
+			if (!game.makeMove(san))
+				return false;
+
+			gameCounts.castlings += moveKind(m) == CastlingMove;
+			gameCounts.enPassants += moveKind(m) == EnPassantMove;
+			gameCounts.promotions += moveKind(m) == PromotionMove;
+			pos.makeMove(m);
+			moves.push_back(san);
+		}
+
+		counts.castlings += gameCounts.castlings;
+		counts.enPassants += gameCounts.enPassants;
+		counts.promotions += gameCounts.promotions;
+		return true;
+	}
+
+	// writeCorpus: directory, games per length, seed, files, CorpusCounts&, error message -> bool
+	// Writes the random games into the directory in the .clc format, one move per line,
+	// collecting the file names of each length. Returns false, with the reason in errorMsg,
+	// if the games cannot be written or played.
+	bool writeCorpus(const std::string& directory, int gamesPerLength, uint64_t seed,
+					 std::vector<std::vector<std::string>>& files, CorpusCounts& counts, std::string& errorMsg) {
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+		if (ec) {
+			errorMsg = "BENCHMARK ERROR: could not create the directory " + directory;
+			return false;
+		}
+
+		std::mt19937_64 rng(seed);
+		std::vector<std::string> moves;
+		files.clear();
+
+		for (int plies : gameLengths) {
+			files.push_back(std::vector<std::string>());
+			for (int g = 0; g < gamesPerLength; g++) {
+				int attempts = 0;
+				while (!randomGame(rng, plies, moves, counts))
+					if (++attempts == maxAttempts) {
+						errorMsg = "BENCHMARK ERROR: could not play a game of " + std::to_string(plies) + " plies";
+						return false;
+					}
+
+				char name[64];
+				std::snprintf(name, sizeof(name), "game%03d_%03d.clc", plies, g + 1);
+				std::string file = (std::filesystem::path(directory) / name).string();
+				std::ofstream out(file, std::ios::trunc);
+				for (const std::string& move : moves)
+					out << move << std::endl;
+				out.close();
+				if (out.fail()) {
+					errorMsg = "BENCHMARK ERROR: could not write the file " + file;
+					return false;
+				}
+				files.back().push_back(file);
+			}
+		}
+		return true;
+	}
+
+	// printRates: results -> void
+	// Prints the results, those of each operation together from the shortest games to the
+	// longest, as games and plies per second and as the cost per ply, and how much the cost
+	// per ply of each operation grows from the shortest games to the longest.
+	void printRates(const std::vector<BenchmarkResult>& results) {
+		std::printf("%-24s %8s %12s %12s %10s %11s\n", "Operation", "Plies", "games/s", "plies/s", "us/ply", "allocs/ply");
+
+		const BenchmarkResult* first = nullptr;
+		for (size_t i = 0; i < results.size(); i++) {
+			const BenchmarkResult& r = results[i];
+			int plies = std::stoi(r.position);
+			double pliesPerSecond = 1e9 / r.nsPerOp;
+			std::printf("%-24s %8d %12.1f %12.0f %10.3f %11.2f\n", r.name.c_str(), plies, pliesPerSecond / plies,
+						pliesPerSecond, r.nsPerOp / 1000, r.allocsPerOp);
+
+			if (!first || first->name != r.name)
+				first = &r;
+			bool last = i + 1 == results.size() || results[i + 1].name != r.name;
+			if (last && first != &r)
+				std::printf("%-24s %s -> %s plies: cost per ply x%.2f\n", "", first->position.c_str(), r.position.c_str(),
+							r.nsPerOp / first->nsPerOp);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const std::string usage = "Usage: replaybench [-games n] [-seed n] [-dir directory] [-time ms] [-json file]";
+	int gamesPerLength = 20;
+	uint64_t seed = 1;
+	std::string directory = "replaybench_games";
+	int minTimeMs = 200;
+	std::string jsonFile;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-games" && hasValue)
+				gamesPerLength = std::stoi(argv[++i]);
+			else if (arg == "-seed" && hasValue)
+				seed = std::stoull(argv[++i]);
+			else if (arg == "-dir" && hasValue)
+				directory = argv[++i];
+			else if (arg == "-time" && hasValue)
+				minTimeMs = std::stoi(argv[++i]);
+			else if (arg == "-json" && hasValue)
+				jsonFile = argv[++i];
+			else {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	if (gamesPerLength <= 0) {
+		std::cout << usage << std::endl;
+		return 1;
+	}
+
+	std::vector<std::vector<std::string>> files;
+	CorpusCounts counts = CorpusCounts();
+	std::string errorMsg;
+	if (!writeCorpus(directory, gamesPerLength, seed, files, counts, errorMsg)) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+	std::cout << "Corpus of " << gamesPerLength * files.size() << " games in " << directory << ": " << counts.castlings
+			  << " castlings, " << counts.enPassants << " en passant captures, " << counts.promotions << " promotions" << std::endl;
+
+	Benchmark bench(minTimeMs, "");
+	std::string saveFile = (std::filesystem::path(directory) / "save.tmp").string();
+
+	for (size_t l = 0; l < files.size(); l++) {
+		std::string plies = std::to_string(gameLengths[l]);
+		uint64_t totalPlies = uint64_t(gameLengths[l]) * files[l].size();
+
+		// The games of the length loaded, for saving and taking back, with their last moves:
+		std::vector<GameManager> games(files[l].size());
+		std::vector<std::string> lastMoves;
+		for (size_t g = 0; g < games.size(); g++) {
+			std::vector<std::string> moves;
+			std::ifstream in(files[l][g]);
+			for (std::string move; std::getline(in, move) && !move.empty(); )
+				moves.push_back(move);
+			if (!games[g].load(files[l][g])) {
+				std::cout << "BENCHMARK ERROR: could not load " << files[l][g] << ": " << games[g].getMsg() << std::endl;
+				return 1;
+			}
+			lastMoves.push_back(moves.back());
+		}
+
+		GameManager loader;
+		bench.run("GameManager::load", plies, totalPlies, [&] {
+			uint64_t n = 0;
+			for (const std::string& file : files[l])
+				n += loader.load(file);
+			benchmarkSink = n;
+		});
+
+		bench.run("GameManager::save", plies, totalPlies, [&] {
+			uint64_t n = 0;
+			for (GameManager& game : games)
+				n += game.save(saveFile);
+			benchmarkSink = n;
+		});
+
+		// Taking back the last move replays the rest of the game; the move is made again
+		// to have the whole game for the next round:
+		bench.run("GameManager::takeBack", plies, totalPlies, [&] {
+			uint64_t n = 0;
+			for (size_t g = 0; g < games.size(); g++) {
+				n += games[g].takeBack(1);
+				n += games[g].makeMove(lastMoves[g]);
+			}
+			benchmarkSink = n;
+		});
+	}
+	std::filesystem::remove(saveFile);
+
+	// The results of each operation together, from the shortest games to the longest:
+	std::vector<BenchmarkResult> results = bench.getResults();
+	std::stable_sort(results.begin(), results.end(), [](const BenchmarkResult& a, const BenchmarkResult& b) { return a.name < b.name; });
+	printRates(results);
+
+	if (!jsonFile.empty() && !bench.writeJSON(jsonFile, errorMsg)) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+	return 0;
+}
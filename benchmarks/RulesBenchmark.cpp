@@ -0,0 +1,282 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "BenchmarkTools.h"
+#include "GameManager.h"
+
+// RulesBenchmark measures the primitives the rules of the game are built on, from the
+// board queries up to GameManager::makeMove, in a fixed set of positions. It prints the
+// time and the allocations per operation, and writes them into a JSON file on request,
+// so that two builds can be compared operation by operation.
+//
+// Usage: rulesbench [-time ms] [-filter text] [-json file]
+//   -time    the minimum time each operation is measured for (200 ms)
+//   -filter  measures only the operations whose name contains the text
+//   -json    writes the results into the file
+
+namespace {
+	// BenchmarkLine is a game line played from the initial position to a benchmark position:
+	struct BenchmarkLine {
+		const char* name;
+		const char* moves;
+	};
+
+	// The positions, from the opening to the endgame. Changing them changes the results.
+	const BenchmarkLine benchmarkLines[] = {
+		{ "start", "" },
+		{ "opening", "e4 e5 Nf3 Nc6 Bb5 a6 Ba4 Nf6 O-O Be7 Re1 b5 Bb3 d6" },
+		{ "middlegame", "d4 Nf6 c4 g6 Nc3 Bg7 e4 d6 f3 O-O Nge2 c5 Be3 Nbd7 Qd2 a6 O-O-O Qa5 Kb1 b5 Nd5 Nxd5" },
+		{ "endgame", "c3 b6 d3 c6 a3 b5 Nf3 Nh6 Ra2 b4 cxb4 Nf5 Nc3 Bb7 e4 Nd6 Be2 a5 bxa5 Qxa5 O-O c5 e5 Nf5 "
+					 "Qb3 Bxf3 Bxf3 Nd4 Qd5 Nxf3+ Qxf3 Nc6 Bf4 Nd4 Qe4 e6 Be3 Nf5 Nd5 Nxe3 Nxe3 d5 Qf3 Be7 a4 Qc7 "
+					 "Qg3 O-O Rd1 f6 Ng4 fxe5 Qxe5 Qxe5 Nxe5 Bd6 Nf3 Ra5 d4 cxd4 Rxd4 e5 b4 exd4 bxa5 Rb8 Ra1 d3 "
+					 "a6 Ra8 Rd1 Rxa6 Rxd3 Rxa4 Rd1 Bc5 Rc1 Rc4 Rd1 d4 h3 h5 h4 Bb6 Rb1 Rc6 Ne5 Re6 Re1 Bc7 f4 d3" }
+	};
+
+	// The moves the parser is measured with, in all the forms it reads:
+	const char* parserMoves[] = { "e4", "exd5", "Nf3", "Nbd7", "R1e2", "Qxe7+", "Bxf7#", "O-O", "O-O-O", "e8=Q", "exd6e.p." };
+
+	// The piece types, with the names of their classes:
+	const std::pair<MoveId, const char*> pieceTypes[] = {
+		{ MoveId::P, "Pawn" }, { MoveId::N, "Knight" }, { MoveId::B, "Bishop" },
+		{ MoveId::R, "Rook" }, { MoveId::Q, "Queen" }, { MoveId::K, "King" }
+	};
+
+	// splitMoves: const char* -> std::vector<std::string>
+	std::vector<std::string> splitMoves(const char* line) {
+		std::istringstream in(line);
+		std::vector<std::string> moves;
+		std::string move;
+		while (in >> move)
+			moves.push_back(move);
+		return moves;
+	}
+
+	// playLine: GameManager&, moves -> bool
+	// Plays the moves from the initial position. Returns false if a move cannot be made.
+	bool playLine(GameManager& game, const std::vector<std::string>& moves) {
+		game.restart();
+		for (const std::string& move : moves)
+			if (!game.makeMove(move))
+				return false;
+		return true;
+	}
+}
+
+// RulesBenchmark:
+// Is a friend of GameManager, so that the private rules primitives can be measured
+// directly on the game's own board and players.
+struct RulesBenchmark {
+	// runPosition: Benchmark&, GameManager&, position name -> void
+	// Measures the primitives in the current position of the game. Every operation
+	// leaves the position as it found it.
+	static void runPosition(Benchmark& bench, GameManager& game, const std::string& position) {
+		const Board& board = game.board;
+		Player* player = game.inTurn;
+		Player* opponent = game.getOpponent(player);
+		int oppDir = game.getOpponentDirection(player);
+
+		std::vector<SquareCoords> squares;
+		for (int file = 0; file < fileLim; file++)
+			for (int rank = 0; rank < rankLim; rank++)
+				squares.push_back(SquareCoords(file, rank));
+
+		// 1. The board queries, over every square:
+		bench.run("Board::hasPiece", position, squares.size(), [&] {
+			uint64_t n = 0;
+			for (const SquareCoords& sq : squares)
+				n += board.hasPiece(sq);
+			benchmarkSink = n;
+		});
+
+		bench.run("Board::getPiece", position, squares.size(), [&] {
+			uint64_t n = 0;
+			for (const SquareCoords& sq : squares)
+				n += board.getPiece(sq) != nullptr;
+			benchmarkSink = n;
+		});
+
+		// 2. The threats of each type of piece of both players, against every square:
+		for (const auto& type : pieceTypes) {
+			std::vector<std::pair<std::shared_ptr<Piece>, int>> pieces;
+			for (Player* owner : { player, opponent })
+				for (std::shared_ptr<Piece> p : *owner)
+					if (p->getType() == type.first)
+						pieces.push_back(std::make_pair(p, game.getOpponentDirection(owner)));
+
+			bench.run(std::string(type.second) + "::threatensSquare", position, pieces.size() * squares.size(), [&] {
+				uint64_t n = 0;
+				for (const auto& p : pieces)
+					for (const SquareCoords& sq : squares)
+						n += p.first->threatensSquare(sq, p.second, board);
+				benchmarkSink = n;
+			});
+		}
+
+		// 3. The squares reachable by the pieces of the player in turn:
+		std::vector<std::shared_ptr<Piece>> pieces(player->begin(), player->end());
+		std::vector<SquareCoords> reachable;
+		bench.run("Piece::reachableSquares", position, pieces.size(), [&] {
+			uint64_t n = 0;
+			for (const std::shared_ptr<Piece>& p : pieces) {
+				reachable.clear();
+				p->reachableSquares(reachable, oppDir, board);
+				n += reachable.size();
+			}
+			benchmarkSink = n;
+		});
+
+		bench.run("Piece::visitReachableSquares", position, pieces.size(), [&] {
+			uint64_t n = 0;
+			for (const std::shared_ptr<Piece>& p : pieces)
+				p->visitReachableSquares([&](const SquareCoords&) { n++; return false; }, oppDir, board);
+			benchmarkSink = n;
+		});
+
+		// 4. The threats of both players against every square:
+		bench.run("GameManager::threatensSquare", position, 2 * squares.size(), [&] {
+			uint64_t n = 0;
+			for (Player* owner : { player, opponent })
+				for (const SquareCoords& sq : squares)
+					n += game.threatensSquare(sq, owner);
+			benchmarkSink = n;
+		});
+
+		// 5. The validation of every move the player in turn can reach, set up as canMove does:
+		std::vector<MoveAnalysisResults> candidates;
+		for (const std::shared_ptr<Piece>& p : pieces) {
+			SquareCoords src = p->getCoords();
+			p->visitReachableSquares([&](const SquareCoords& sq) {
+				MoveAnalysisResults res;
+				res.movedP = p->getType();
+				res.src = src;
+				res.dest = sq;
+				res.captureCoords = sq;
+				res.opponentDir = oppDir;
+				if (res.movedP == MoveId::P && !sq.sameFile(src)) {
+					res.capt = true;
+					if (!board.hasPiece(sq)) {
+						res.enPassantMove = true;
+						res.captureCoords.setCoords(sq.file(), src.rank());
+					}
+				}
+				else
+					res.capt = board.hasPiece(sq);
+				candidates.push_back(res);
+				return false;
+			}, oppDir, board);
+		}
+
+		bench.run("GameManager::validateMove", position, candidates.size(), [&] {
+			uint64_t n = 0;
+			for (const MoveAnalysisResults& res : candidates)
+				n += game.validateMove(res, player);
+			benchmarkSink = n;
+		});
+
+		bench.run("GameManager::canMove", position, 1, [&] {
+			benchmarkSink = game.canMove(player);
+		});
+	}
+
+	// runParser: Benchmark& -> void
+	// Measures the move parser, which does not depend on the position.
+	static void runParser(Benchmark& bench) {
+		MoveParser parser;
+		std::vector<std::string> moves(std::begin(parserMoves), std::end(parserMoves));
+
+		bench.run("MoveParser::parseNewMove", "-", moves.size(), [&] {
+			uint64_t n = 0;
+			for (const std::string& move : moves) {
+				MoveAnalysisResults results;
+				results.move = move;
+				parser.parseNewMove(results);
+				n += int(results.movedP);
+			}
+			benchmarkSink = n;
+		});
+
+		// The notation of a capture that checks, of an en passant capture and of a promotion:
+		MoveAnalysisResults check, enPassant, promotion;
+		check.checkMove = true;
+		enPassant.enPassantMove = true;
+		promotion.promotionMove = true;
+		promotion.promotionPiece = "Q";
+		std::vector<std::pair<MoveAnalysisResults*, std::string>> notations = {
+			{ &check, "Qxe7" }, { &enPassant, "exd6" }, { &promotion, "e8" }
+		};
+
+		bench.run("MoveParser::addSpecialNotation", "-", notations.size(), [&] {
+			uint64_t n = 0;
+			for (auto& notation : notations) {
+				notation.first->move = notation.second;
+				parser.addSpecialNotation(*notation.first);
+				n += notation.first->move.size();
+			}
+			benchmarkSink = n;
+		});
+	}
+
+	// runMakeMove: Benchmark&, GameManager&, const BenchmarkLine&, moves -> void
+	// Measures the moves of the line made one after the other from the initial position,
+	// the restarts between the rounds included; GameManager::restart is measured separately.
+	static void runMakeMove(Benchmark& bench, GameManager& game, const BenchmarkLine& line, const std::vector<std::string>& moves) {
+		bench.run("GameManager::makeMove", line.name, moves.size(), [&] {
+			benchmarkSink = playLine(game, moves);
+		});
+	}
+};
+
+int main(int argc, char* argv[]) {
+	const std::string usage = "Usage: rulesbench [-time ms] [-filter text] [-json file]";
+	int minTimeMs = 200;
+	std::string filter;
+	std::string jsonFile;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-time" && hasValue)
+				minTimeMs = std::stoi(argv[++i]);
+			else if (arg == "-filter" && hasValue)
+				filter = argv[++i];
+			else if (arg == "-json" && hasValue)
+				jsonFile = argv[++i];
+			else {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	Benchmark bench(minTimeMs, filter);
+	GameManager game;
+
+	for (const BenchmarkLine& line : benchmarkLines) {
+		std::vector<std::string> moves = splitMoves(line.moves);
+		if (!playLine(game, moves)) {
+			std::cout << "BENCHMARK ERROR: the " << line.name << " line could not be played: " << game.getMsg() << std::endl;
+			return 1;
+		}
+
+		RulesBenchmark::runPosition(bench, game, line.name);
+		RulesBenchmark::runMakeMove(bench, game, line, moves);
+	}
+
+	RulesBenchmark::runParser(bench);
+	bench.run("GameManager::restart", "-", 1, [&] { game.restart(); });
+
+	bench.printResults();
+
+	std::string errorMsg;
+	if (!jsonFile.empty() && !bench.writeJSON(jsonFile, errorMsg)) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "Annotator.h"
+#include "Engine.h"
+#include "GameFiles.h"
+#include "MoveGen.h"
+#include "Notation.h"
+#include "WorkStealingQueue.h"
+
+namespace {
+	// The evaluations are limited to ten pawns either way when the moves are judged:
+	const int scoreLimit = 1000;
+
+	// Analysis is what the engine made of a position, from the side to move's point of view:
+	struct Analysis {
+		int score;
+		Move bestMove;				// noMove if the game is over in the position.
+	};
+
+	// GameCounts are the errors of each side in a game, and the centipawns lost in all:
+	struct GameCounts {
+		int moves[2];
+		int mistakes[2];
+		int blunders[2];
+		int loss[2];
+	};
+
+	// whiteScore: const Analysis&, Color -> std::string
+	// Formats the score of the analysis, made with the given side to move, from White's
+	// point of view.
+	std::string whiteScore(const Analysis& analysis, Color sideToMove) {
+		if (analysis.bestMove == noMove)
+			return analysis.score == drawScore ? "stalemate" : "checkmate";
+		if (sideToMove == White)
+			return formatScore(analysis.score);
+
+		// The distance to a mate stays the same, only the side giving it changes:
+		std::string s = formatScore(analysis.score);
+		if (s[0] == '#')
+			return s[1] == '-' ? "#" + s.substr(2) : "#-" + s.substr(1);
+		return formatScore(-analysis.score);
+	}
+
+	int limited(int score) {
+		return (std::min)((std::max)(score, -scoreLimit), scoreLimit);
+	}
+
+	// analyse: Engine&, const Position&, nodes, AnnotateStats& -> Analysis
+	// Searches the position with the node budget, unless the game is over in it.
+	Analysis analyse(Engine& engine, const Position& pos, uint64_t nodes, AnnotateStats& counts) {
+		if (MoveList(pos).size() == 0)
+			return Analysis{ pos.inCheck() ? -mateScore : drawScore, noMove };
+
+		SearchLimits limits;
+		limits.nodes = nodes;
+		limits.startTime = now();
+		SearchResult result = engine.think(pos, limits);
+
+		counts.positions++;
+		counts.nodes += result.nodes;
+		return Analysis{ result.score, result.bestMove };
+	}
+
+	// annotateGame: Engine&, game file, output file, const AnnotateOptions&, AnnotateStats&, GameCounts& -> bool
+	// Analyses the game and writes it annotated. Returns false if the game cannot be replayed
+	// or written.
+	bool annotateGame(Engine& engine, const std::string& gameFile, const std::string& outFile,
+					  const AnnotateOptions& options, AnnotateStats& counts, GameCounts& game) {
+		std::vector<Move> moves;
+		if (!readSavedGame(gameFile, moves))
+			return false;
+
+		// The game is played through on a single position, which is then walked back from the
+		// last position with unmakeMove, so that the table already knows the lines ahead:
+		Position pos;
+		pos.reserve(int(moves.size()));
+		for (Move m : moves)
+			pos.makeMove(m);
+
+		engine.newGame();
+		std::vector<Analysis> analyses(moves.size() + 1);
+		for (size_t i = moves.size(); ; i--) {
+			analyses[i] = analyse(engine, pos, options.nodes, counts);
+			if (i == 0)
+				break;
+			pos.unmakeMove(moves[i - 1]);
+		}
+
+		// The position is back at the start, and is played through again for the notation:
+		std::ofstream out(outFile, std::ios::trunc);
+		game = GameCounts();
+		for (size_t i = 0; i < moves.size(); i++) {
+			Color us = pos.sideToMove();
+			int before = limited(analyses[i].score);
+			int after = limited(-analyses[i + 1].score);
+			int loss = moves[i] == analyses[i].bestMove ? 0 : (std::max)(0, before - after);
+
+			if (us == White)
+				out << (i == 0 ? "" : "\n") << i / 2 + 1 << ". ";
+			else
+				out << "  ";
+
+			out << moveToSAN(pos, moves[i]) << (loss >= options.blunder ? "??" : loss >= options.mistake ? "?" : "")
+				<< " (" << whiteScore(analyses[i + 1], ~us);
+			if (loss >= options.mistake)
+				out << ", best " << moveToSAN(pos, analyses[i].bestMove) << " " << whiteScore(analyses[i], us);
+			out << ")";
+
+			game.moves[us]++;
+			game.loss[us] += loss;
+			game.mistakes[us] += loss >= options.mistake && loss < options.blunder;
+			game.blunders[us] += loss >= options.blunder;
+			pos.makeMove(moves[i]);
+		}
+
+		out << "\n\n";
+		for (int c = White; c <= Black; c++)
+			out << (c == White ? "White" : "Black") << ": " << game.mistakes[c] << " mistakes, " << game.blunders[c]
+				<< " blunders, average loss " << (game.moves[c] ? game.loss[c] / game.moves[c] : 0) << " cp\n";
+
+		out.close();
+		return !out.fail();
+	}
+
+	// annotatedFileName: game file, output directory -> std::string
+	std::string annotatedFileName(const std::string& gameFile, const std::string& outDirectory) {
+		std::filesystem::path path(gameFile);
+		path.replace_extension(".txt");
+		if (!outDirectory.empty())
+			path = std::filesystem::path(outDirectory) / path.filename();
+		return path.string();
+	}
+}
+
+bool annotateGames(const std::vector<std::string>& gameFiles, const AnnotateOptions& options, AnnotateStats& stats,
+				   std::function<void(const std::string&)> report, std::string& errorMsg) {
+	if (!options.outDirectory.empty()) {
+		std::error_code ec;
+		std::filesystem::create_directories(options.outDirectory, ec);
+		if (ec) {
+			errorMsg = "ANNOTATE ERROR: could not create the directory " + options.outDirectory;
+			return false;
+		}
+	}
+
+	std::vector<std::string> files = savedGameFiles(gameFiles);
+	int threadCount = options.threads > 0 ? options.threads : (std::max)(1, int(std::thread::hardware_concurrency()));
+	WorkStealingQueue queue(files.size(), threadCount);
+	std::mutex statsMutex;
+	stats = AnnotateStats();
+
+	auto work = [&](int worker) {
+		Engine engine;
+		engine.setHashSize(options.hashMB);
+		size_t job;
+
+		while (queue.next(worker, job)) {
+			std::string outFile = annotatedFileName(files[job], options.outDirectory);
+			AnnotateStats counts;
+			GameCounts game;
+			TimePoint start = now();
+			bool success = annotateGame(engine, files[job], outFile, options, counts, game);
+
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.games++;
+			stats.badGames += !success;
+			stats.positions += counts.positions;
+			stats.nodes += counts.nodes;
+
+			if (!success) {
+				report("Could not annotate " + files[job]);
+				continue;
+			}
+
+			stats.mistakes += game.mistakes[White] + game.mistakes[Black];
+			stats.blunders += game.blunders[White] + game.blunders[Black];
+			std::ostringstream line;
+			line << "Annotated " << files[job] << " into " << outFile << ": " << counts.positions << " positions, "
+				 << game.mistakes[White] + game.mistakes[Black] << " mistakes, " << game.blunders[White] + game.blunders[Black]
+				 << " blunders (" << now() - start << " ms)";
+			report(line.str());
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+		threads.emplace_back(work, t);
+	for (std::thread& t : threads)
+		t.join();
+
+	return true;
+}
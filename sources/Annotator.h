@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// AnnotateOptions controls how deeply the games are analysed and what counts as an error:
+struct AnnotateOptions {
+	uint64_t nodes;				// The node budget of every position.
+	int threads;				// The games analysed at once; 0 for one per core.
+	size_t hashMB;				// The transposition table of each thread.
+	int mistake;				// The centipawns a move must lose to be marked "?",
+	int blunder;				// and to be marked "??".
+	std::string outDirectory;	// Where the annotated games are written; next to the games if empty.
+
+	AnnotateOptions() { nodes = 200000; threads = 0; hashMB = 64; mistake = 100; blunder = 300; }
+};
+
+// AnnotateStats reports what the annotation went through:
+struct AnnotateStats {
+	uint64_t games;				// The games read,
+	uint64_t badGames;			// of which this many could not be replayed or written.
+	uint64_t positions;			// The positions analysed,
+	uint64_t nodes;				// with this many nodes in all.
+	uint64_t mistakes;
+	uint64_t blunders;
+
+	AnnotateStats() { games = badGames = positions = nodes = mistakes = blunders = 0; }
+};
+
+// annotateGames: game files, const AnnotateOptions&, AnnotateStats&, report, error message -> bool
+// Analyses every position of the saved games (in the .clc format written by GameManager::save;
+// directories are searched for .clc files) with a fixed node budget, and writes each game
+// with its annotations into a .txt file of the same name.
+//
+// The games are shared out among the threads by a WorkStealingQueue. Every thread has an
+// engine of its own and analyses a game from its last position back to the first, without
+// clearing the transposition table in between: each position's search finds the lines of
+// the next one already in the table, and what was learnt about the later positions is
+// known to the earlier ones.
+//
+// The annotated games are written one move pair per line, each move with the evaluation
+// after it from White's point of view. A move that loses at least the mistake or the
+// blunder threshold against the engine's best move is marked "?" or "??", and is followed
+// by the best move with its evaluation. Evaluations beyond ten pawns count as ten pawns,
+// so that the moves of a won game are not all marked. Every game is reported when done.
+//
+// Returns false, with the reason in errorMsg, if the output directory cannot be created.
+bool annotateGames(const std::vector<std::string>& gameFiles, const AnnotateOptions& options, AnnotateStats& stats,
+				   std::function<void(const std::string&)> report, std::string& errorMsg);
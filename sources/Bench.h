@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "Search.h"
+
+// The depth and the transposition table size the bench searches with by default:
+const int defaultBenchDepth = 11;
+const size_t defaultBenchHashMB = 16;
+
+// BenchResult sums up the searches of a bench run:
+struct BenchResult {
+	uint64_t nodes;				// The signature of the search: it changes only when the search does.
+	uint64_t cutoffs;
+	uint64_t firstMoveCutoffs;
+	TimePoint time;
+
+	BenchResult() { nodes = cutoffs = firstMoveCutoffs = 0; time = 0; }
+};
+
+// runBench: depth, hash size, const SearchOptions&, report -> BenchResult
+// Searches a fixed set of positions (openings, middlegames and endgames) to the given
+// depth, one thread, reporting each position's nodes and best move.
+//
+// Every search starts from a cleared transposition table and cleared histories, and the
+// depth is the only limit, so the total node count is the same on every run and every
+// machine for the same search: comparing it between two builds shows whether they search
+// alike, and comparing their speeds shows whether one of them got slower.
+BenchResult runBench(int depth, size_t hashMB, const SearchOptions& options, std::function<void(const std::string&)> report);
+
+// benchReport: const BenchResult&, const SearchOptions& -> std::string
+// Returns the summary of a bench run: the node count, the speed, the share of the beta
+// cutoffs caused by the first move, and the search options it was run with.
+std::string benchReport(const BenchResult& result, const SearchOptions& options);
@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include "Bitboards.h"
+
+Bitboard pawnAttacksBB[2][64];
+Bitboard knightAttacksBB[64];
+Bitboard kingAttacksBB[64];
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+Bitboard rayBB[8][64];
+
+namespace {
+
+	// File and rank steps for each Direction:
+	const int dirFile[8] = { 0, 1, 1, -1, 0, -1, -1, 1 };
+	const int dirRank[8] = { 1, 0, 1, 1, -1, 0, -1, -1 };
+
+	// stepBB: square, fileStep, rankStep -> Bitboard
+	// Returns the square one step away from sq, or an empty bitboard
+	// if the step would leave the board.
+	Bitboard stepBB(int sq, int fileStep, int rankStep) {
+		int file = fileOf(sq) + fileStep;
+		int rank = rankOf(sq) + rankStep;
+		if (file < 0 || file > 7 || rank < 0 || rank > 7)
+			return 0;
+		return squareBB(makeSquare(file, rank));
+	}
+
+	// The tables are filled in once, before main is entered:
+	struct BitboardInitializer {
+		BitboardInitializer() {
+			for (int sq = 0; sq < 64; sq++) {
+				pawnAttacksBB[White][sq] = stepBB(sq, -1, 1) | stepBB(sq, 1, 1);
+				pawnAttacksBB[Black][sq] = stepBB(sq, -1, -1) | stepBB(sq, 1, -1);
+
+				knightAttacksBB[sq] = stepBB(sq, 1, 2) | stepBB(sq, 2, 1) | stepBB(sq, 2, -1) | stepBB(sq, 1, -2) |
+									  stepBB(sq, -1, -2) | stepBB(sq, -2, -1) | stepBB(sq, -2, 1) | stepBB(sq, -1, 2);
+
+				kingAttacksBB[sq] = 0;
+				for (int dir = 0; dir < 8; dir++)
+					kingAttacksBB[sq] |= stepBB(sq, dirFile[dir], dirRank[dir]);
+
+				for (int dir = 0; dir < 8; dir++) {
+					rayBB[dir][sq] = 0;
+					for (int next = sq; stepBB(next, dirFile[dir], dirRank[dir]); ) {
+						next = lsb(stepBB(next, dirFile[dir], dirRank[dir]));
+						rayBB[dir][sq] |= squareBB(next);
+					}
+				}
+			}
+
+			for (int s1 = 0; s1 < 64; s1++)
+				for (int s2 = 0; s2 < 64; s2++) {
+					betweenBB[s1][s2] = 0;
+					lineBB[s1][s2] = 0;
+					for (int dir = 0; dir < 8; dir++)
+						if (rayBB[dir][s1] & squareBB(s2)) {
+							int opposite = (dir + 4) % 8;
+							betweenBB[s1][s2] = rayBB[dir][s1] & rayBB[opposite][s2];
+							lineBB[s1][s2] = rayBB[dir][s1] | rayBB[opposite][s1] | squareBB(s1);
+						}
+				}
+		}
+	};
+
+	BitboardInitializer bitboardInitializer;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "EngineDefinitions.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Bitboards:
+// A bitboard is a 64-bit set of squares, bit n standing for the square n (a1 = 0, h8 = 63).
+// The engine uses them for representing piece placements and attack sets.
+//
+// The attack tables are precomputed when the program starts. Sliding piece attacks are
+// found with the classical ray approach: the ray in each direction is cut at the first
+// blocking piece.
+
+const Bitboard fileABB = 0x0101010101010101ULL;
+const Bitboard fileHBB = fileABB << 7;
+const Bitboard rank1BB = 0xFFULL;
+const Bitboard rank8BB = rank1BB << 56;
+
+extern Bitboard pawnAttacksBB[2][64];
+extern Bitboard knightAttacksBB[64];
+extern Bitboard kingAttacksBB[64];
+extern Bitboard betweenBB[64][64];		// The squares strictly between two aligned squares.
+extern Bitboard lineBB[64][64];			// The full line through two aligned squares.
+extern Bitboard rayBB[8][64];			// Ray masks indexed by Direction and origin square.
+
+// The eight ray directions. The first four point towards higher square numbers:
+enum Direction { North, East, NorthEast, NorthWest, South, West, SouthWest, SouthEast };
+
+inline Bitboard squareBB(int sq) { return 1ULL << sq; }
+inline Bitboard fileBB(int file) { return fileABB << file; }
+inline Bitboard rankBB(int rank) { return rank1BB << (8 * rank); }
+inline bool moreThanOne(Bitboard b) { return (b & (b - 1)) != 0; }
+
+inline int popCount(Bitboard b) {
+#if defined(_MSC_VER)
+	return int(__popcnt64(b));
+#else
+	return __builtin_popcountll(b);
+#endif
+}
+
+// lsb / msb: Bitboard -> square
+// Return the lowest / highest square of a non-empty bitboard.
+inline int lsb(Bitboard b) {
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward64(&idx, b);
+	return int(idx);
+#else
+	return __builtin_ctzll(b);
+#endif
+}
+
+inline int msb(Bitboard b) {
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanReverse64(&idx, b);
+	return int(idx);
+#else
+	return 63 - __builtin_clzll(b);
+#endif
+}
+
+// popLsb: Bitboard& -> square
+// Removes the lowest square from the bitboard and returns it.
+inline int popLsb(Bitboard& b) {
+	int sq = lsb(b);
+	b &= b - 1;
+	return sq;
+}
+
+// rayAttacks: Direction, square, occupancy -> Bitboard
+// Returns the squares a slider on sq attacks in the given direction.
+inline Bitboard rayAttacks(Direction dir, int sq, Bitboard occupied) {
+	Bitboard attacks = rayBB[dir][sq];
+	Bitboard blockers = attacks & occupied;
+	if (blockers)
+		attacks ^= rayBB[dir][dir < South ? lsb(blockers) : msb(blockers)];
+	return attacks;
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+	return rayAttacks(North, sq, occupied) | rayAttacks(East, sq, occupied) |
+		   rayAttacks(South, sq, occupied) | rayAttacks(West, sq, occupied);
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+	return rayAttacks(NorthEast, sq, occupied) | rayAttacks(NorthWest, sq, occupied) |
+		   rayAttacks(SouthEast, sq, occupied) | rayAttacks(SouthWest, sq, occupied);
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+	return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+// pieceAttacks: PieceType, square, occupancy -> Bitboard
+// Returns the attacks of a non-pawn piece standing on the given square.
+inline Bitboard pieceAttacks(PieceType pt, int sq, Bitboard occupied) {
+	switch (pt) {
+		case KnightType: return knightAttacksBB[sq];
+		case BishopType: return bishopAttacks(sq, occupied);
+		case RookType:	 return rookAttacks(sq, occupied);
+		case QueenType:	 return queenAttacks(sq, occupied);
+		default:		 return kingAttacksBB[sq];
+	}
+}
+
+inline bool aligned(int s1, int s2, int s3) { return (lineBB[s1][s2] & squareBB(s3)) != 0; }
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "MappedFile.h"
+
+class Position;
+
+// BookEntry is one move of an opening book: the position it is played in, the move
+// and its weight. In the file, an entry takes 16 bytes in the Polyglot layout, all
+// numbers big-endian:
+//		key (8 bytes), move (2 bytes), weight (2 bytes), learn (4 bytes, unused)
+// The entries are sorted by key, so that the moves of a position are next to each other.
+struct BookEntry {
+	Key key;
+	uint16_t move;
+	uint16_t weight;
+};
+
+const size_t bookEntrySize = 16;
+
+// BookSelection tells which of the book moves of a position is played:
+enum class BookSelection { Weighted, Best };
+
+// polyglotKey: const Position& -> Key
+// Returns the Polyglot key of the position, by which the positions of the books are both
+// written and looked up. It is not the engine's own key (Position::key), so that books made
+// by the Polyglot tools and by buildbook work alike.
+Key polyglotKey(const Position& pos);
+
+// encodeBookMove: Move -> uint16_t
+// decodeBookMove: const Position&, uint16_t -> Move
+// Converts between the engine's moves and the book moves. Like in Polyglot, a book move
+// holds the to-square in its lowest 6 bits, the from-square in the next 6 and the promotion
+// piece (1 = knight ... 4 = queen) in bits 12-14, and castling is written as the king
+// capturing its own rook. decodeBookMove returns noMove if the move is not legal.
+uint16_t encodeBookMove(Move m);
+Move decodeBookMove(const Position& pos, uint16_t bookMove);
+
+// writeBookEntry: const BookEntry&, unsigned char* -> void
+// Writes the entry in the file layout into the 16 bytes at out.
+void writeBookEntry(const BookEntry& entry, unsigned char* out);
+
+// Book:
+// An opening book file, mapped into memory rather than read in, so that opening even a
+// very large book takes no time and no memory beyond the pages actually probed. A position
+// is looked up by its Polyglot key (polyglotKey) with a binary search over the sorted
+// entries. The keys, the file layout and the move encoding are those of Polyglot, so that
+// the books made by the Polyglot tools can be used as well.
+class Book
+{
+private:
+	MappedFile file;
+	size_t entryCount;
+	std::mt19937 rng;
+
+	BookEntry entryAt(size_t index) const;
+	size_t lowerBound(Key key) const;
+
+public:
+	Book();
+
+	bool open(const std::string& fileName);
+	void close();
+	bool isOpen() const { return file.isOpen(); }
+	size_t size() const { return entryCount; }
+
+	std::vector<BookEntry> entries(const Position& pos) const;
+	Move probe(const Position& pos, BookSelection selection = BookSelection::Weighted);
+};
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include "BookBuilder.h"
+#include "Book.h"
+#include "GameFiles.h"
+#include "MoveGen.h"
+#include "Position.h"
+
+namespace {
+
+	// GameResult is the result of a game from the point of view of the player making a move:
+	enum GameResult { Loss, Draw, Win, UnknownResult };
+
+	// BookRecord holds the statistics of one move in one position. The records are
+	// sorted by key and then by move, which is the order of the book file.
+	struct BookRecord {
+		Key key;
+		uint16_t move;
+		uint32_t games, wins, draws, losses;
+
+		bool operator<(const BookRecord& other) const {
+			return key < other.key || (key == other.key && move < other.move);
+		}
+	};
+
+	struct RecordKey {
+		Key key;
+		uint16_t move;
+
+		bool operator==(const RecordKey& other) const { return key == other.key && move == other.move; }
+	};
+
+	struct RecordKeyHash {
+		size_t operator()(const RecordKey& k) const { return size_t(k.key ^ (uint64_t(k.move) * 0x9E3779B97F4A7C15ULL)); }
+	};
+
+	struct RecordStats {
+		uint32_t games, wins, draws, losses;
+	};
+
+	typedef std::unordered_map<RecordKey, RecordStats, RecordKeyHash> RecordMap;
+
+	// The memory taken by one map entry, the hash table's own bookkeeping included:
+	const size_t bytesPerMapEntry = 64;
+
+	const size_t readBufferRecords = 4096;
+	const size_t writeBufferEntries = 4096;
+
+	// sortedRecords: RecordMap& -> std::vector<BookRecord>
+	// Empties the map into a vector of records sorted in the book order.
+	std::vector<BookRecord> sortedRecords(RecordMap& map) {
+		std::vector<BookRecord> records;
+		records.reserve(map.size());
+		for (const auto& kv : map)
+			records.push_back(BookRecord{ kv.first.key, kv.first.move, kv.second.games, kv.second.wins, kv.second.draws, kv.second.losses });
+
+		RecordMap().swap(map);
+		std::sort(records.begin(), records.end());
+		return records;
+	}
+
+	// RecordCounter:
+	// The counting done by one thread. When the map grows past its limit, its records
+	// are written to disk as a sorted run and the map starts over.
+	class RecordCounter
+	{
+	private:
+		RecordMap map;
+		size_t maxEntries;
+		std::function<std::string()> nextRunFile;
+
+	public:
+		std::vector<std::string> runFiles;
+		std::string errorMsg;
+
+		RecordCounter(size_t _maxEntries, std::function<std::string()> _nextRunFile) {
+			maxEntries = _maxEntries;
+			nextRunFile = _nextRunFile;
+		}
+
+		void add(Key key, uint16_t move, GameResult result) {
+			RecordStats& stats = map[RecordKey{ key, move }];
+			stats.games++;
+			stats.wins += result == Win;
+			stats.draws += result == Draw;
+			stats.losses += result == Loss;
+
+			if (map.size() >= maxEntries)
+				spill();
+		}
+
+		void spill() {
+			std::vector<BookRecord> records = sortedRecords(map);
+			std::string fileName = nextRunFile();
+			std::ofstream run(fileName, std::ios::binary | std::ios::trunc);
+			run.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(BookRecord)));
+
+			if (!run)
+				errorMsg = "BOOK ERROR: could not write the temporary file " + fileName;
+			runFiles.push_back(fileName);
+		}
+
+		std::vector<BookRecord> remainder() { return sortedRecords(map); }
+	};
+
+	// RunReader:
+	// Reads a sorted run, either one left in memory or one spilled to disk, a record at a time.
+	class RunReader
+	{
+	private:
+		std::vector<BookRecord> records;
+		size_t next;
+		std::ifstream file;
+		bool fromFile;
+
+		void fill() {
+			records.resize(readBufferRecords);
+			file.read(reinterpret_cast<char*>(records.data()), std::streamsize(readBufferRecords * sizeof(BookRecord)));
+			records.resize(size_t(file.gcount()) / sizeof(BookRecord));
+			next = 0;
+		}
+
+	public:
+		explicit RunReader(std::vector<BookRecord>&& inMemory) : records(std::move(inMemory)) {
+			next = 0;
+			fromFile = false;
+		}
+
+		explicit RunReader(const std::string& fileName) : file(fileName, std::ios::binary) {
+			next = 0;
+			fromFile = true;
+		}
+
+		bool read(BookRecord& record) {
+			if (next == records.size() && fromFile && file)
+				fill();
+			if (next == records.size())
+				return false;
+
+			record = records[next++];
+			return true;
+		}
+	};
+
+	// BookWriter:
+	// Collects the moves of one position at a time and writes them to the book,
+	// the most heavily weighted first.
+	class BookWriter
+	{
+	private:
+		std::ofstream out;
+		std::vector<unsigned char> buffer;
+		std::vector<BookEntry> position;		// The moves of the current position,
+		std::vector<uint64_t> weights;			// and their weights before scaling.
+		int minGames;
+
+		void flushBuffer() {
+			out.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(buffer.size()));
+			buffer.clear();
+		}
+
+	public:
+		uint64_t written;
+
+		BookWriter(const std::string& fileName, int _minGames) : out(fileName, std::ios::binary | std::ios::trunc) {
+			minGames = _minGames;
+			written = 0;
+		}
+
+		bool isOpen() const { return out.is_open(); }
+
+		void add(const BookRecord& r) {
+			if (!position.empty() && position.back().key != r.key)
+				endPosition();
+			if (r.games < uint32_t(minGames))
+				return;
+
+			uint64_t unknown = r.games - r.wins - r.draws - r.losses;
+			uint64_t weight = 2 * uint64_t(r.wins) + r.draws + unknown;
+			position.push_back(BookEntry{ r.key, r.move, 0 });
+			weights.push_back(weight);
+		}
+
+		void endPosition() {
+			if (position.empty())
+				return;
+
+			// The weights of the most popular positions are scaled down to fit in 16 bits:
+			uint64_t maxWeight = *std::max_element(weights.begin(), weights.end());
+			for (size_t i = 0; i < position.size(); i++)
+				position[i].weight = uint16_t(maxWeight > UINT16_MAX ? weights[i] * UINT16_MAX / maxWeight : weights[i]);
+
+			std::stable_sort(position.begin(), position.end(),
+							 [](const BookEntry& a, const BookEntry& b) { return a.weight > b.weight; });
+
+			for (const BookEntry& e : position) {
+				buffer.resize(buffer.size() + bookEntrySize);
+				writeBookEntry(e, &buffer[buffer.size() - bookEntrySize]);
+				written++;
+			}
+			if (buffer.size() >= writeBufferEntries * bookEntrySize)
+				flushBuffer();
+
+			position.clear();
+			weights.clear();
+		}
+
+		bool finish() {
+			endPosition();
+			flushBuffer();
+			out.close();
+			return !out.fail();
+		}
+	};
+
+	// replayGame: file name, max ply, moves, GameResult& -> bool
+	// Replays the game in the file, collecting the position keys and the moves of its first
+	// plies, and works out its result from the final position. Returns false if the file
+	// cannot be read or a move cannot be replayed; the moves before it are still collected.
+	bool replayGame(const std::string& fileName, int maxPly, std::vector<RecordKey>& records, GameResult& whiteResult) {
+		std::vector<Move> moves;
+		bool complete = readSavedGame(fileName, moves);
+		Position pos;
+		pos.setFromFEN(Position::startFEN);
+		records.clear();
+		whiteResult = UnknownResult;
+
+		for (Move m : moves) {
+			if (int(records.size()) < maxPly)
+				records.push_back(RecordKey{ polyglotKey(pos), encodeBookMove(m) });
+			pos.makeMove(m);
+		}
+		if (!complete)
+			return false;
+
+		if (MoveList(pos).size() == 0) {
+			if (!pos.inCheck())
+				whiteResult = Draw;
+			else
+				whiteResult = pos.sideToMove() == Black ? Win : Loss;
+		}
+
+		return true;
+	}
+}
+
+bool buildBook(const std::vector<std::string>& gamePaths, const std::string& bookFile,
+			   const BookBuildOptions& options, BookBuildStats& stats, std::string& errorMsg) {
+	std::vector<std::string> files = savedGameFiles(gamePaths);
+	if (files.empty()) {
+		errorMsg = "BOOK ERROR: no game files given";
+		return false;
+	}
+
+	int threadCount = options.threads > 0 ? options.threads : (std::max)(1, int(std::thread::hardware_concurrency()));
+	threadCount = (std::min)(threadCount, int(files.size()));
+	size_t maxEntries = (std::max)(size_t(1024), options.memoryMB * 1024 * 1024 / size_t(threadCount) / bytesPerMapEntry);
+
+	// 1. Count the moves of the games, each thread taking the next unread game in turn:
+	std::atomic<size_t> nextFile(0);
+	std::atomic<uint64_t> runNumber(0);
+	std::atomic<uint64_t> badGames(0), decisiveGames(0), drawnGames(0), movesCounted(0);
+	auto nextRunFile = [&bookFile, &runNumber] { return bookFile + ".run" + std::to_string(runNumber++); };
+
+	std::vector<std::unique_ptr<RecordCounter>> counters;
+	for (int i = 0; i < threadCount; i++)
+		counters.emplace_back(new RecordCounter(maxEntries, nextRunFile));
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++)
+		threads.emplace_back([&, i] {
+			RecordCounter& counter = *counters[i];
+			std::vector<RecordKey> moves;
+			GameResult whiteResult;
+
+			for (size_t f = nextFile++; f < files.size(); f = nextFile++) {
+				if (!replayGame(files[f], options.maxPly, moves, whiteResult))
+					badGames++;
+				decisiveGames += whiteResult == Win || whiteResult == Loss;
+				drawnGames += whiteResult == Draw;
+				movesCounted += moves.size();
+
+				for (size_t ply = 0; ply < moves.size(); ply++) {
+					GameResult result = whiteResult;
+					if (ply % 2 == 1 && result != Draw && result != UnknownResult)
+						result = result == Win ? Loss : Win;
+					counter.add(moves[ply].key, moves[ply].move, result);
+				}
+			}
+		});
+
+	for (std::thread& t : threads)
+		t.join();
+
+	// 2. Merge the runs on disk and the records left in memory:
+	std::vector<std::string> runFiles;
+	std::vector<std::unique_ptr<RunReader>> runs;
+	for (std::unique_ptr<RecordCounter>& counter : counters) {
+		if (!counter->errorMsg.empty() && errorMsg.empty())
+			errorMsg = counter->errorMsg;
+		for (const std::string& run : counter->runFiles) {
+			runFiles.push_back(run);
+			runs.emplace_back(new RunReader(run));
+		}
+		runs.emplace_back(new RunReader(counter->remainder()));
+	}
+	counters.clear();
+
+	BookWriter writer(bookFile, options.minGames);
+	if (!writer.isOpen() && errorMsg.empty())
+		errorMsg = "BOOK ERROR: could not open the file " + bookFile;
+
+	if (errorMsg.empty()) {
+		typedef std::pair<BookRecord, size_t> Head;
+		auto later = [](const Head& a, const Head& b) { return b.first < a.first; };
+		std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+		BookRecord r;
+		for (size_t i = 0; i < runs.size(); i++)
+			if (runs[i]->read(r))
+				heads.push(Head(r, i));
+
+		bool pending = false;
+		BookRecord sum = BookRecord();
+		while (!heads.empty()) {
+			Head head = heads.top();
+			heads.pop();
+			if (runs[head.second]->read(r))
+				heads.push(Head(r, head.second));
+
+			const BookRecord& h = head.first;
+			if (pending && h.key == sum.key && h.move == sum.move) {
+				sum.games += h.games;
+				sum.wins += h.wins;
+				sum.draws += h.draws;
+				sum.losses += h.losses;
+			}
+			else {
+				if (pending)
+					writer.add(sum);
+				sum = h;
+				pending = true;
+			}
+		}
+		if (pending)
+			writer.add(sum);
+
+		if (!writer.finish())
+			errorMsg = "BOOK ERROR: could not write the file " + bookFile;
+	}
+
+	runs.clear();
+	for (const std::string& run : runFiles)
+		std::remove(run.c_str());
+
+	stats.games = files.size();
+	stats.badGames = badGames;
+	stats.decisiveGames = decisiveGames;
+	stats.drawnGames = drawnGames;
+	stats.movesCounted = movesCounted;
+	stats.runsSpilled = runFiles.size();
+	stats.entriesWritten = writer.written;
+
+	return errorMsg.empty();
+}
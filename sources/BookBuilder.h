@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// BookBuildOptions controls which positions and moves of the games end up in the book:
+struct BookBuildOptions {
+	int maxPly;					// Only the moves of the first maxPly plies of each game are counted.
+	int minGames;				// Moves played in fewer games are left out.
+	int threads;				// The number of threads replaying the games.
+	size_t memoryMB;			// The memory the threads may use for counting before spilling to disk.
+
+	BookBuildOptions() { maxPly = 40; minGames = 1; threads = 0; memoryMB = 512; }
+};
+
+// BookBuildStats reports what the build went through:
+struct BookBuildStats {
+	uint64_t games;				// The games read,
+	uint64_t badGames;			// of which this many had a move that could not be replayed.
+	uint64_t decisiveGames;		// The games ending in a checkmate,
+	uint64_t drawnGames;		// and in a stalemate. The result of the rest is unknown.
+	uint64_t movesCounted;
+	uint64_t runsSpilled;		// The sorted runs written to disk when the memory ran out.
+	uint64_t entriesWritten;
+
+	BookBuildStats() { games = badGames = decisiveGames = drawnGames = movesCounted = runsSpilled = entriesWritten = 0; }
+};
+
+// buildBook: game files, book file name, const BookBuildOptions&, BookBuildStats& -> bool
+// Replays the saved games (in the .clc format written by GameManager::save) and writes the
+// opening book read by Book. Directories are searched for .clc files.
+//
+// The games are shared out among the threads, each of which counts the (position, move)
+// pairs it meets in a hash map of its own, along with the wins, draws and losses of the
+// player making the move. When a thread's map outgrows its share of the memory budget,
+// it is sorted and written out as a run next to the book file. Finally the runs and the
+// maps still in memory are merged in key order, so that the whole book is never held in
+// memory at once.
+//
+// A move is weighted with 2 points for every win, 1 for every draw and for every game of
+// unknown result, and 0 for a loss. Returns false, with the reason in errorMsg, if a file
+// cannot be read or written.
+bool buildBook(const std::vector<std::string>& gameFiles, const std::string& bookFile,
+			   const BookBuildOptions& options, BookBuildStats& stats, std::string& errorMsg);
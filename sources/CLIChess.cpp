@@ -1,12 +1,53 @@
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <Windows.h>
 #include "GameManager.h"
 #include "CLIChessExceptions.h"
+#include "Annotator.h"
+#include "Bench.h"
+#include "Book.h"
+#include "BookBuilder.h"
+#include "Engine.h"
+#include "MatchRunner.h"
+#include "MateSolver.h"
+#include "MoveStats.h"
+#include "NNUE.h"
+#include "Notation.h"
+#include "PuzzleMiner.h"
+#include "Tablebase.h"
+#include "Tuner.h"
+#include "UCI.h"
 
-enum class CLICommand {NewGame, Quit, Save, Load, Move, ShowBoard, ShowMenu, TakeBack, UNK};
+enum class CLICommand {NewGame, Quit, Save, Load, Move, ShowBoard, ShowMenu, TakeBack, Hanging, OpenBook, Tablebases, EvalFile, Hint, BestMoves, Mate, SearchMode, Analyze, Ponder, Stats, UCI, UNK};
+
+// HintCache remembers the last hint search: the position searched, the thinking time it
+// was given and the depth it reached.
+struct HintCache {
+	Key key;
+	TimePoint budget;
+	int depth;
+
+	HintCache() { key = 0; budget = 0; depth = 0; }
+};
 
 CLICommand getCommand(const std::string& cmd);
 bool promptForYesNo(std::string promptMsg);
+int runBookBuilder(int argc, char* argv[]);
+int runTablebaseGenerator(int argc, char* argv[]);
+int runMateSolver(int argc, char* argv[]);
+bool parseEngineConfig(const std::string& settings, EngineConfig& config);
+int runMatchRunner(int argc, char* argv[]);
+int runTuner(int argc, char* argv[]);
+int runAnnotator(int argc, char* argv[]);
+int runPuzzleMiner(int argc, char* argv[]);
+int runBenchCommand(int argc, char* argv[]);
+void startBackgroundSearch(Engine& engine, const GameManager& gm, bool showAnalysis);
+std::string hint(Engine& engine, Book& book, const GameManager& gm, TimePoint budget, HintCache& cache);
+std::string bestMoves(Engine& engine, const GameManager& gm, int count, TimePoint budget);
+std::string tablebaseVerdict(const GameManager& gm);
+std::string mateReport(const Position& pos, const MateResult& result, int maxMoves);
 
 void printStartInfo();
 void printMainMenu();
@@ -15,15 +56,62 @@ void printQuitInfo();
 
 void clearScreen(char fill = ' ');
 
-int main()
+const TimePoint defaultHintTime = 1000;
+const uint64_t defaultMateNodes = 5000000;
+
+int main(int argc, char* argv[])
 {
+	// "CLIChess uci" starts the engine directly in the UCI mode for chess GUIs and match runners:
+	if (argc > 1 && std::string(argv[1]) == "uci") {
+		uciLoop();
+		return 0;
+	}
+
+	// "CLIChess buildbook ..." builds an opening book from saved games:
+	if (argc > 1 && std::string(argv[1]) == "buildbook")
+		return runBookBuilder(argc, argv);
+
+	// "CLIChess gentb ..." generates the endgame tablebases:
+	if (argc > 1 && std::string(argv[1]) == "gentb")
+		return runTablebaseGenerator(argc, argv);
+
+	// "CLIChess mate ..." looks for the forced mates of the positions in a file:
+	if (argc > 1 && std::string(argv[1]) == "mate")
+		return runMateSolver(argc, argv);
+
+	// "CLIChess match ..." plays a match between two engine instances:
+	if (argc > 1 && std::string(argv[1]) == "match")
+		return runMatchRunner(argc, argv);
+
+	// "CLIChess tune ..." tunes the evaluation weights on saved games:
+	if (argc > 1 && std::string(argv[1]) == "tune")
+		return runTuner(argc, argv);
+
+	// "CLIChess annotate ..." analyses saved games and marks their mistakes:
+	if (argc > 1 && std::string(argv[1]) == "annotate")
+		return runAnnotator(argc, argv);
+
+	// "CLIChess puzzles ..." mines tactical puzzles from saved games:
+	if (argc > 1 && std::string(argv[1]) == "puzzles")
+		return runPuzzleMiner(argc, argv);
+
+	// "CLIChess bench ..." searches a fixed set of positions for the node count and the speed:
+	if (argc > 1 && std::string(argv[1]) == "bench")
+		return runBenchCommand(argc, argv);
+
 	SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), consoleColor);
 	SetConsoleCP(437);
 	SetConsoleOutputCP(437);
 	GameManager gm;
+	Engine engine;
+	Book book;
+	MateSolver mateSolver;
+	HintCache hintCache;
 	bool quitGame = false;
 	bool gameOngoing = false;
 	bool printBoard = true;
+	bool analysisMode = false;
+	bool ponderMode = false;
 
 	const std::string emptyFrameMsg = "\n\n\n";
 	std::string boardFrameMsg;
@@ -53,13 +141,28 @@ int main()
 			std::cout << "[CLIChess] >> ";
 		}
 
-		// 2. Handle the user input: 
+		// 2. Handle the user input. While the user is thinking, the engine may
+		//    search the position in the background. The search is stopped as soon
+		//    as the input arrives, but what it found stays in the transposition table:
+		bool thinking = gameOngoing && (analysisMode || ponderMode);
+		if (thinking)
+			startBackgroundSearch(engine, gm, analysisMode);
+
 		std::getline(std::cin, userInput);
 
+		if (thinking) {
+			engine.stop();
+			engine.wait();
+			if (analysisMode)
+				std::cout << std::endl;
+		}
+
 		switch (getCommand(userInput)) {
 
 		case (CLICommand::NewGame):
 			gm.restart();
+			// The search mode is chosen for one game only:
+			engine.setSearchMode(SearchMode::AlphaBeta);
 			if (gameOngoing == false)
 				gameOngoing = true;
 
@@ -85,6 +188,7 @@ int main()
 
 		case (CLICommand::Load):
 			if (gm.load(userInput.substr(2, std::string::npos))) {
+				engine.setSearchMode(SearchMode::AlphaBeta);
 				gameOngoing = true;
 				boardFrameMsg = "Finished loading.\n\n\n";
 			}
@@ -126,7 +230,7 @@ int main()
 						}
 					}
 				}
-				else boardFrameMsg = emptyFrameMsg;
+				else boardFrameMsg = tablebaseVerdict(gm) + emptyFrameMsg;
 			}
 			else
 				boardFrameMsg = "Unknown command" + emptyFrameMsg;
@@ -160,6 +264,127 @@ int main()
 				boardFrameMsg = emptyFrameMsg;
 			break;
 
+		case (CLICommand::Hanging):
+			if (gameOngoing)
+				boardFrameMsg = "Hanging pieces:\n" + gm.hangingPieces() + "\n";
+			else
+				boardFrameMsg = "No ongoing game. Showing hanging pieces not possible.\n";
+			break;
+
+		case (CLICommand::OpenBook):
+			if (book.open(userInput.substr(5, std::string::npos)))
+				boardFrameMsg = "Opened the opening book (" + std::to_string(book.size()) + " entries)." + emptyFrameMsg;
+			else
+				boardFrameMsg = "Could not open the opening book file " + userInput.substr(5, std::string::npos) + emptyFrameMsg;
+			break;
+
+		case (CLICommand::Tablebases): {
+			int loaded = loadTablebases(userInput.substr(3, std::string::npos));
+			if (loaded > 0)
+				boardFrameMsg = "Loaded " + std::to_string(loaded) + " endgame tablebases." + emptyFrameMsg;
+			else
+				boardFrameMsg = "No endgame tablebases found in " + userInput.substr(3, std::string::npos) + emptyFrameMsg;
+			break;
+		}
+
+		case (CLICommand::EvalFile):
+			if (loadNetwork(userInput.substr(5, std::string::npos)))
+				boardFrameMsg = "Loaded the network. The engine now evaluates the positions with it." + emptyFrameMsg;
+			else
+				boardFrameMsg = "Could not load the network file " + userInput.substr(5, std::string::npos) + emptyFrameMsg;
+			break;
+
+		case (CLICommand::Hint):
+			if (gameOngoing) {
+				try {
+					TimePoint budget = userInput.size() > 2 ? std::stoll(userInput.substr(2, std::string::npos)) : defaultHintTime;
+					if (budget <= 0)
+						throw std::invalid_argument("non-positive time");
+					boardFrameMsg = hint(engine, book, gm, budget, hintCache);
+				}
+				catch (const std::logic_error& e) {
+					boardFrameMsg = "PARSE ERROR\n[" +
+									userInput + "]: Could not parse the given thinking time.\n\n";
+				}
+			}
+			else
+				boardFrameMsg = "No ongoing game. Giving a hint not possible.\n";
+			break;
+
+		case (CLICommand::BestMoves):
+			if (gameOngoing) {
+				std::istringstream args(userInput.substr(8, std::string::npos));
+				int count = 0;
+				TimePoint budget = defaultHintTime;
+				args >> count;
+				if (!args.fail() && !args.eof())
+					args >> budget;
+
+				if (args.fail() || count <= 0 || budget <= 0)
+					boardFrameMsg = "PARSE ERROR\n[" +
+									userInput + "]: Could not parse the number of moves or the thinking time.\n\n";
+				else
+					boardFrameMsg = bestMoves(engine, gm, count, budget);
+			}
+			else
+				boardFrameMsg = "No ongoing game. Showing the best moves not possible.\n";
+			break;
+
+		case (CLICommand::Mate):
+			if (gameOngoing) {
+				std::istringstream args(userInput.substr(5, std::string::npos));
+				int moves = 0;
+				uint64_t nodes = defaultMateNodes;
+				args >> moves;
+				if (!args.fail() && !args.eof())
+					args >> nodes;
+
+				if (args.fail() || moves <= 0)
+					boardFrameMsg = "PARSE ERROR\n[" +
+									userInput + "]: Could not parse the number of moves or the node limit.\n\n";
+				else {
+					Position pos;
+					pos.setFromFEN(gm.toFEN());
+					TimePoint start = now();
+					MateResult result = mateSolver.solve(pos, moves, nodes);
+					boardFrameMsg = gm.inTurnPlayer() + ": " + mateReport(pos, result, moves) + " (" +
+									std::to_string(result.nodes) + " nodes, " + std::to_string(now() - start) + " ms)\n\n\n";
+				}
+			}
+			else
+				boardFrameMsg = "No ongoing game. Looking for a mate not possible.\n";
+			break;
+
+		case (CLICommand::SearchMode):
+			engine.setSearchMode(userInput == "mode mcts" ? SearchMode::MonteCarlo : SearchMode::AlphaBeta);
+			boardFrameMsg = std::string("The engine now uses the ") +
+							(userInput == "mode mcts" ? "Monte Carlo tree search" : "alpha-beta search") + "." + emptyFrameMsg;
+			break;
+
+		case (CLICommand::Analyze):
+			analysisMode = !analysisMode;
+			boardFrameMsg = std::string("Analysis ") + (analysisMode ? "on" : "off") + emptyFrameMsg;
+			break;
+
+		case (CLICommand::Ponder):
+			ponderMode = !ponderMode;
+			boardFrameMsg = std::string("Pondering ") + (ponderMode ? "on" : "off") + emptyFrameMsg;
+			break;
+
+		case (CLICommand::Stats):
+			if (userInput == "stats reset") {
+				resetMoveStats();
+				boardFrameMsg = "The move statistics were reset." + emptyFrameMsg;
+			}
+			else
+				boardFrameMsg = "Move statistics:\n" + moveStatsReport(moveStatsSnapshot()) + "\n";
+			break;
+
+		case (CLICommand::UCI):
+			// A chess GUI that starts the program announces itself with "uci":
+			uciLoop(userInput);
+			return 0;
+
 		case (CLICommand::ShowMenu):
 			clearScreen();
 			printMainMenu();
@@ -193,6 +418,8 @@ CLICommand getCommand(const std::string& cmd) {
 		case ('n'):
 			if (len == 1)
 				return CLICommand::NewGame;
+			else if (len > 5 && cmd.compare(0, 5, "nnue ") == 0)
+				return CLICommand::EvalFile;
 			else
 				return CLICommand::UNK;
 		
@@ -203,13 +430,17 @@ CLICommand getCommand(const std::string& cmd) {
 				return CLICommand::UNK;
 		
 		case ('s'):
-			if (len > 2 && cmd[1] == ' ')
+			if (cmd == "stats" || cmd == "stats reset")
+				return CLICommand::Stats;
+			else if (len > 2 && cmd[1] == ' ')
 				return CLICommand::Save;
 			else
 				return CLICommand::UNK;
 
 		case ('t'):
-			if (len > 2 && cmd[1] == ' ')
+			if (len > 3 && cmd.compare(0, 3, "tb ") == 0)
+				return CLICommand::Tablebases;
+			else if (len > 2 && cmd[1] == ' ')
 				return CLICommand::TakeBack;
 			else
 				return CLICommand::UNK;
@@ -223,12 +454,46 @@ CLICommand getCommand(const std::string& cmd) {
 		case('m'):
 			if (len == 1)
 				return CLICommand::ShowMenu;
+			else if (cmd.compare(0, 8, "multipv ") == 0)
+				return CLICommand::BestMoves;
+			else if (len > 5 && cmd.compare(0, 5, "mate ") == 0)
+				return CLICommand::Mate;
+			else if (cmd == "mode alphabeta" || cmd == "mode mcts")
+				return CLICommand::SearchMode;
 			else
 				return CLICommand::UNK;
 		
+		case('h'):
+			if (cmd == "hanging")
+				return CLICommand::Hanging;
+			else if (len == 1 || cmd[1] == ' ')
+				return CLICommand::Hint;
+			else
+				return CLICommand::Move;
+
+		case('a'):
+			if (cmd == "analyze")
+				return CLICommand::Analyze;
+			else
+				return CLICommand::Move;
+
+		case('p'):
+			if (cmd == "ponder")
+				return CLICommand::Ponder;
+			else
+				return CLICommand::UNK;
+
+		case('u'):
+			if (cmd == "uci")
+				return CLICommand::UCI;
+			else
+				return CLICommand::UNK;
+
 		case('b'):
 			if (len == 1)
 				return CLICommand::ShowBoard;
+			else if (len > 5 && cmd.compare(0, 5, "book ") == 0)
+				return CLICommand::OpenBook;
 			else
 				return CLICommand::Move;
 
@@ -237,6 +502,689 @@ CLICommand getCommand(const std::string& cmd) {
 	}
 }
 
+// runBookBuilder: argc, argv -> int
+// Builds an opening book as told by the command line:
+//		CLIChess buildbook book_file game_files_or_directories... [-plies n] [-min n] [-threads n] [-memory mb]
+// Returns the exit code of the program.
+int runBookBuilder(int argc, char* argv[]) {
+	BookBuildOptions options;
+	std::vector<std::string> gameFiles;
+	std::string bookFile;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-plies" && hasValue)
+				options.maxPly = std::stoi(argv[++i]);
+			else if (arg == "-min" && hasValue)
+				options.minGames = std::stoi(argv[++i]);
+			else if (arg == "-threads" && hasValue)
+				options.threads = std::stoi(argv[++i]);
+			else if (arg == "-memory" && hasValue)
+				options.memoryMB = size_t(std::stoul(argv[++i]));
+			else if (bookFile.empty())
+				bookFile = arg;
+			else
+				gameFiles.push_back(arg);
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	if (bookFile.empty() || gameFiles.empty()) {
+		std::cout << "Usage: CLIChess buildbook book_file game_files_or_directories... [-plies n] [-min n] [-threads n] [-memory mb]" << std::endl;
+		return 1;
+	}
+
+	BookBuildStats stats;
+	std::string errorMsg;
+	TimePoint start = now();
+	bool success = buildBook(gameFiles, bookFile, options, stats, errorMsg);
+
+	std::cout << "Games: " << stats.games << " (" << stats.badGames << " could not be replayed, "
+			  << stats.decisiveGames << " decisive, " << stats.drawnGames << " drawn)" << std::endl;
+	std::cout << "Moves counted: " << stats.movesCounted << ", runs spilled to disk: " << stats.runsSpilled << std::endl;
+	std::cout << "Book entries written: " << stats.entriesWritten << " in " << now() - start << " ms" << std::endl;
+
+	if (!success) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// runTablebaseGenerator: argc, argv -> int
+// Generates the endgame tablebases as told by the command line:
+//		CLIChess gentb directory [material_sets...] [-threads n]
+// Without material sets, all the sets supported are generated.
+// Returns the exit code of the program.
+int runTablebaseGenerator(int argc, char* argv[]) {
+	std::vector<std::string> sets;
+	std::string directory;
+	int threads = int(std::thread::hardware_concurrency());
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "-threads" && i + 1 < argc)
+				threads = std::stoi(argv[++i]);
+			else if (directory.empty())
+				directory = arg;
+			else
+				sets.push_back(arg);
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number of threads." << std::endl;
+		return 1;
+	}
+
+	if (directory.empty()) {
+		std::cout << "Usage: CLIChess gentb directory [material_sets...] [-threads n]" << std::endl;
+		return 1;
+	}
+	if (sets.empty())
+		sets = defaultTablebaseSets();
+
+	std::string errorMsg;
+	TimePoint start = now();
+	bool success = generateTablebases(directory, sets, threads,
+									  [](const std::string& line) { std::cout << line << std::endl; }, errorMsg);
+	if (!success) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+
+	std::cout << "Tablebases ready in " << now() - start << " ms" << std::endl;
+	return 0;
+}
+
+// runMateSolver: argc, argv -> int
+// Looks for the forced mates of the positions in a file, one FEN per line, as told by
+// the command line:
+//		CLIChess mate fen_file [-moves n] [-nodes n] [-threads n] [-hash mb]
+// Prints every position with its result, and a summary at the end.
+// Returns the exit code of the program.
+int runMateSolver(int argc, char* argv[]) {
+	std::string fileName;
+	int moves = 5;
+	uint64_t nodes = defaultMateNodes;
+	int threads = int(std::thread::hardware_concurrency());
+	size_t hashMB = 64;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-moves" && hasValue)
+				moves = std::stoi(argv[++i]);
+			else if (arg == "-nodes" && hasValue)
+				nodes = std::stoull(argv[++i]);
+			else if (arg == "-threads" && hasValue)
+				threads = std::stoi(argv[++i]);
+			else if (arg == "-hash" && hasValue)
+				hashMB = size_t(std::stoul(argv[++i]));
+			else
+				fileName = arg;
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	std::ifstream in(fileName);
+	if (fileName.empty() || !in) {
+		std::cout << "Usage: CLIChess mate fen_file [-moves n] [-nodes n] [-threads n] [-hash mb]" << std::endl;
+		return 1;
+	}
+
+	std::vector<Position> positions;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		try {
+			Position pos;
+			pos.setFromFEN(line);
+			positions.push_back(pos);
+		}
+		catch (const ParseException& e) {
+			std::cout << "Skipped, not a valid FEN: " << line << std::endl;
+		}
+	}
+
+	TimePoint start = now();
+	std::vector<MateResult> results = solveMates(positions, moves, nodes, hashMB, threads);
+
+	int proven = 0, disproven = 0;
+	uint64_t totalNodes = 0;
+	for (size_t i = 0; i < results.size(); i++) {
+		std::cout << positions[i].toFEN() << " ; " << mateReport(positions[i], results[i], moves) << std::endl;
+		proven += results[i].status == MateStatus::Proven;
+		disproven += results[i].status == MateStatus::Disproven;
+		totalNodes += results[i].nodes;
+	}
+
+	std::cout << "Positions: " << results.size() << " (" << proven << " mates, " << disproven << " without a mate, "
+			  << results.size() - proven - disproven << " unsolved), " << totalNodes << " nodes in " << now() - start << " ms" << std::endl;
+	return 0;
+}
+
+// parseEngineConfig: string, EngineConfig& -> bool
+// Reads the settings of a match player, given as comma-separated name=value pairs:
+//		name=Base,hash=32,mode=mcts,null=off,lmr=off,futility=off,rfp=off,checkext=off
+// Returns false if a setting is not known.
+bool parseEngineConfig(const std::string& settings, EngineConfig& config) {
+	std::istringstream in(settings);
+	std::string pair;
+
+	while (std::getline(in, pair, ',')) {
+		size_t eq = pair.find('=');
+		if (eq == std::string::npos)
+			return false;
+		std::string key = pair.substr(0, eq), value = pair.substr(eq + 1);
+		bool on = value != "off";
+
+		if (key == "name")
+			config.name = value;
+		else if (key == "hash")
+			config.hashMB = size_t(std::stoul(value));
+		else if (key == "mode" && (value == "mcts" || value == "alphabeta"))
+			config.mode = value == "mcts" ? SearchMode::MonteCarlo : SearchMode::AlphaBeta;
+		else if (key == "null")
+			config.options.nullMove = on;
+		else if (key == "lmr")
+			config.options.lateMoveReductions = on;
+		else if (key == "futility")
+			config.options.futility = on;
+		else if (key == "rfp")
+			config.options.reverseFutility = on;
+		else if (key == "checkext")
+			config.options.checkExtensions = on;
+		else
+			return false;
+	}
+	return true;
+}
+
+// runMatchRunner: argc, argv -> int
+// Plays a match between two engine instances as told by the command line:
+//		CLIChess match [-games n] [-concurrency n] [-tc seconds+increment | -movetime ms | -nodes n | -depth n]
+//					   [-openings files...] [-plies n] [-random n] [-seed n] [-engine1 settings] [-engine2 settings]
+//					   [-tb directory] [-sprt elo0 elo1 [alpha beta]] [-out directory]
+// Returns the exit code of the program.
+int runMatchRunner(int argc, char* argv[]) {
+	const std::string usage = "Usage: CLIChess match [-games n] [-concurrency n] [-tc seconds+increment | -movetime ms | -nodes n | -depth n]\n"
+							  "       [-openings files...] [-plies n] [-random n] [-seed n] [-engine1 settings] [-engine2 settings]\n"
+							  "       [-tb directory] [-sprt elo0 elo1 [alpha beta]] [-out directory]";
+	MatchOptions options;
+	EngineConfig first, second;
+	std::string tablebaseDirectory;
+	first.name = "Engine1";
+	second.name = "Engine2";
+	options.concurrency = (std::max)(1, int(std::thread::hardware_concurrency()));
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-games" && hasValue)
+				options.games = std::stoi(argv[++i]);
+			else if (arg == "-concurrency" && hasValue)
+				options.concurrency = std::stoi(argv[++i]);
+			else if (arg == "-tc" && hasValue) {
+				std::string tc = argv[++i];
+				size_t plus = tc.find('+');
+				options.baseTime = TimePoint(std::stod(tc.substr(0, plus)) * 1000);
+				options.inc = plus == std::string::npos ? 0 : TimePoint(std::stod(tc.substr(plus + 1)) * 1000);
+			}
+			else if (arg == "-movetime" && hasValue)
+				options.moveTime = std::stoll(argv[++i]);
+			else if (arg == "-nodes" && hasValue)
+				options.nodes = std::stoull(argv[++i]);
+			else if (arg == "-depth" && hasValue)
+				options.depth = std::stoi(argv[++i]);
+			else if (arg == "-openings") {
+				while (i + 1 < argc && argv[i + 1][0] != '-')
+					options.openingFiles.push_back(argv[++i]);
+			}
+			else if (arg == "-plies" && hasValue)
+				options.openingPlies = std::stoi(argv[++i]);
+			else if (arg == "-random" && hasValue)
+				options.randomPlies = std::stoi(argv[++i]);
+			else if (arg == "-seed" && hasValue)
+				options.seed = std::stoull(argv[++i]);
+			else if ((arg == "-engine1" || arg == "-engine2") && hasValue) {
+				if (!parseEngineConfig(argv[++i], arg == "-engine1" ? first : second)) {
+					std::cout << "PARSE ERROR: Unknown engine setting in " << argv[i] << std::endl;
+					return 1;
+				}
+			}
+			else if (arg == "-tb" && hasValue)
+				tablebaseDirectory = argv[++i];
+			else if (arg == "-sprt" && i + 2 < argc) {
+				options.sprt = true;
+				options.elo0 = std::stod(argv[++i]);
+				options.elo1 = std::stod(argv[++i]);
+				if (i + 2 < argc && argv[i + 1][0] != '-') {
+					options.alpha = std::stod(argv[++i]);
+					options.beta = std::stod(argv[++i]);
+				}
+			}
+			else if (arg == "-out" && hasValue)
+				options.gamesDirectory = argv[++i];
+			else {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	// Without any limit, the engines would think forever:
+	if (options.baseTime == 0 && options.moveTime == 0 && options.nodes == 0 && options.depth == 0)
+		options.moveTime = 100;
+
+	if (!tablebaseDirectory.empty())
+		std::cout << "Loaded " << loadTablebases(tablebaseDirectory) << " endgame tablebases." << std::endl;
+
+	MatchStats stats;
+	std::string errorMsg;
+	TimePoint start = now();
+	bool success = runMatch(options, first, second, stats, [](const std::string& line) { std::cout << line << std::endl; }, errorMsg);
+	if (!success) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+
+	std::cout.setf(std::ios::fixed);
+	std::cout.precision(1);
+	std::cout << first.name << " vs " << second.name << ": " << stats.wins << " wins, " << stats.losses << " losses, "
+			  << stats.draws << " draws in " << stats.games() << " games (" << now() - start << " ms)" << std::endl;
+	std::cout << "Elo difference: " << stats.elo() << " +/- " << stats.eloMargin() << " (95%)" << std::endl;
+	if (options.sprt)
+		std::cout << "SPRT [" << options.elo0 << ", " << options.elo1 << "]: "
+				  << (stats.sprtResult > 0 ? "H1 accepted" : stats.sprtResult < 0 ? "H0 accepted" : "no decision") << std::endl;
+	if (!options.gamesDirectory.empty())
+		std::cout << stats.savedGames << " games saved into " << options.gamesDirectory << std::endl;
+	return 0;
+}
+
+// runTuner: argc, argv -> int
+// Tunes the weights of the classical evaluation on saved games as told by the command line:
+//		CLIChess tune game_files_or_directories... [-out file] [-weights file] [-epochs n]
+//					  [-rate r] [-skip plies] [-threads n] [-tb directory]
+// Returns the exit code of the program.
+int runTuner(int argc, char* argv[]) {
+	const std::string usage = "Usage: CLIChess tune game_files_or_directories... [-out file] [-weights file] [-epochs n]\n"
+							  "       [-rate r] [-skip plies] [-threads n] [-tb directory]";
+	TuneOptions options;
+	std::vector<std::string> gameFiles;
+	std::string outFile = "weights.txt", startFile, tablebaseDirectory;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-out" && hasValue)
+				outFile = argv[++i];
+			else if (arg == "-weights" && hasValue)
+				startFile = argv[++i];
+			else if (arg == "-epochs" && hasValue)
+				options.epochs = std::stoi(argv[++i]);
+			else if (arg == "-rate" && hasValue)
+				options.learningRate = std::stod(argv[++i]);
+			else if (arg == "-skip" && hasValue)
+				options.skipPlies = std::stoi(argv[++i]);
+			else if (arg == "-threads" && hasValue)
+				options.threads = std::stoi(argv[++i]);
+			else if (arg == "-tb" && hasValue)
+				tablebaseDirectory = argv[++i];
+			else if (arg[0] == '-') {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+			else
+				gameFiles.push_back(arg);
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	if (gameFiles.empty()) {
+		std::cout << usage << std::endl;
+		return 1;
+	}
+
+	std::string errorMsg;
+	if (!startFile.empty() && !loadEvalWeights(startFile, errorMsg)) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+	if (!tablebaseDirectory.empty())
+		std::cout << "Loaded " << loadTablebases(tablebaseDirectory) << " endgame tablebases." << std::endl;
+
+	EvalWeights weights = evalWeights;
+	TuneStats stats;
+	TimePoint start = now();
+	bool success = tuneEvaluation(gameFiles, options, weights, stats, [](const std::string& line) { std::cout << line << std::endl; }, errorMsg);
+
+	std::cout << "Games: " << stats.games << " (" << stats.badGames << " could not be replayed, "
+			  << stats.unknownResults << " of unknown result)" << std::endl;
+	if (!success || !saveEvalWeights(weights, outFile, errorMsg)) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+
+	std::cout << "Loss " << stats.initialLoss << " -> " << stats.finalLoss << " in " << now() - start
+			  << " ms. Weights written to " << outFile << std::endl;
+	return 0;
+}
+
+// runAnnotator: argc, argv -> int
+// Annotates saved games with the engine's analysis as told by the command line:
+//		CLIChess annotate game_files_or_directories... [-nodes n] [-threads n] [-hash mb]
+//						  [-mistake cp] [-blunder cp] [-out directory]
+// Returns the exit code of the program.
+int runAnnotator(int argc, char* argv[]) {
+	const std::string usage = "Usage: CLIChess annotate game_files_or_directories... [-nodes n] [-threads n] [-hash mb]\n"
+							  "       [-mistake cp] [-blunder cp] [-out directory]";
+	AnnotateOptions options;
+	std::vector<std::string> gameFiles;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-nodes" && hasValue)
+				options.nodes = std::stoull(argv[++i]);
+			else if (arg == "-threads" && hasValue)
+				options.threads = std::stoi(argv[++i]);
+			else if (arg == "-hash" && hasValue)
+				options.hashMB = size_t(std::stoul(argv[++i]));
+			else if (arg == "-mistake" && hasValue)
+				options.mistake = std::stoi(argv[++i]);
+			else if (arg == "-blunder" && hasValue)
+				options.blunder = std::stoi(argv[++i]);
+			else if (arg == "-out" && hasValue)
+				options.outDirectory = argv[++i];
+			else if (arg[0] == '-') {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+			else
+				gameFiles.push_back(arg);
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	if (gameFiles.empty()) {
+		std::cout << usage << std::endl;
+		return 1;
+	}
+
+	AnnotateStats stats;
+	std::string errorMsg;
+	TimePoint start = now();
+	bool success = annotateGames(gameFiles, options, stats, [](const std::string& line) { std::cout << line << std::endl; }, errorMsg);
+	if (!success) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+
+	TimePoint elapsed = (std::max)(now() - start, TimePoint(1));
+	std::cout << "Games: " << stats.games << " (" << stats.badGames << " could not be annotated), "
+			  << stats.mistakes << " mistakes and " << stats.blunders << " blunders found" << std::endl;
+	std::cout << "Positions: " << stats.positions << ", " << stats.nodes << " nodes in " << elapsed << " ms ("
+			  << stats.nodes * 1000 / elapsed << " nps)" << std::endl;
+	return 0;
+}
+
+// runPuzzleMiner: argc, argv -> int
+// Mines tactical puzzles from saved games as told by the command line:
+//		CLIChess puzzles puzzle_file game_files_or_directories... [-nodes n] [-threads n] [-hash mb]
+//						 [-skip plies] [-min cp] [-gap cp] [-matemoves n] [-matenodes n] [-plies n]
+// Returns the exit code of the program.
+int runPuzzleMiner(int argc, char* argv[]) {
+	const std::string usage = "Usage: CLIChess puzzles puzzle_file game_files_or_directories... [-nodes n] [-threads n] [-hash mb]\n"
+							  "       [-skip plies] [-min cp] [-gap cp] [-matemoves n] [-matenodes n] [-plies n]";
+	PuzzleOptions options;
+	std::vector<std::string> gameFiles;
+	std::string puzzleFile;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-nodes" && hasValue)
+				options.nodes = std::stoull(argv[++i]);
+			else if (arg == "-threads" && hasValue)
+				options.threads = std::stoi(argv[++i]);
+			else if (arg == "-hash" && hasValue)
+				options.hashMB = size_t(std::stoul(argv[++i]));
+			else if (arg == "-skip" && hasValue)
+				options.skipPlies = std::stoi(argv[++i]);
+			else if (arg == "-min" && hasValue)
+				options.minScore = std::stoi(argv[++i]);
+			else if (arg == "-gap" && hasValue)
+				options.gap = std::stoi(argv[++i]);
+			else if (arg == "-matemoves" && hasValue)
+				options.mateMoves = std::stoi(argv[++i]);
+			else if (arg == "-matenodes" && hasValue)
+				options.mateNodes = std::stoull(argv[++i]);
+			else if (arg == "-plies" && hasValue)
+				options.linePlies = std::stoi(argv[++i]);
+			else if (arg[0] == '-') {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+			else if (puzzleFile.empty())
+				puzzleFile = arg;
+			else
+				gameFiles.push_back(arg);
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	if (puzzleFile.empty() || gameFiles.empty()) {
+		std::cout << usage << std::endl;
+		return 1;
+	}
+
+	PuzzleStats stats;
+	std::string errorMsg;
+	TimePoint start = now();
+	bool success = minePuzzles(gameFiles, puzzleFile, options, stats, [](const std::string& line) { std::cout << line << std::endl; }, errorMsg);
+	if (!success) {
+		std::cout << errorMsg << std::endl;
+		return 1;
+	}
+
+	std::cout << "Games: " << stats.games << " (" << stats.badGames << " could not be fully replayed), "
+			  << stats.positions << " positions analysed in " << now() - start << " ms" << std::endl;
+	std::cout << "Puzzles: " << stats.puzzles << " (" << stats.mates << " mates), written to " << puzzleFile
+			  << "; " << stats.rejectedMates << " mates not verified" << std::endl;
+	return 0;
+}
+
+// runBenchCommand: argc, argv -> int
+// Runs the bench as told by the command line:
+//		CLIChess bench [-depth n] [-hash mb] [-options settings]
+// The settings switch off parts of the search like those of the match players:
+// "null=off,lmr=off,futility=off,rfp=off,checkext=off".
+// Returns the exit code of the program.
+int runBenchCommand(int argc, char* argv[]) {
+	const std::string usage = "Usage: CLIChess bench [-depth n] [-hash mb] [-options settings]";
+	int depth = defaultBenchDepth;
+	EngineConfig config;
+	config.hashMB = defaultBenchHashMB;
+
+	try {
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-depth" && hasValue)
+				depth = std::stoi(argv[++i]);
+			else if (arg == "-hash" && hasValue)
+				config.hashMB = size_t(std::stoul(argv[++i]));
+			else if (arg == "-options" && hasValue && parseEngineConfig(argv[++i], config))
+				continue;
+			else {
+				std::cout << usage << std::endl;
+				return 1;
+			}
+		}
+	}
+	catch (const std::logic_error& e) {
+		std::cout << "PARSE ERROR: Could not parse the number given to an option." << std::endl;
+		return 1;
+	}
+
+	BenchResult result = runBench(depth, config.hashMB, config.options, [](const std::string& line) { std::cout << line << std::endl; });
+	std::cout << benchReport(result, config.options) << std::endl;
+	return 0;
+}
+
+// startBackgroundSearch: Engine&, const GameManager&, bool -> void
+// Starts an infinite search of the current game position, which runs until it
+// is stopped. If showAnalysis is set, the depth, score and principal variation
+// of every completed iteration are printed as they come. Otherwise the engine
+// ponders quietly, filling its transposition table for the hints.
+void startBackgroundSearch(Engine& engine, const GameManager& gm, bool showAnalysis) {
+	Position pos;
+	pos.setFromFEN(gm.toFEN());
+
+	SearchLimits limits;
+	limits.infinite = true;
+
+	Engine::ResultCallback onIteration = nullptr;
+	if (showAnalysis)
+		onIteration = [pos](const SearchResult& result) {
+			std::cout << "\n[analysis] depth " << result.depth << "  " << formatScore(result.score)
+					  << "  " << lineToSAN(pos, result.pv) << std::flush;
+		};
+
+	engine.start(pos, limits, onIteration);
+}
+
+// hint: Engine&, Book&, const GameManager&, TimePoint, HintCache& -> string
+// Returns the best move for the player in turn, with its score and principal
+// variation, found within the given thinking time in milliseconds. In a position
+// of the opening book, the book move with the highest weight is given instead. If the
+// last hint searched the same position with at least the given thinking time, and the
+// transposition table still holds a result at least as deep as that search reached,
+// the answer is taken from the table without searching. Otherwise the position is
+// searched, and the search is remembered in the cache.
+std::string hint(Engine& engine, Book& book, const GameManager& gm, TimePoint budget, HintCache& cache) {
+	Position pos;
+	pos.setFromFEN(gm.toFEN());
+
+	Move bookMove = book.probe(pos, BookSelection::Best);
+	if (bookMove != noMove)
+		return "Hint for " + gm.inTurnPlayer() + ": " + moveToSAN(pos, bookMove) + " (book move)\n\n\n";
+
+	TimePoint start = now();
+	SearchResult result;
+	bool cached = cache.key == pos.key() && budget <= cache.budget &&
+				  engine.probeResult(pos, result) && result.depth >= cache.depth;
+	if (!cached) {
+		SearchLimits limits;
+		limits.moveTime = budget;
+		limits.startTime = start;
+		result = engine.think(pos, limits);
+		cache.key = pos.key();
+		cache.budget = budget;
+		cache.depth = result.depth;
+	}
+
+	if (result.bestMove == noMove)
+		return "No moves available.\n\n\n";
+
+	return "Hint for " + gm.inTurnPlayer() + ": " + moveToSAN(pos, result.bestMove) +
+		   " (" + formatScore(result.score) + ", depth " + std::to_string(result.depth) +
+		   ", " + std::to_string(now() - start) + " ms)\n" +
+		   "Line: " + lineToSAN(pos, result.pv) + "\n\n";
+}
+
+// bestMoves: Engine&, const GameManager&, count, TimePoint -> string
+// Returns the given number of best moves for the player in turn, best first, each
+// with its score and principal variation, found within the given thinking time in
+// milliseconds.
+std::string bestMoves(Engine& engine, const GameManager& gm, int count, TimePoint budget) {
+	Position pos;
+	pos.setFromFEN(gm.toFEN());
+
+	SearchLimits limits;
+	limits.moveTime = budget;
+	limits.multiPV = count;
+	SearchResult result = engine.think(pos, limits);
+
+	if (result.lines.empty())
+		return "No moves available.\n\n\n";
+
+	std::string msg = "Best moves for " + gm.inTurnPlayer() + " (depth " + std::to_string(result.depth) +
+					  ", " + std::to_string(result.nodes) + " nodes, " + std::to_string(now() - limits.startTime) + " ms):\n";
+	for (size_t i = 0; i < result.lines.size(); i++)
+		msg += std::to_string(i + 1) + ". " + formatScore(result.lines[i].score) + "  " +
+			   lineToSAN(pos, result.lines[i].pv) + "\n";
+
+	return msg + "\n";
+}
+
+// tablebaseVerdict: const GameManager& -> string
+// Returns the outcome of the game with the best play of both sides, if the position
+// is in the loaded endgame tablebases, or an empty string if not.
+std::string tablebaseVerdict(const GameManager& gm) {
+	if (!tablebasePieces())
+		return "";
+
+	Position pos;
+	pos.setFromFEN(gm.toFEN());
+	TBResult tb;
+	if (!probeTablebase(pos, tb))
+		return "";
+
+	if (tb.wdl > 0)
+		return "Tablebase: " + gm.inTurnPlayer() + " mates in " + std::to_string((tb.dtm + 1) / 2) + " moves.";
+	else if (tb.wdl < 0)
+		return "Tablebase: " + gm.inTurnPlayer() + " is mated in " + std::to_string(tb.dtm / 2) + " moves.";
+	else
+		return "Tablebase: the position is a draw.";
+}
+
+// mateReport: const Position&, const MateResult&, moves -> string
+// Describes the outcome of a mate search of the position within the given moves.
+std::string mateReport(const Position& pos, const MateResult& result, int maxMoves) {
+	if (result.status == MateStatus::Proven)
+		return "mate in " + std::to_string(result.moves) + ": " + lineToSAN(pos, result.line);
+	else if (result.status == MateStatus::Disproven)
+		return "no forced mate in " + std::to_string(maxMoves) + " moves";
+	else
+		return "no mate found within the node limit";
+}
+
 // promptForYesNo: prompt message -> bool
 // Prompts the user with the given prompt message
 // until the user enters either 'y' or 'n'.
@@ -283,6 +1231,17 @@ void printGameStartMenu() {
 	std::cout << "During a chess game you can also save the current game by giving the command \"s file\"" << std::endl;
 	std::cout << "For example: \"s mygame_1.chs\"" << std::endl;
 	std::cout << "\"t n\" during a game takes back n moves. Example: \"t 5\" takes back 5 moves." << std::endl;
+	std::cout << "\"hanging\" during a game lists the pieces that can be won by capturing them." << std::endl;
+	std::cout << "\"tb directory\" loads the endgame tablebases, which then tell the outcome of the game after every move." << std::endl;
+	std::cout << "\"book file\" opens an opening book, whose moves are then given as hints." << std::endl;
+	std::cout << "\"nnue file\" loads a network for the engine's evaluation." << std::endl;
+	std::cout << "\"h\" or \"h ms\" during a game suggests a move, thinking at most ms milliseconds (default " << defaultHintTime << ")." << std::endl;
+	std::cout << "\"multipv k [ms]\" during a game lists the k best moves, thinking at most ms milliseconds." << std::endl;
+	std::cout << "\"mate n [nodes]\" during a game looks for a forced mate in at most n moves." << std::endl;
+	std::cout << "\"mode mcts\" or \"mode alphabeta\" chooses the engine's search for the hints and the analysis for the rest of the game." << std::endl;
+	std::cout << "\"analyze\" toggles a live engine analysis of the position while you think." << std::endl;
+	std::cout << "\"ponder\" toggles quiet engine thinking while you think." << std::endl;
+	std::cout << "\"stats\" shows the time spent in each phase of making the moves, \"stats reset\" clears it." << std::endl;
 }
 
 void printQuitInfo() {
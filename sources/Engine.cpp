@@ -0,0 +1,237 @@
+#include <unordered_set>
+#include "Engine.h"
+#include "MoveGen.h"
+
+// Private methods:
+// -----------------------------
+
+// searchMain: void -> void
+// The body of the main search thread. Starts the helpers, runs the main search,
+// holds the result back while the search is infinite or pondering, then stops the
+// helpers and reports the result. The Monte Carlo search runs its threads itself.
+void Engine::searchMain() {
+	std::vector<std::thread> helpers;
+	SearchResult result;
+
+	if (mode == SearchMode::MonteCarlo)
+		result = monteCarlo.run(rootPos, limits, int(searches.size()));
+	else {
+		for (size_t i = 1; i < searches.size(); i++)
+			helpers.emplace_back([this, i] { searches[i]->run(rootPos, limits); });
+		result = searches[0]->run(rootPos, limits);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stateChanged.wait(lock, [this] { return stopRequested || (!limits.infinite && !pondering); });
+	}
+
+	for (size_t i = 1; i < searches.size(); i++)
+		searches[i]->stop();
+	for (std::thread& t : helpers)
+		t.join();
+
+	result.nodes = nodes();
+	lastResult = result;
+	if (onBestMove)
+		onBestMove(result);
+
+	// A stop that arrived after the searches had already finished must not
+	// carry over to the next search:
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::unique_ptr<Search>& s : searches)
+		s->prepare(SearchLimits());
+	monteCarlo.prepare(SearchLimits());
+	searching = false;
+}
+
+// Public methods:
+// -----------------------------
+
+Engine::Engine() {
+	searching = stopRequested = pondering = false;
+	mode = SearchMode::AlphaBeta;
+	searches.emplace_back(new Search(tt));
+}
+
+Engine::~Engine() {
+	stop();
+	wait();
+}
+
+// setHashSize: megabytes -> void
+// Resizes the transposition table, which also clears it.
+void Engine::setHashSize(size_t megabytes) {
+	wait();
+	tt.resize(megabytes);
+}
+
+// setThreads: count -> void
+// Sets the number of search threads, including the main thread.
+void Engine::setThreads(int count) {
+	wait();
+	size_t n = size_t(count < 1 ? 1 : count);
+	SearchOptions options = searches[0]->options;
+
+	while (searches.size() > n)
+		searches.pop_back();
+	while (searches.size() < n) {
+		searches.emplace_back(new Search(tt));
+		searches.back()->options = options;
+	}
+}
+
+void Engine::setSearchOptions(const SearchOptions& options) {
+	wait();
+	for (std::unique_ptr<Search>& s : searches)
+		s->options = options;
+}
+
+// setSearchMode: SearchMode -> void
+// Chooses the search algorithm for the following searches.
+void Engine::setSearchMode(SearchMode _mode) {
+	wait();
+	mode = _mode;
+}
+
+// newGame: void -> void
+// Forgets everything learned in the previous game.
+void Engine::newGame() {
+	wait();
+	tt.clear();
+	for (std::unique_ptr<Search>& s : searches)
+		s->clearHistory();
+}
+
+// start: const Position&, const SearchLimits&, ResultCallback, ResultCallback -> void
+// Starts searching the position on the background thread and returns immediately.
+// onIteration is called after every completed iteration and onBestMove once the search
+// has ended, both on the search thread.
+void Engine::start(const Position& pos, const SearchLimits& _limits, ResultCallback onIteration, ResultCallback _onBestMove) {
+	wait();
+
+	rootPos = pos;
+	limits = _limits;
+	onBestMove = _onBestMove;
+	searches[0]->onIteration = onIteration;
+	monteCarlo.onIteration = onIteration;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		searching = true;
+		stopRequested = false;
+		pondering = limits.ponder;
+		for (std::unique_ptr<Search>& s : searches)
+			s->prepare(limits);
+		monteCarlo.prepare(limits);
+	}
+
+	mainThread = std::thread(&Engine::searchMain, this);
+}
+
+// think: const Position&, const SearchLimits&, ResultCallback -> SearchResult
+// Searches the position and waits for the result.
+SearchResult Engine::think(const Position& pos, const SearchLimits& limits, ResultCallback onIteration) {
+	start(pos, limits, onIteration);
+	wait();
+	return lastResult;
+}
+
+// probeResult: const Position&, SearchResult& -> bool
+// Looks up the result of an earlier search of the position from the transposition
+// table without searching. Succeeds if the table holds an exact score and a move for
+// the position; the principal variation is followed through the table for as long as
+// its moves are legal and no position repeats. Must not be called while searching.
+bool Engine::probeResult(const Position& pos, SearchResult& result) {
+	wait();
+
+	TTEntry tte;
+	if (!tt.probe(pos.key(), tte) || tte.bound() != ExactBound || tte.move == noMove)
+		return false;
+
+	result = SearchResult();
+	result.score = scoreFromTT(tte.score, 0);
+	result.depth = tte.depth;
+
+	Position p = pos;
+	std::unordered_set<Key> seen;
+	while (int(result.pv.size()) < result.depth && seen.insert(p.key()).second) {
+		TTEntry entry;
+		if (!tt.probe(p.key(), entry) || entry.move == noMove)
+			break;
+
+		bool legal = false;
+		for (const ScoredMove& sm : MoveList(p))
+			legal |= sm.move == entry.move;
+		if (!legal)
+			break;
+
+		result.pv.push_back(entry.move);
+		p.makeMove(entry.move);
+	}
+
+	if (result.pv.empty())
+		return false;
+
+	result.bestMove = result.pv[0];
+	return true;
+}
+
+// stop: void -> void
+// Stops the running search, if any. Safe to call from any thread except the
+// search thread itself.
+void Engine::stop() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!searching)
+		return;
+
+	stopRequested = true;
+	for (std::unique_ptr<Search>& s : searches)
+		s->stop();
+	monteCarlo.stop();
+	stateChanged.notify_all();
+}
+
+// ponderhit: void -> void
+// The opponent played the expected move: the ponder search goes on as a normal,
+// timed search.
+void Engine::ponderhit() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!searching || !pondering)
+		return;
+
+	pondering = false;
+	for (std::unique_ptr<Search>& s : searches)
+		s->ponderhit();
+	monteCarlo.ponderhit();
+	stateChanged.notify_all();
+}
+
+// wait: void -> void
+// Waits until the running search, if any, has ended and reported its result.
+void Engine::wait() {
+	if (mainThread.joinable())
+		mainThread.join();
+}
+
+bool Engine::isSearching() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return searching;
+}
+
+// nodes: void -> uint64_t
+// Returns the nodes searched so far by all the threads, or the playouts made in the
+// Monte Carlo mode.
+uint64_t Engine::nodes() const {
+	if (mode == SearchMode::MonteCarlo)
+		return monteCarlo.nodeCount();
+
+	uint64_t total = 0;
+	for (const std::unique_ptr<Search>& s : searches)
+		total += s->nodeCount();
+	return total;
+}
+
+TimePoint Engine::elapsed() const {
+	return mode == SearchMode::MonteCarlo ? monteCarlo.time().elapsed() : searches[0]->time().elapsed();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MonteCarloSearch.h"
+#include "Position.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+
+// SearchMode chooses the search algorithm of the engine:
+enum class SearchMode { AlphaBeta, MonteCarlo };
+
+// Engine:
+// Runs searches on a background thread, so that the caller stays free to read
+// input and to stop the search at any time.
+//
+// With more than one thread, helper threads search the same position alongside the
+// main search and share the transposition table with it ("lazy SMP"). Only the main
+// search reports its progress and result. In the Monte Carlo mode, the threads build
+// one search tree together instead.
+//
+// In the infinite and ponder modes the result is held back until stop() (or, when
+// pondering, ponderhit()) is called, even if the search itself ends earlier.
+class Engine
+{
+public:
+	typedef std::function<void(const SearchResult&)> ResultCallback;
+
+private:
+	TranspositionTable tt;
+	std::vector<std::unique_ptr<Search>> searches;		// searches[0] is the main search.
+	MonteCarloSearch monteCarlo;
+	SearchMode mode;
+	std::thread mainThread;
+
+	// The state shared with the search thread, guarded by the mutex:
+	std::mutex mutex;
+	std::condition_variable stateChanged;
+	bool searching;
+	bool stopRequested;
+	bool pondering;
+
+	Position rootPos;
+	SearchLimits limits;
+	ResultCallback onBestMove;
+	SearchResult lastResult;
+
+	void searchMain();
+
+public:
+	Engine();
+	~Engine();
+
+	void setHashSize(size_t megabytes);
+	void setThreads(int count);
+	int threadCount() const { return int(searches.size()); }
+	void setSearchOptions(const SearchOptions& options);
+	void setSearchMode(SearchMode mode);
+	SearchMode searchMode() const { return mode; }
+	void newGame();
+
+	void start(const Position& pos, const SearchLimits& limits,
+			   ResultCallback onIteration = nullptr, ResultCallback onBestMove = nullptr);
+	SearchResult think(const Position& pos, const SearchLimits& limits, ResultCallback onIteration = nullptr);
+	bool probeResult(const Position& pos, SearchResult& result);
+	void stop();
+	void ponderhit();
+	void wait();
+	bool isSearching();
+
+	uint64_t nodes() const;
+	TimePoint elapsed() const;
+	TranspositionTable& table() { return tt; }
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+
+// The datastructures and constants below are shared by every part of the chess engine.
+//
+// Unlike the GameManager, which models the game with piece objects and move strings,
+// the engine works on plain integers and bitboards in order to be able to examine
+// millions of positions per second.
+//
+// NOTE:
+// The engine is fixed to the standard 8x8 board and does not follow the fileLim
+// and rankLim constants defined in CLIChessDefinitions.h.
+
+typedef uint64_t Bitboard;
+typedef uint64_t Key;
+
+enum Color { White, Black, NoColor };
+enum PieceType { PawnType, KnightType, BishopType, RookType, QueenType, KingType, NoPieceType };
+
+inline Color operator~(Color c) { return Color(c ^ 1); }
+
+// A piece combines a colour and a type: white pieces are 0-5 and black pieces 6-11.
+const int pieceCodes = 12;
+const int noPiece = 12;
+
+inline int makePiece(Color c, PieceType pt) { return c * 6 + pt; }
+inline Color pieceColor(int piece) { return Color(piece / 6); }
+inline PieceType pieceType(int piece) { return PieceType(piece % 6); }
+
+// Squares are numbered from a1 (0) to h8 (63) rank by rank, so that the file and rank
+// of a square match the (file, rank) pairs of the SquareCoords used by the GameManager.
+const int noSquare = 64;
+
+inline int makeSquare(int file, int rank) { return rank * 8 + file; }
+inline int fileOf(int sq) { return sq & 7; }
+inline int rankOf(int sq) { return sq >> 3; }
+// relativeRank: Color, rank -> rank
+// Returns the rank as seen from the given side: rank 0 is always the side's own back rank.
+inline int relativeRank(Color c, int rank) { return c == White ? rank : 7 - rank; }
+inline int relativeSquare(Color c, int sq) { return c == White ? sq : sq ^ 56; }
+
+// Castling rights are stored as a set of bit flags:
+enum CastlingRight { WhiteOO = 1, WhiteOOO = 2, BlackOO = 4, BlackOOO = 8, AnyCastling = 15 };
+
+// Move packs a move into 16 bits:
+//   bits  0-5:  source square
+//   bits  6-11: destination square
+//   bits 12-13: promotion piece (knight, bishop, rook or queen)
+//   bits 14-15: the move kind
+//
+// Castling is encoded as the king's move (e1g1, e1c1, e8g8 or e8c8).
+typedef uint16_t Move;
+enum MoveKind { NormalMove = 0, PromotionMove = 1 << 14, EnPassantMove = 2 << 14, CastlingMove = 3 << 14 };
+
+// Neither of these can ever be a real move since their source and destination squares are the same:
+const Move noMove = 0;
+const Move nullMove = 65;
+
+inline Move encodeMove(int from, int to, MoveKind kind = NormalMove, PieceType promo = KnightType) {
+	return Move(from | (to << 6) | ((promo - KnightType) << 12) | kind);
+}
+inline int moveFrom(Move m) { return m & 63; }
+inline int moveTo(Move m) { return (m >> 6) & 63; }
+inline MoveKind moveKind(Move m) { return MoveKind(m & (3 << 14)); }
+inline PieceType promotionType(Move m) { return PieceType(((m >> 12) & 3) + KnightType); }
+
+// ScoredMove is used by the move generator and the move ordering:
+struct ScoredMove {
+	Move move;
+	int score;
+};
+
+// Search related limits and scores. Scores are always given in centipawns
+// from the point of view of the side to move.
+const int maxPly = 128;
+const int maxMoves = 256;
+const int drawScore = 0;
+const int mateScore = 32000;
+const int infiniteScore = 32001;
+const int mateBound = mateScore - maxPly;	// Any score beyond mateBound is a forced mate.
+
+inline int mateIn(int ply) { return mateScore - ply; }
+inline int matedIn(int ply) { return -mateScore + ply; }
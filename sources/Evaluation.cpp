@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "Evaluation.h"
+#include "Position.h"
+#include "Material.h"
+#include "NNUE.h"
+#include "Pawns.h"
+
+namespace {
+
+	// The hand-written piece-square tables, the defaults of the weights.
+	// The tables are written from White's point of view the way a board is printed,
+	// rank 8 first. Each piece has a middlegame (mg) and an endgame (eg) table,
+	// which are blended according to the remaining material.
+	const int mgTable[6][64] = {
+		{	// Pawn
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			 50,  50,  50,  50,  50,  50,  50,  50,
+			 10,  10,  20,  30,  30,  20,  10,  10,
+			  5,   5,  10,  25,  25,  10,   5,   5,
+			  0,   0,   0,  20,  20,   0,   0,   0,
+			  5,  -5, -10,   0,   0, -10,  -5,   5,
+			  5,  10,  10, -20, -20,  10,  10,   5,
+			  0,   0,   0,   0,   0,   0,   0,   0 },
+		{	// Knight
+			-50, -40, -30, -30, -30, -30, -40, -50,
+			-40, -20,   0,   0,   0,   0, -20, -40,
+			-30,   0,  10,  15,  15,  10,   0, -30,
+			-30,   5,  15,  20,  20,  15,   5, -30,
+			-30,   0,  15,  20,  20,  15,   0, -30,
+			-30,   5,  10,  15,  15,  10,   5, -30,
+			-40, -20,   0,   5,   5,   0, -20, -40,
+			-50, -40, -30, -30, -30, -30, -40, -50 },
+		{	// Bishop
+			-20, -10, -10, -10, -10, -10, -10, -20,
+			-10,   0,   0,   0,   0,   0,   0, -10,
+			-10,   0,   5,  10,  10,   5,   0, -10,
+			-10,   5,   5,  10,  10,   5,   5, -10,
+			-10,   0,  10,  10,  10,  10,   0, -10,
+			-10,  10,  10,  10,  10,  10,  10, -10,
+			-10,   5,   0,   0,   0,   0,   5, -10,
+			-20, -10, -10, -10, -10, -10, -10, -20 },
+		{	// Rook
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  5,  10,  10,  10,  10,  10,  10,   5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			  0,   0,   0,   5,   5,   0,   0,   0 },
+		{	// Queen
+			-20, -10, -10,  -5,  -5, -10, -10, -20,
+			-10,   0,   0,   0,   0,   0,   0, -10,
+			-10,   0,   5,   5,   5,   5,   0, -10,
+			 -5,   0,   5,   5,   5,   5,   0,  -5,
+			  0,   0,   5,   5,   5,   5,   0,  -5,
+			-10,   5,   5,   5,   5,   5,   0, -10,
+			-10,   0,   5,   0,   0,   0,   0, -10,
+			-20, -10, -10,  -5,  -5, -10, -10, -20 },
+		{	// King
+			-30, -40, -40, -50, -50, -40, -40, -30,
+			-30, -40, -40, -50, -50, -40, -40, -30,
+			-30, -40, -40, -50, -50, -40, -40, -30,
+			-30, -40, -40, -50, -50, -40, -40, -30,
+			-20, -30, -30, -40, -40, -30, -30, -20,
+			-10, -20, -20, -20, -20, -20, -20, -10,
+			 20,  20,   0,   0,   0,   0,  20,  20,
+			 20,  30,  10,   0,   0,  10,  30,  20 }
+	};
+
+	const int egTable[6][64] = {
+		{	// Pawn
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			 80,  80,  80,  80,  80,  80,  80,  80,
+			 50,  50,  50,  50,  50,  50,  50,  50,
+			 30,  30,  30,  30,  30,  30,  30,  30,
+			 15,  15,  15,  15,  15,  15,  15,  15,
+			  5,   5,   5,   5,   5,   5,   5,   5,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0 },
+		{	// Knight
+			-50, -40, -30, -30, -30, -30, -40, -50,
+			-40, -20,   0,   0,   0,   0, -20, -40,
+			-30,   0,  10,  15,  15,  10,   0, -30,
+			-30,   5,  15,  20,  20,  15,   5, -30,
+			-30,   0,  15,  20,  20,  15,   0, -30,
+			-30,   5,  10,  15,  15,  10,   5, -30,
+			-40, -20,   0,   5,   5,   0, -20, -40,
+			-50, -40, -30, -30, -30, -30, -40, -50 },
+		{	// Bishop
+			-20, -10, -10, -10, -10, -10, -10, -20,
+			-10,   0,   0,   0,   0,   0,   0, -10,
+			-10,   0,   5,  10,  10,   5,   0, -10,
+			-10,   5,   5,  10,  10,   5,   5, -10,
+			-10,   0,  10,  10,  10,  10,   0, -10,
+			-10,  10,  10,  10,  10,  10,  10, -10,
+			-10,   5,   0,   0,   0,   0,   5, -10,
+			-20, -10, -10, -10, -10, -10, -10, -20 },
+		{	// Rook
+			  5,   5,   5,   5,   5,   5,   5,   5,
+			  5,   5,   5,   5,   5,   5,   5,   5,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0,
+			  0,   0,   0,   0,   0,   0,   0,   0 },
+		{	// Queen
+			-10,  -5,  -5,  -5,  -5,  -5,  -5, -10,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			 -5,   0,   5,   5,   5,   5,   0,  -5,
+			 -5,   0,   5,  10,  10,   5,   0,  -5,
+			 -5,   0,   5,  10,  10,   5,   0,  -5,
+			 -5,   0,   5,   5,   5,   5,   0,  -5,
+			 -5,   0,   0,   0,   0,   0,   0,  -5,
+			-10,  -5,  -5,  -5,  -5,  -5,  -5, -10 },
+		{	// King
+			-50, -40, -30, -20, -20, -30, -40, -50,
+			-30, -20, -10,   0,   0, -10, -20, -30,
+			-30, -10,  20,  30,  30,  20, -10, -30,
+			-30, -10,  30,  40,  40,  30, -10, -30,
+			-30, -10,  30,  40,  40,  30, -10, -30,
+			-30, -10,  20,  30,  30,  20, -10, -30,
+			-30, -30,   0,   0,   0,   0, -30, -30,
+			-50, -30, -30, -30, -30, -30, -30, -50 }
+	};
+
+	const int egPieceValue[6] = { 120, 300, 320, 540, 950, 0 };
+
+	// evaluatePieces: const Position&, mg[2], eg[2], EvalTrace* -> void
+	// Adds the material and the piece-square values of the pieces to their sides' scores.
+	void evaluatePieces(const Position& pos, int mg[2], int eg[2], EvalTrace* trace) {
+		for (Bitboard b = pos.pieces(); b; ) {
+			int sq = popLsb(b);
+			int piece = pos.pieceOn(sq);
+			Color c = pieceColor(piece);
+			PieceType pt = pieceType(piece);
+			// The tables are printed rank 8 first, so White's squares are mirrored:
+			int idx = c == White ? sq ^ 56 : sq;
+
+			addTerm(mg[c], eg[c], evalWeights.material[pt], 1, c, trace);
+			addTerm(mg[c], eg[c], evalWeights.pst[pt][idx], 1, c, trace);
+		}
+	}
+
+	// taper: mg, eg, const MaterialEntry&, EvalTrace* -> int
+	// Blends the middlegame and endgame scores by the game phase, after scaling down the
+	// endgame score of a side that is ahead without the means to win.
+	int taper(int mg, int eg, const MaterialEntry& me, EvalTrace* trace) {
+		int scale = me.scale[eg > 0 ? White : Black];
+		if (trace) {
+			trace->phase = me.phase;
+			trace->scale = scale;
+		}
+
+		eg = eg * scale / scaleNormal;
+		return (mg * me.phase + eg * (maxPhase - me.phase)) / maxPhase;
+	}
+}
+
+EvalWeights evalWeights;
+int evalWeightsVersion = 0;
+
+EvalWeights::EvalWeights() {
+	const int passedMg[8] = { 0, 5, 10, 15, 25, 40, 60, 0 };
+	const int passedEg[8] = { 0, 10, 15, 25, 45, 75, 120, 0 };
+
+	for (int pt = PawnType; pt <= KingType; pt++) {
+		material[pt] = EvalTerm{ pieceValue[pt], egPieceValue[pt] };
+		for (int sq = 0; sq < 64; sq++)
+			pst[pt][sq] = EvalTerm{ mgTable[pt][sq], egTable[pt][sq] };
+	}
+
+	doubled = EvalTerm{ -10, -20 };
+	isolated = EvalTerm{ -10, -15 };
+	backward = EvalTerm{ -8, -12 };
+	for (int r = 0; r < 8; r++)
+		passed[r] = EvalTerm{ passedMg[r], passedEg[r] };
+
+	// The pawn shield counts in the middlegame only:
+	shieldNear = EvalTerm{ 15, 0 };
+	shieldFar = EvalTerm{ 8, 0 };
+	shieldMissing = EvalTerm{ -15, 0 };
+
+	bishopPair = EvalTerm{ 40, 40 };
+	knightPerPawn = EvalTerm{ 6, 6 };
+	rookPerPawn = EvalTerm{ -12, -12 };
+}
+
+int evaluate(Position& pos, PawnTable& pawns, MaterialTable& material) {
+	if (networkLoaded())
+		return evaluateNNUE(pos);
+	return evaluateClassical(pos, pawns, material);
+}
+
+int evaluateClassical(const Position& pos, PawnTable& pawns, MaterialTable& material) {
+	// The game phase, the imbalance and the scale factors depend on the material alone:
+	MaterialEntry& me = material.probe(pos);
+	if (me.draw)
+		return 0;
+
+	int mg[2] = { 0, 0 };
+	int eg[2] = { 0, 0 };
+	evaluatePieces(pos, mg, eg, nullptr);
+
+	// The pawn structure and the kings' pawn shields, from the pawn table:
+	PawnEntry& pe = pawns.probe(pos);
+	EvalTerm whiteShelter = pawns.shelter(pos, pe, White);
+	EvalTerm blackShelter = pawns.shelter(pos, pe, Black);
+
+	int mgScore = mg[White] - mg[Black] + pe.mg + me.imbalanceMg + whiteShelter.mg - blackShelter.mg;
+	int egScore = eg[White] - eg[Black] + pe.eg + me.imbalanceEg + whiteShelter.eg - blackShelter.eg;
+	int score = taper(mgScore, egScore, me, nullptr);
+
+	return pos.sideToMove() == White ? score : -score;
+}
+
+bool traceEvaluation(const Position& pos, EvalTrace& trace) {
+	std::fill(trace.count, trace.count + evalTermCount, 0);
+
+	int counts[pieceCodes];
+	for (int piece = 0; piece < pieceCodes; piece++)
+		counts[piece] = popCount(pos.pieces(pieceColor(piece), pieceType(piece)));
+	MaterialEntry me;
+	evaluateMaterial(counts, me, &trace);
+	if (me.draw)
+		return false;
+
+	int mg[2] = { 0, 0 };
+	int eg[2] = { 0, 0 };
+	evaluatePieces(pos, mg, eg, &trace);
+
+	PawnEntry pe;
+	evaluatePawns(pos, pe, &trace);
+	EvalTerm whiteShelter = kingShelter(pos, White, &trace);
+	EvalTerm blackShelter = kingShelter(pos, Black, &trace);
+
+	int mgScore = mg[White] - mg[Black] + pe.mg + me.imbalanceMg + whiteShelter.mg - blackShelter.mg;
+	int egScore = eg[White] - eg[Black] + pe.eg + me.imbalanceEg + whiteShelter.eg - blackShelter.eg;
+	taper(mgScore, egScore, me, &trace);
+	return true;
+}
+
+std::string evalTermName(int index) {
+	static const char* pieceNames[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+	const EvalWeights& w = evalWeights;
+	const EvalTerm* term = &w[index];
+
+	if (term < &w.pst[0][0])
+		return std::string("material.") + pieceNames[index];
+	if (term < &w.doubled) {
+		int i = int(term - &w.pst[0][0]);
+		int sq = i % 64;
+		return std::string("pst.") + pieceNames[i / 64] + "." + char('a' + sq % 8) + char('8' - sq / 8);
+	}
+	if (term >= &w.passed[0] && term < &w.passed[8])
+		return "passed.rank" + std::to_string(term - &w.passed[0] + 1);
+
+	static const std::pair<const EvalTerm EvalWeights::*, const char*> named[] = {
+		{ &EvalWeights::doubled, "doubled" }, { &EvalWeights::isolated, "isolated" }, { &EvalWeights::backward, "backward" },
+		{ &EvalWeights::shieldNear, "shield.near" }, { &EvalWeights::shieldFar, "shield.far" }, { &EvalWeights::shieldMissing, "shield.missing" },
+		{ &EvalWeights::bishopPair, "imbalance.bishoppair" }, { &EvalWeights::knightPerPawn, "imbalance.knightperpawn" },
+		{ &EvalWeights::rookPerPawn, "imbalance.rookperpawn" }
+	};
+	for (const auto& n : named)
+		if (term == &(w.*n.first))
+			return n.second;
+	return "";
+}
+
+void setEvalWeights(const EvalWeights& weights) {
+	evalWeights = weights;
+	evalWeightsVersion++;
+}
+
+bool loadEvalWeights(const std::string& fileName, std::string& errorMsg) {
+	std::ifstream in(fileName);
+	if (!in.is_open()) {
+		errorMsg = "WEIGHTS ERROR: could not open the file " + fileName;
+		return false;
+	}
+
+	std::map<std::string, int> indexOf;
+	for (int i = 0; i < evalTermCount; i++)
+		indexOf[evalTermName(i)] = i;
+
+	EvalWeights weights;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string name;
+		EvalTerm term;
+		if (!(fields >> name) || name[0] == '#')
+			continue;
+
+		auto found = indexOf.find(name);
+		if (found == indexOf.end() || !(fields >> term.mg >> term.eg)) {
+			errorMsg = "WEIGHTS ERROR: [" + line + "]: not a known term with its two values";
+			return false;
+		}
+		weights[found->second] = term;
+	}
+
+	setEvalWeights(weights);
+	return true;
+}
+
+bool saveEvalWeights(const EvalWeights& weights, const std::string& fileName, std::string& errorMsg) {
+	std::ofstream out(fileName, std::ios::trunc);
+	for (int i = 0; i < evalTermCount; i++)
+		out << evalTermName(i) << " " << weights[i].mg << " " << weights[i].eg << "\n";
+
+	out.close();
+	if (out.fail()) {
+		errorMsg = "WEIGHTS ERROR: could not write the file " + fileName;
+		return false;
+	}
+	return true;
+}
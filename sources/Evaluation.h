@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include "EngineDefinitions.h"
+
+class Position;
+class PawnTable;
+class MaterialTable;
+
+// Piece values in centipawns, indexed by PieceType.
+// Besides the evaluation, they are used for ordering captures.
+const int pieceValue[7] = { 100, 320, 330, 500, 900, 0, 0 };
+
+// EvalTerm is one weight of the classical evaluation: its value in the middlegame and in
+// the endgame, in centipawns. The evaluation blends the two by the game phase.
+struct EvalTerm {
+	int mg, eg;
+};
+
+// EvalWeights holds all the weights of the classical evaluation. They start out as the
+// hand-written values and can be replaced by tuned ones loaded from a file (see the
+// tuner in Tuner.h). A penalty has negative values.
+struct EvalWeights {
+	EvalTerm material[6];
+	EvalTerm pst[6][64];			// Written from White's point of view the way a board is printed, a8 first.
+	EvalTerm doubled, isolated, backward;
+	EvalTerm passed[8];				// By the rank seen from the pawn's side.
+	EvalTerm shieldNear, shieldFar, shieldMissing;
+	EvalTerm bishopPair, knightPerPawn, rookPerPawn;
+
+	EvalWeights();
+
+	EvalTerm& operator[](int index) { return reinterpret_cast<EvalTerm*>(this)[index]; }
+	const EvalTerm& operator[](int index) const { return reinterpret_cast<const EvalTerm*>(this)[index]; }
+};
+
+const int evalTermCount = int(sizeof(EvalWeights) / sizeof(EvalTerm));
+
+// The weights in use. Changed only with setEvalWeights and loadEvalWeights, which must not
+// be called during a search. The pawn and material tables hold scores worked out with the
+// weights, so they are told of the change by evalWeightsVersion.
+extern EvalWeights evalWeights;
+extern int evalWeightsVersion;
+
+// EvalTrace records, for the tuner, how the classical evaluation of a position is made up:
+// how many times each term counts for White less how many times it counts for Black, the
+// game phase, and the scale factor applied to the endgame score.
+struct EvalTrace {
+	int count[evalTermCount];
+	int phase;
+	int scale;
+};
+
+// addTerm: int&, int&, const EvalTerm&, count, Color, EvalTrace* -> void
+// Adds count times the term of the weights in use to the side's scores, and records it
+// in the trace if there is one.
+inline void addTerm(int& mg, int& eg, const EvalTerm& term, int count, Color c, EvalTrace* trace) {
+	mg += count * term.mg;
+	eg += count * term.eg;
+	if (trace)
+		trace->count[&term - &evalWeights[0]] += c == White ? count : -count;
+}
+
+// evaluate: Position&, PawnTable&, MaterialTable& -> int
+// Returns the static evaluation of the position in centipawns from the side to move's
+// point of view. Uses the NNUE network if one has been loaded, and the classical
+// evaluation, with the caller's pawn and material tables, otherwise.
+int evaluate(Position& pos, PawnTable& pawns, MaterialTable& material);
+
+// evaluateClassical: const Position&, PawnTable&, MaterialTable& -> int
+// The hand-written evaluation: material, tapered piece-square tables and the pawn
+// structure terms kept in the pawn table (see Pawns.h).
+int evaluateClassical(const Position& pos, PawnTable& pawns, MaterialTable& material);
+
+// traceEvaluation: const Position&, EvalTrace& -> bool
+// Works out the classical evaluation of the position into the trace, without the pawn and
+// material tables. Returns false for the positions known to be drawn, which the evaluation
+// scores as 0 whatever the weights.
+bool traceEvaluation(const Position& pos, EvalTrace& trace);
+
+// evalTermName: index -> std::string
+// Returns the name of the term in the weights files, like "pst.knight.e4" or "passed.rank6".
+std::string evalTermName(int index);
+
+// setEvalWeights: const EvalWeights& -> void
+// loadEvalWeights: file name, error message -> bool
+// saveEvalWeights: const EvalWeights&, file name, error message -> bool
+// The weights files are text, one term per line: its name and its middlegame and endgame
+// values. A file may leave terms out; they keep their hand-written values. Loading or
+// saving returns false, with the reason in errorMsg, if the file cannot be read or written
+// or has a line that is not understood.
+void setEvalWeights(const EvalWeights& weights);
+bool loadEvalWeights(const std::string& fileName, std::string& errorMsg);
+bool saveEvalWeights(const EvalWeights& weights, const std::string& fileName, std::string& errorMsg);
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "GameFiles.h"
+#include "Notation.h"
+#include "Position.h"
+
+std::vector<std::string> savedGameFiles(const std::vector<std::string>& paths) {
+	std::vector<std::string> files;
+
+	for (const std::string& path : paths) {
+		std::error_code ec;
+		if (std::filesystem::is_directory(path, ec)) {
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec))
+				if (entry.is_regular_file() && entry.path().extension() == ".clc")
+					files.push_back(entry.path().string());
+		}
+		else
+			files.push_back(path);
+	}
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+SavedGameStream::SavedGameStream(const std::vector<std::string>& paths) : paths(paths), nextPath(0) {}
+
+// next: file -> bool
+// Gives the next file, or returns false once there are no more.
+bool SavedGameStream::next(std::string& file) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::error_code ec;
+
+	while (true) {
+		for (; directory != std::filesystem::recursive_directory_iterator(); directory.increment(ec)) {
+			if (ec)
+				break;
+			if (directory->is_regular_file(ec) && directory->path().extension() == ".clc") {
+				file = directory->path().string();
+				directory.increment(ec);
+				if (ec)
+					directory = std::filesystem::recursive_directory_iterator();
+				return true;
+			}
+		}
+		directory = std::filesystem::recursive_directory_iterator();
+
+		if (nextPath == paths.size())
+			return false;
+
+		const std::string& path = paths[nextPath++];
+		if (!std::filesystem::is_directory(path, ec)) {
+			file = path;
+			return true;
+		}
+		directory = std::filesystem::recursive_directory_iterator(path, ec);
+	}
+}
+
+bool readSavedGame(const std::string& fileName, std::vector<Move>& moves, int maxPlies) {
+	std::ifstream in(fileName);
+	Position pos;
+	pos.setFromFEN(Position::startFEN);
+	moves.clear();
+
+	if (!in.is_open())
+		return false;
+
+	std::string token;
+	while ((maxPlies == 0 || int(moves.size()) < maxPlies) && in >> token) {
+		// Skip the move numbers ("12.") of the numbered format:
+		if (token.back() == '.' && token.find_first_not_of("0123456789.") == std::string::npos)
+			continue;
+
+		Move m = moveFromSAN(pos, token);
+		if (m == noMove)
+			return false;
+
+		moves.push_back(m);
+		pos.makeMove(m);
+	}
+
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "EngineDefinitions.h"
+
+// savedGameFiles: paths -> std::vector<std::string>
+// Returns the given files and the .clc files found under the given directories, sorted.
+std::vector<std::string> savedGameFiles(const std::vector<std::string>& paths);
+
+// SavedGameStream:
+// Hands out the same files as savedGameFiles, one at a time and unsorted, walking the
+// directories only as far as the files have been asked for. Archives of any size are thus
+// gone through without listing them first. The stream may be shared by threads.
+class SavedGameStream
+{
+private:
+	std::mutex mutex;
+	std::vector<std::string> paths;
+	size_t nextPath;
+	std::filesystem::recursive_directory_iterator directory;	// The end iterator when not in a directory.
+
+public:
+	explicit SavedGameStream(const std::vector<std::string>& paths);
+	bool next(std::string& file);
+};
+
+// readSavedGame: file name, moves, max plies -> bool
+// Replays the game saved in the file (in either of the formats written by GameManager::save:
+// one move per line, or the numbered move lines of a finished game) from the initial
+// position, collecting its first maxPlies moves (all of them if maxPlies is 0). Returns
+// false if the file cannot be read or a move cannot be replayed; the moves before it are
+// still collected.
+bool readSavedGame(const std::string& fileName, std::vector<Move>& moves, int maxPlies = 0);
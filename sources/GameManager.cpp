@@ -1,8 +1,13 @@
 #include <Windows.h>
 #include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <fstream>
 #include "GameManager.h"
+#include "Material.h"
+#include "MoveStats.h"
+#include "Position.h"
+#include "SEE.h"
 
 // Private methods:
 // -----------------------------
@@ -21,6 +26,8 @@ void GameManager::initGame() {
 	// 2. Clear white and black pieces:
 	white.clear();
 	black.clear();
+	std::fill(pieceCounts, pieceCounts + pieceCodes, 0);
+	materialKey = 0;
 
 	// 3. Set up the pawns:
 	for (int file=0; file<fileLim; file++)
@@ -63,6 +70,30 @@ void GameManager::initGame() {
 void GameManager::initNewPiece(std::shared_ptr<Piece> np, Player* owner) {
 	owner->addPiece(np);
 	board.setPiece(np);
+	updateMaterial(np, 1);
+}
+
+// updateMaterial: std::shared_ptr<Piece>, delta -> void
+// Counts the piece in (delta 1) or out (delta -1) of the game,
+// updating the material key to match.
+void GameManager::updateMaterial(std::shared_ptr<Piece> p, int delta) {
+	PieceType pt;
+	switch (p->getType()) {
+		case MoveId::P: pt = PawnType; break;
+		case MoveId::N: pt = KnightType; break;
+		case MoveId::B: pt = BishopType; break;
+		case MoveId::R: pt = RookType; break;
+		case MoveId::Q: pt = QueenType; break;
+		default: pt = KingType; break;
+	}
+	int piece = makePiece(p->getOwner() == &white ? White : Black, pt);
+
+	// The key holds one entry per piece, numbered from 0 up:
+	if (delta < 0)
+		pieceCounts[piece]--;
+	materialKey ^= materialKeyOf(piece, pieceCounts[piece]);
+	if (delta > 0)
+		pieceCounts[piece]++;
 }
 
 // changeTurn: void -> void
@@ -216,16 +247,23 @@ void GameManager::printMoveLine(std::ostream& out, char separator, size_t paddin
 // Handles the promotion of a pawn.
 // Also sets the result's promotedPiece to the string representation of the
 // promotion.
+//
+// The promotion piece written with the move ("e8=Q") is used if there is one,
+// so that saved games are loaded without asking. Otherwise the player is asked for it.
 void GameManager::handlePromotion(MoveAnalysisResults& results) {
 	int success = false;
 	std::string& ans = results.promotionPiece;
 	std::shared_ptr<Piece> oldP = board.getPiece(results.dest);
 	std::shared_ptr<Piece> newP;
+	bool ask = ans.empty();
 
-	std::cout << "Your pawn will be promoted! ";
+	if (ask)
+		std::cout << "Your pawn will be promoted! ";
 	while (!success) {
-		std::cout << "Select the promotion piece (R, N, B, Q): ";
-		std::getline(std::cin, ans);
+		if (ask) {
+			std::cout << "Select the promotion piece (R, N, B, Q): ";
+			std::getline(std::cin, ans);
+		}
 
 		switch (mParser.mapPiece(ans)) {
 			case (PieceId::R):
@@ -246,12 +284,14 @@ void GameManager::handlePromotion(MoveAnalysisResults& results) {
 				break;
 			default:
 				std::cout << "Illegal piece promotion." << std::endl;
+				ask = true;
 				break;
 		}
 	}
 
 	initNewPiece(newP, inTurn);
 	inTurn->removePiece(oldP);
+	updateMaterial(oldP, -1);
 }
 
 // handleCastling: MoveId, testFlag -> void
@@ -317,6 +357,8 @@ bool GameManager::handleCastling(MoveId mP, bool test) {
 
 			board.setPiece(king);
 			board.setPiece(rook);
+			king->move();
+			rook->move();
 		}
 	}
 	else {
@@ -372,11 +414,14 @@ bool GameManager::threatensSquare(const SquareCoords& dest, Player* player) {
 // Returns true if the move can be made, false otherwise.
 bool GameManager::canMove(Player* player) {
 	// the logic in a nutshell:
-	// Piece-by-piece, produce a list of all the destination squares available for the given piece
-	// ignore the legality of the moves for now.
-	// Test all the destination squares for a each piece one by one, by using validateMove with test flag set to true.
-	// if any move produces a legal chess state, return true.
+	// Piece-by-piece, visit the destination squares available for the given piece one at a time,
+	// ignoring the legality of the moves for now.
+	// Test each destination square as soon as it is found, by using validateMove.
+	// if any move produces a legal chess state, stop looking and return true.
 	// Otherwise return false.
+	//
+	// Since a legal move is usually found among the first few squares, the squares are not
+	// collected into a list first.
 	int oppDir = getOpponentDirection(player);
 
 	for (std::shared_ptr<Piece> piece : *player) {
@@ -386,10 +431,7 @@ bool GameManager::canMove(Player* player) {
 		res.src = src;
 		res.opponentDir = oppDir;
 
-		std::vector<SquareCoords> destSquares;
-		piece->reachableSquares(destSquares, oppDir, board);
-
-		for (SquareCoords sq : destSquares) {
+		auto tryMove = [&](const SquareCoords& sq) {
 			res.dest = sq;
 			res.captureCoords = sq;
 			res.capt = false;
@@ -409,10 +451,11 @@ bool GameManager::canMove(Player* player) {
 				res.capt = true;
 
 			// Finally, the moveAnalysis is complete - see if the move can be validated:
-			if (validateMove(res, player)) {
-				return true;
-			}
-		}
+			return validateMove(res, player);
+		};
+
+		if (piece->visitReachableSquares(tryMove, oppDir, board))
+			return true;
 	}
 
 	// if normal moves don't work, castling won't work either,
@@ -421,7 +464,7 @@ bool GameManager::canMove(Player* player) {
 }
 
 // finalizeGameState: MoveAnalysisResults& -> void
-// Examines whether the game is a checkmate or a stalemate,
+// Examines whether the game is a checkmate, a stalemate or a draw by insufficient material,
 // updates the move string if the last move was a check or
 // if the game is a checkmate and finally records the move
 // into the game's move list.
@@ -431,8 +474,13 @@ void GameManager::finalizeGameState(MoveAnalysisResults& results) {
 	std::vector<std::shared_ptr<Piece>> threatPieces;
 
 	bool check = threatensSquare(kingCoords, inTurn);
+	bool opponentCanMove;
+	{
+		PhaseTimer timer(MovePhase::CanMove);
+		opponentCanMove = canMove(getOpponent(inTurn));
+	}
 
-	if (!canMove(getOpponent(inTurn))) {
+	if (!opponentCanMove) {
 		if (check) {
 			results.checkmateMove = true;
 			checkmate = true;
@@ -457,6 +505,12 @@ void GameManager::finalizeGameState(MoveAnalysisResults& results) {
 		lastMsg = "Stalemate by 50 consequtive moves with no capture.";
 	}
 
+	// The material table knows the configurations that cannot be won:
+	if (!(checkmate || stalemate) && materialTable().probe(materialKey, pieceCounts).draw) {
+		stalemate = true;
+		lastMsg = "Draw by insufficient material.";
+	}
+
 	mParser.addSpecialNotation(results);
 	
 	moves.push_back(results.move);
@@ -532,6 +586,7 @@ void GameManager::commitMove(MoveAnalysisResults& results) {
 		capturedP = board.getPiece(results.captureCoords);
 		getOpponent(inTurn)->removePiece(capturedP);
 		board.removePiece(capturedP);
+		updateMaterial(capturedP, -1);
 	}
 
 	board.removePiece(movedP);
@@ -565,7 +620,11 @@ GameManager::GameManager() {
 // Otherwise, records the error message and returns false without making the move.
 // -----------------------------------------
 bool GameManager::makeMove(std::string move) {
+	// The phases are timed for the move statistics, each in a block of its own (see MoveStats.h):
+	PhaseTimer totalTimer(MovePhase::Total);
+
 	if (checkmate || stalemate) {
+		countRejection(MoveRejection::GameOver);
 		lastMsg = "The game has already ended: ";
 		if (checkmate)
 			lastMsg += inTurnPlayer() + "won!";
@@ -580,44 +639,62 @@ bool GameManager::makeMove(std::string move) {
 
 	try {
 		// Parse the given move:
-		mParser.parseNewMove(results);
+		{
+			PhaseTimer timer(MovePhase::Parse);
+			mParser.parseNewMove(results);
+		}
 		results.opponentDir = getOpponentDirection(inTurn);
 		
 		MoveId mP = results.movedP;
 		
 		// If the move was a castling move, handle it separately:
 		if (mP == MoveId::OO || mP == MoveId::OOO) {
+			PhaseTimer timer(MovePhase::Castling);
 			handleCastling(mP);
 		}
 		else {
 			// If the move was not a castling move, validate the source and destination
 			// squares and find all the necessary move information:
-			extractMove(results);
+			{
+				PhaseTimer timer(MovePhase::Extract);
+				extractMove(results);
+			}
 		
 			// Finally, commit to it, if it can be taken:
-			if (!validateMove(results, inTurn)) {
+			bool valid;
+			{
+				PhaseTimer timer(MovePhase::Validate);
+				valid = validateMove(results, inTurn);
+			}
+			if (!valid) {
+				countRejection(MoveRejection::LeavesKingInCheck);
 				lastMsg = "[" + move + "]: The move will leave you king under a check!";
 				return false;
 			}
 			else {
+				PhaseTimer timer(MovePhase::Commit);
 				commitMove(results);
 			}
 		}
 
 		// If either the castling branch or the normal move branch was successful,
 		// finalize the move and signal success:
+		PhaseTimer timer(MovePhase::Finalize);
 		finalizeGameState(results);
 		return true;
 	}
 	catch (ParseException const& e) {
+		countRejection(MoveRejection::Parse);
 		lastMsg = e.what();
 		return false;
 	}
 	catch (IllegalMoveException const& e) {
+		countRejection(MoveRejection::IllegalMove);
 		lastMsg = "[" + move + "]: " + e.what();
 		return false;
 	}
 	catch (SquareValidationException const& e) {
+		countRejection(MoveRejection::SquareValidation);
 		lastMsg = "[" + move + "]: " + e.what();
 		return false;
 	}
@@ -747,6 +824,111 @@ bool GameManager::isStalemate() const {
 	return stalemate;
 }
 
+// toFEN: void -> std::string
+// Returns the current game state as a FEN string, which is how the game is
+// handed over to the chess engine.
+//
+// The castling rights are derived from the unmoved kings and rooks on their
+// original squares, the en passant square from the opponent's pawn that has
+// just made a double step and the halfmove clock from the recorded moves.
+std::string GameManager::toFEN() const {
+	static const int whiteBackRank = 0;
+	static const int blackBackRank = rankLim - 1;
+	std::string fen;
+
+	// 1. The pieces, rank 8 first:
+	for (int rank = rankLim - 1; rank >= 0; rank--) {
+		int empty = 0;
+		for (int file = 0; file < fileLim; file++) {
+			std::shared_ptr<Piece> p = board.getPiece(SquareCoords(file, rank));
+			if (!p) {
+				empty++;
+				continue;
+			}
+			if (empty > 0)
+				fen += char('0' + empty);
+			empty = 0;
+
+			std::string pc = p->toString();
+			fen += p->getOwner() == &white ? pc[0] : char(std::tolower(pc[0]));
+		}
+		if (empty > 0)
+			fen += char('0' + empty);
+		if (rank > 0)
+			fen += '/';
+	}
+
+	// 2. The side to move:
+	fen += inTurn == &white ? " w " : " b ";
+
+	// 3. The castling rights:
+	auto unmoved = [&](int file, int rank, MoveId type, const Player* owner) {
+		std::shared_ptr<Piece> p = board.getPiece(SquareCoords(file, rank));
+		return p && p->getType() == type && p->getOwner() == owner && !p->moved_p();
+	};
+
+	std::string castling;
+	if (unmoved(4, whiteBackRank, MoveId::K, &white)) {
+		if (unmoved(7, whiteBackRank, MoveId::R, &white)) castling += 'K';
+		if (unmoved(0, whiteBackRank, MoveId::R, &white)) castling += 'Q';
+	}
+	if (unmoved(4, blackBackRank, MoveId::K, &black)) {
+		if (unmoved(7, blackBackRank, MoveId::R, &black)) castling += 'k';
+		if (unmoved(0, blackBackRank, MoveId::R, &black)) castling += 'q';
+	}
+	fen += castling.empty() ? "-" : castling;
+
+	// 4. The en passant square, behind the pawn that can be captured en passant:
+	std::string ep = "-";
+	int epRank = inTurn == &white ? blackBackRank - 3 : whiteBackRank + 3;
+	for (int file = 0; file < fileLim; file++) {
+		std::shared_ptr<Piece> p = board.getPiece(SquareCoords(file, epRank));
+		if (p && p->getOwner() != inTurn && p->canBeEnPassanted()) {
+			ep = std::string(1, char('a' + file)) + char('1' + epRank + (inTurn == &white ? 1 : -1));
+			break;
+		}
+	}
+	fen += " " + ep;
+
+	// 5. The halfmove clock counts the moves since the last pawn move or capture.
+	//    Pawn moves are the only moves written starting with a file letter:
+	int halfmoves = 0;
+	for (auto m = moves.rbegin(); m != moves.rend(); ++m, ++halfmoves)
+		if (((*m)[0] >= 'a' && (*m)[0] <= 'h') || m->find('x') != std::string::npos)
+			break;
+
+	fen += " " + std::to_string(halfmoves) + " " + std::to_string(turnNum);
+	return fen;
+}
+
+// hangingPieces: void -> std::string
+// Returns a readable list of the pieces of both players that the opponent
+// can win material by capturing, along with the material that would be won.
+std::string GameManager::hangingPieces() const {
+	static const char pieceLetters[] = "PNBRQK";
+	Position pos;
+	pos.setFromFEN(toFEN());
+
+	std::string result;
+	for (Color c : { White, Black }) {
+		std::string list;
+		for (Bitboard b = ::hangingPieces(pos, c); b; ) {
+			int sq = popLsb(b);
+			PieceType pt = pieceType(pos.pieceOn(sq));
+			list += " ";
+			if (pt != PawnType)
+				list += pieceLetters[pt];
+			list += char('a' + fileOf(sq));
+			list += char('1' + rankOf(sq));
+			list += " (" + std::to_string(exchangeGain(pos, sq)) + ")";
+		}
+
+		result += (c == White ? whiteName : blackName) + ":" + (list.empty() ? " none" : list) + "\n";
+	}
+
+	return result;
+}
+
 // save: filename -> bool
 // Tries to save the game into the file specified by filename.
 // If the saving succeeds, returns true, else records the
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include "CLIChessDefinitions.h"
+#include "EngineDefinitions.h"
 #include "CLIChessExceptions.h"
 #include "MoveParser.h"
 #include "Board.h"
@@ -38,8 +39,14 @@ private:
 	bool checkmate;
 	bool stalemate;
 
+	// The piece counts of both players and the engine's material key of them, kept up to
+	// date as pieces are captured and promoted, for recognizing drawn material:
+	int pieceCounts[pieceCodes];
+	Key materialKey;
+
 	void initGame();
 	void initNewPiece(std::shared_ptr<Piece> np, Player* owner);
+	void updateMaterial(std::shared_ptr<Piece> p, int delta);
 	void changeTurn();
 	Player* getOpponent(Player *p);
 	int getOpponentDirection(Player *p);
@@ -54,6 +61,9 @@ private:
 	bool validateMove(const MoveAnalysisResults& results, Player* player);
 	void commitMove(MoveAnalysisResults& results);
 
+	// The rules primitives above are measured by benchmarks/RulesBenchmark.cpp:
+	friend struct RulesBenchmark;
+
 public:
 	GameManager();
 	bool makeMove(std::string move);
@@ -66,5 +76,7 @@ public:
 	bool save(std::string filename);
 	bool load(std::string filename);
 	bool takeBack(size_t n);
+	std::string toFEN() const;
+	std::string hangingPieces() const;
 };
 
@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+	data = nullptr;
+	length = 0;
+#ifdef _WIN32
+	fileHandle = mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+// open: file name, bool -> bool
+// Maps the file into memory, closing the file mapped before, if any. If the file is
+// to be accessed at random, the operating system is told not to read ahead.
+// Returns false if the file cannot be opened or is empty.
+bool MappedFile::open(const std::string& fileName, bool randomAccess) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							  randomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	length = size_t(fileSize.QuadPart);
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	if (randomAccess)
+		madvise(view, size_t(st.st_size), MADV_RANDOM);
+	length = size_t(st.st_size);
+#endif
+
+	data = static_cast<const unsigned char*>(view);
+	return true;
+}
+
+void MappedFile::close() {
+	if (!data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	fileHandle = mappingHandle = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(data), length);
+#endif
+
+	data = nullptr;
+	length = 0;
+}
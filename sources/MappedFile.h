@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// MappedFile:
+// A read-only view of a whole file mapped into memory. The operating system reads in
+// the pages of the file as they are first touched, so opening even a very large file
+// is instant and takes no memory of its own.
+class MappedFile
+{
+private:
+	const unsigned char* data;
+	size_t length;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& fileName, bool randomAccess = true);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+	const unsigned char* bytes() const { return data; }
+	size_t size() const { return length; }
+};
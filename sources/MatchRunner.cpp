@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "MatchRunner.h"
+#include "CLIChessExceptions.h"
+#include "GameFiles.h"
+#include "Material.h"
+#include "MoveGen.h"
+#include "Notation.h"
+#include "Tablebase.h"
+
+namespace {
+	// Games longer than this are drawn:
+	const int maxGamePlies = 600;
+
+	// Opening is where the games of an opening pair start from: a position, and the moves
+	// leading on from it that are played out before the engines take over.
+	struct Opening {
+		Position start;
+		std::vector<Move> moves;
+		bool fromInitial;			// The start is the initial position, so the games can be saved.
+	};
+
+	// GameRecord is how a game went:
+	struct GameRecord {
+		int whiteResult;			// 1, 0 or -1.
+		std::string reason;
+		std::vector<Move> moves;	// The opening moves included.
+	};
+
+	// eloFromScore: score -> double
+	// The Elo difference at which the expected score is the given one.
+	double eloFromScore(double score) {
+		score = (std::min)((std::max)(score, 1e-6), 1.0 - 1e-6);
+		return -400.0 * std::log10(1.0 / score - 1.0);
+	}
+
+	double scoreFromElo(double elo) {
+		return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+	}
+
+	// scoreVariance: const MatchStats& -> double
+	// The variance of the result of a single game, as observed so far.
+	double scoreVariance(const MatchStats& stats) {
+		double s = stats.score();
+		int n = stats.games();
+		if (n == 0)
+			return 0.0;
+		return (stats.wins * (1.0 - s) * (1.0 - s) + stats.draws * (0.5 - s) * (0.5 - s) + stats.losses * s * s) / n;
+	}
+
+	// readOpenings: paths, plies, openings, error message -> bool
+	// Reads the openings of the given files: the .clc files and the directories holding them
+	// give one opening per game, and any other file one per FEN line.
+	bool readOpenings(const std::vector<std::string>& paths, int plies, std::vector<Opening>& openings, std::string& errorMsg) {
+		for (const std::string& path : paths) {
+			std::error_code ec;
+			if (std::filesystem::is_directory(path, ec) || std::filesystem::path(path).extension() == ".clc") {
+				for (const std::string& game : savedGameFiles({ path })) {
+					Opening opening;
+					opening.start.setFromFEN(Position::startFEN);
+					opening.fromInitial = true;
+					if (!readSavedGame(game, opening.moves, plies)) {
+						errorMsg = "MATCH ERROR: could not replay the game " + game;
+						return false;
+					}
+					openings.push_back(opening);
+				}
+				continue;
+			}
+
+			std::ifstream in(path);
+			if (!in.is_open()) {
+				errorMsg = "MATCH ERROR: could not open the file " + path;
+				return false;
+			}
+
+			std::string line;
+			while (std::getline(in, line)) {
+				if (line.empty() || line[0] == '#')
+					continue;
+				Opening opening;
+				try {
+					opening.start.setFromFEN(line);
+				}
+				catch (const ParseException& e) {
+					errorMsg = "MATCH ERROR: " + std::string(e.what());
+					return false;
+				}
+				opening.fromInitial = false;
+				openings.push_back(opening);
+			}
+		}
+
+		if (openings.empty()) {
+			errorMsg = "MATCH ERROR: no openings found";
+			return false;
+		}
+		return true;
+	}
+
+	// randomOpenings: count, plies, seed, openings -> void
+	// Makes the given number of openings of random legal moves from the initial position.
+	// An opening whose moves end the game is drawn again.
+	void randomOpenings(int count, int plies, uint64_t seed, std::vector<Opening>& openings) {
+		std::mt19937_64 rng(seed);
+
+		while (int(openings.size()) < count) {
+			Opening opening;
+			opening.start.setFromFEN(Position::startFEN);
+			opening.fromInitial = true;
+
+			Position pos = opening.start;
+			for (int ply = 0; ply <= plies; ply++) {
+				MoveList moves(pos);
+				if (moves.size() == 0)
+					break;
+				if (ply == plies) {
+					openings.push_back(opening);
+					break;
+				}
+				Move m = moves.begin()[rng() % moves.size()].move;
+				pos.makeMove(m);
+				opening.moves.push_back(m);
+			}
+		}
+	}
+
+	// adjudicate: const Position&, position keys, GameRecord& -> bool
+	// Returns true, with the result in the record, if the game is over or decided.
+	// The keys are those of the positions of the game so far, the current one included.
+	bool adjudicate(const Position& pos, const std::vector<Key>& keys, GameRecord& record) {
+		Color us = pos.sideToMove();
+
+		if (MoveList(pos).size() == 0) {
+			record.whiteResult = pos.inCheck() ? (us == White ? -1 : 1) : 0;
+			record.reason = pos.inCheck() ? "checkmate" : "stalemate";
+			return true;
+		}
+		if (pos.halfmoveClock() >= 100) {
+			record.whiteResult = 0;
+			record.reason = "fifty-move rule";
+			return true;
+		}
+
+		// A position can only repeat since the last capture or pawn move:
+		int repetitions = 0;
+		int first = (std::max)(0, int(keys.size()) - 1 - pos.halfmoveClock());
+		for (int i = first; i < int(keys.size()); i++)
+			repetitions += keys[i] == pos.key();
+		if (repetitions >= 3) {
+			record.whiteResult = 0;
+			record.reason = "threefold repetition";
+			return true;
+		}
+
+		if (insufficientMaterial(pos)) {
+			record.whiteResult = 0;
+			record.reason = "insufficient material";
+			return true;
+		}
+
+		TBResult tb;
+		if (popCount(pos.pieces()) <= tablebasePieces() && probeTablebase(pos, tb)) {
+			record.whiteResult = us == White ? tb.wdl : -tb.wdl;
+			record.reason = "tablebase";
+			return true;
+		}
+
+		if (int(keys.size()) > maxGamePlies) {
+			record.whiteResult = 0;
+			record.reason = "game too long";
+			return true;
+		}
+		return false;
+	}
+
+	// playGame: engines, const Opening&, const MatchOptions&, abandon flag, GameRecord& -> bool
+	// Plays a game between the engines (White's first) from the opening. Returns false if
+	// the game was abandoned.
+	bool playGame(Engine* engines[2], const Opening& opening, const MatchOptions& options,
+				  const std::atomic<bool>& abandon, GameRecord& record) {
+		Position pos = opening.start;
+		std::vector<Key> keys(1, pos.key());
+		record.moves.clear();
+
+		for (Move m : opening.moves) {
+			pos.makeMove(m);
+			keys.push_back(pos.key());
+			record.moves.push_back(m);
+		}
+
+		engines[White]->newGame();
+		engines[Black]->newGame();
+		TimePoint clock[2] = { options.baseTime, options.baseTime };
+
+		while (!adjudicate(pos, keys, record)) {
+			if (abandon)
+				return false;
+
+			Color us = pos.sideToMove();
+			SearchLimits limits;
+			limits.startTime = now();
+			if (options.depth > 0)
+				limits.depth = options.depth;
+			limits.nodes = options.nodes;
+			limits.moveTime = options.moveTime;
+			if (options.baseTime > 0) {
+				limits.time[White] = clock[White];
+				limits.time[Black] = clock[Black];
+				limits.inc[White] = limits.inc[Black] = options.inc;
+			}
+
+			SearchResult result = engines[us]->think(pos, limits);
+
+			if (options.baseTime > 0) {
+				clock[us] -= now() - limits.startTime;
+				if (clock[us] < 0) {
+					record.whiteResult = us == White ? -1 : 1;
+					record.reason = "loss on time";
+					return true;
+				}
+				clock[us] += options.inc;
+			}
+
+			if (result.bestMove == noMove) {
+				record.whiteResult = us == White ? -1 : 1;
+				record.reason = "no move";
+				return true;
+			}
+
+			pos.makeMove(result.bestMove);
+			keys.push_back(pos.key());
+			record.moves.push_back(result.bestMove);
+		}
+
+		return true;
+	}
+
+	// saveGame: file name, const Opening&, const GameRecord& -> bool
+	// Saves a game played from the initial position in the .clc format, one move per line.
+	bool saveGame(const std::string& fileName, const Opening& opening, const GameRecord& record) {
+		std::ofstream out(fileName, std::ios::trunc);
+		Position pos = opening.start;
+
+		for (Move m : record.moves) {
+			out << moveToSAN(pos, m) << std::endl;
+			pos.makeMove(m);
+		}
+		return !out.fail();
+	}
+
+	void configure(Engine& engine, const EngineConfig& config) {
+		engine.setHashSize(config.hashMB);
+		engine.setSearchOptions(config.options);
+		engine.setSearchMode(config.mode);
+	}
+}
+
+double MatchStats::elo() const {
+	return eloFromScore(score());
+}
+
+double MatchStats::eloMargin() const {
+	int n = games();
+	if (n == 0)
+		return 0.0;
+
+	double deviation = std::sqrt(scoreVariance(*this) / n);
+	return (eloFromScore(score() + 1.96 * deviation) - eloFromScore(score() - 1.96 * deviation)) / 2.0;
+}
+
+double MatchStats::llr(double elo0, double elo1) const {
+	double variance = scoreVariance(*this);
+	if (variance == 0.0)
+		return 0.0;
+
+	double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+	return games() * (s1 - s0) * (2.0 * score() - s0 - s1) / (2.0 * variance);
+}
+
+bool runMatch(const MatchOptions& options, const EngineConfig& first, const EngineConfig& second, MatchStats& stats,
+			  std::function<void(const std::string&)> report, std::string& errorMsg) {
+	std::vector<Opening> openings;
+	if (!options.openingFiles.empty()) {
+		if (!readOpenings(options.openingFiles, options.openingPlies, openings, errorMsg))
+			return false;
+	}
+	else if (options.randomPlies > 0) {
+		randomOpenings((std::max)(options.games + 1, 2) / 2, options.randomPlies, options.seed, openings);
+		report("No opening files: each pair of games starts with " + std::to_string(options.randomPlies) +
+			   " random plies from the initial position (seed " + std::to_string(options.seed) + ").");
+	}
+	else if (options.baseTime == 0 && options.moveTime == 0) {
+		// The node and depth limits are deterministic, so every game would be the same:
+		errorMsg = "MATCH ERROR: the node and depth limits need opening files or random opening plies";
+		return false;
+	}
+	else {
+		Opening opening;
+		opening.start.setFromFEN(Position::startFEN);
+		opening.fromInitial = true;
+		openings.push_back(opening);
+	}
+
+	if (!options.gamesDirectory.empty()) {
+		std::error_code ec;
+		std::filesystem::create_directories(options.gamesDirectory, ec);
+		if (ec) {
+			errorMsg = "MATCH ERROR: could not create the directory " + options.gamesDirectory;
+			return false;
+		}
+	}
+
+	// The bounds of the log-likelihood ratio at which the test accepts elo0 or elo1:
+	double lowerBound = std::log(options.beta / (1.0 - options.alpha));
+	double upperBound = std::log((1.0 - options.beta) / options.alpha);
+
+	std::atomic<int> nextGame(0);
+	std::atomic<bool> decided(false);
+	std::mutex statsMutex;
+	stats = MatchStats();
+
+	auto work = [&] {
+		Engine engines[2];
+		configure(engines[0], first);
+		configure(engines[1], second);
+		GameRecord record;
+
+		for (int g = nextGame++; g < options.games && !decided; g = nextGame++) {
+			// The games of a pair play the same opening, the first engine taking White first:
+			const Opening& opening = openings[size_t(g / 2) % openings.size()];
+			bool firstIsWhite = g % 2 == 0;
+			Engine* players[2] = { &engines[firstIsWhite ? 0 : 1], &engines[firstIsWhite ? 1 : 0] };
+
+			if (!playGame(players, opening, options, decided, record))
+				break;
+
+			std::lock_guard<std::mutex> lock(statsMutex);
+			if (decided)
+				break;
+
+			int result = firstIsWhite ? record.whiteResult : -record.whiteResult;
+			stats.wins += result > 0;
+			stats.draws += result == 0;
+			stats.losses += result < 0;
+
+			if (!options.gamesDirectory.empty() && opening.fromInitial) {
+				char name[32];
+				std::snprintf(name, sizeof(name), "game%05d.clc", g + 1);
+				stats.savedGames += saveGame((std::filesystem::path(options.gamesDirectory) / name).string(), opening, record);
+			}
+
+			std::ostringstream line;
+			line.setf(std::ios::fixed);
+			line.precision(1);
+			line << "Game " << g + 1 << " (" << (firstIsWhite ? first.name : second.name) << " - "
+				 << (firstIsWhite ? second.name : first.name) << "): "
+				 << (record.whiteResult > 0 ? "1-0" : record.whiteResult < 0 ? "0-1" : "1/2-1/2") << " (" << record.reason << ")"
+				 << "  Score " << stats.wins << "-" << stats.losses << "-" << stats.draws
+				 << "  Elo " << stats.elo() << " +/- " << stats.eloMargin();
+
+			if (options.sprt) {
+				double llr = stats.llr(options.elo0, options.elo1);
+				line.precision(2);
+				line << "  LLR " << llr << " (" << lowerBound << ", " << upperBound << ")";
+				if (llr >= upperBound || llr <= lowerBound) {
+					stats.sprtResult = llr >= upperBound ? 1 : -1;
+					decided = true;
+				}
+			}
+			report(line.str());
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < (std::max)(options.concurrency, 1); t++)
+		threads.emplace_back(work);
+	for (std::thread& t : threads)
+		t.join();
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Engine.h"
+#include "TimeManager.h"
+
+// EngineConfig describes one of the two players of a match: an engine instance of its own
+// with the given search settings.
+struct EngineConfig {
+	std::string name;
+	SearchOptions options;
+	SearchMode mode;
+	size_t hashMB;
+
+	EngineConfig() { mode = SearchMode::AlphaBeta; hashMB = 16; }
+};
+
+// MatchOptions controls how a match is played:
+struct MatchOptions {
+	int games;					// The most games to play; the openings are played twice, with the colours swapped.
+	int concurrency;			// The games played at once, each on a thread of its own.
+
+	// The limits of every move. With a clock (baseTime), each side has baseTime
+	// milliseconds for the game plus inc per move and loses when it runs out:
+	TimePoint baseTime;
+	TimePoint inc;
+	TimePoint moveTime;
+	uint64_t nodes;
+	int depth;
+
+	std::vector<std::string> openingFiles;	// FEN files, .clc files and directories of .clc files.
+	int openingPlies;						// The plies of a .clc game played as its opening, 0 for all of them.
+	int randomPlies;						// Without opening files, the random plies starting each pair of games.
+	uint64_t seed;							// The seed of the random openings.
+	std::string gamesDirectory;				// Where the games are saved, if anywhere.
+
+	// The sequential probability ratio test between the hypotheses that the first engine
+	// is elo0 and elo1 points stronger, with the error probabilities alpha and beta:
+	bool sprt;
+	double elo0, elo1, alpha, beta;
+
+	MatchOptions() {
+		games = 100;
+		concurrency = 1;
+		baseTime = inc = moveTime = 0;
+		nodes = 0;
+		depth = 0;
+		openingPlies = 0;
+		randomPlies = 8;
+		seed = 1;
+		sprt = false;
+		elo0 = 0.0;
+		elo1 = 5.0;
+		alpha = beta = 0.05;
+	}
+};
+
+// MatchStats holds the results of a match from the point of view of the first engine:
+struct MatchStats {
+	int wins, draws, losses;
+	int savedGames;
+	int sprtResult;				// 1 if the test accepted elo1, -1 if it accepted elo0, 0 if it did not end.
+
+	MatchStats() { wins = draws = losses = savedGames = sprtResult = 0; }
+
+	int games() const { return wins + draws + losses; }
+	double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+
+	// elo: void -> double
+	// eloMargin: void -> double
+	// The Elo difference implied by the score, and half the width of its 95% confidence interval.
+	double elo() const;
+	double eloMargin() const;
+
+	// llr: elo0, elo1 -> double
+	// The log-likelihood ratio of the hypotheses, in the normal approximation of the
+	// trinomial (win, draw, loss) distribution of the game results.
+	double llr(double elo0, double elo1) const;
+};
+
+// runMatch: const MatchOptions&, const EngineConfig&, const EngineConfig&, MatchStats&, progress report, error message -> bool
+// Plays a match between two engines. The games are shared out among the threads, each of
+// which owns an engine instance for either player, and reported one line each as they end,
+// along with the score, the Elo difference and, with the SPRT, the log-likelihood ratio so
+// far. Once the test accepts either hypothesis, the games still running are abandoned.
+//
+// A game is adjudicated as soon as it is decided: by a checkmate or stalemate, a threefold
+// repetition, the fifty-move rule, insufficient material or, for the positions the loaded
+// tablebases know, by the tables. Games that go on for too long are drawn.
+//
+// Without opening files, each pair of games starts with randomPlies random legal moves from
+// the initial position, drawn from the seed, since with the node and depth limits the engines
+// would otherwise play the same game over and over. The same seed gives the same openings.
+//
+// Games played from the initial position (the random openings and the .clc openings) are
+// saved in the .clc format into gamesDirectory. Returns false, with the reason in errorMsg,
+// if the openings cannot be read, or if there are neither opening files nor random plies
+// and the limits are the deterministic node or depth limits.
+bool runMatch(const MatchOptions& options, const EngineConfig& first, const EngineConfig& second, MatchStats& stats,
+			  std::function<void(const std::string&)> report, std::string& errorMsg);
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "MateSolver.h"
+#include "MoveGen.h"
+
+namespace {
+	// A proof or disproof number of infinity means that the position is disproven or proven.
+	// The sums of the numbers stop just short of it.
+	const uint32_t infinity = 1u << 30;
+
+	inline uint32_t saturate(uint64_t n) {
+		return uint32_t((std::min)(n, uint64_t(infinity - 1)));
+	}
+
+	// keyWithPlies: Key, plies -> Key
+	// Mixes the plies left into the position key, never giving the empty key 0.
+	inline Key keyWithPlies(Key key, int plies) {
+		Key mixed = key ^ (Key(plies + 1) * 0x9E3779B97F4A7C15ULL);
+		return mixed ? mixed : 1;
+	}
+
+	// isAttacker: plies -> bool
+	// The mating side moves when an odd number of plies is left, the last of them being
+	// the mate itself.
+	inline bool isAttacker(int plies) { return (plies & 1) != 0; }
+}
+
+// Private methods:
+// -----------------------------
+
+// find: Key -> const Entry*
+// Returns the entry of the given (mixed) key, or nullptr if there is none.
+const MateSolver::Entry* MateSolver::find(Key key) {
+	for (const Entry& e : bucketFor(key).entries)
+		if (e.key == key)
+			return &e;
+	return nullptr;
+}
+
+// store: Key, pn, dn, work -> void
+// Stores the numbers of a position, replacing an empty entry, the old entry of the same
+// position or else the entry that took the least work.
+void MateSolver::store(Key key, uint32_t pn, uint32_t dn, uint32_t work) {
+	Bucket& b = bucketFor(key);
+	Entry* replace = &b.entries[0];
+
+	for (Entry& e : b.entries) {
+		if (e.key == key || e.key == 0) {
+			replace = &e;
+			break;
+		}
+		if (e.work < replace->work)
+			replace = &e;
+	}
+
+	*replace = Entry{ key, pn, dn, work };
+}
+
+// children: Position&, plies, Child* -> int
+// Fills the list with the moves to look at and the numbers of the positions they lead to,
+// as far as they are known, and returns the number of moves. With one ply left, only the
+// checks can mate, so the other moves are left out.
+int MateSolver::children(Position& pos, int plies, Child* list) {
+	int n = 0;
+
+	for (const ScoredMove& sm : MoveList(pos)) {
+		pos.makeMove(sm.move);
+		bool check = pos.inCheck();
+		Key key = keyWithPlies(pos.key(), plies - 1);
+		pos.unmakeMove(sm.move);
+
+		if (plies == 1 && !check)
+			continue;
+
+		Child& c = list[n++];
+		c.move = sm.move;
+		c.key = key;
+		const Entry* e = find(key);
+		c.pn = e ? e->pn : 1;
+		c.dn = e ? e->dn : 1;
+	}
+
+	return n;
+}
+
+// mid: Position&, plies, thpn, thdn, pn&, dn& -> void
+// Searches the position until its proof number reaches thpn or its disproof number reaches
+// thdn, and returns the numbers it ends with.
+//
+// The mating side needs only one move that mates, so its proof number is the smallest of
+// its moves' and its disproof number their sum. For the defending side it is the other
+// way round. The child with the smallest number is searched, until its number grows past
+// that of the second best (times 1.25, so that the search does not alternate between two
+// children too often) or the parent's thresholds are reached.
+void MateSolver::mid(Position& pos, int plies, uint32_t thpn, uint32_t thdn, uint32_t& pn, uint32_t& dn) {
+	Key key = keyWithPlies(pos.key(), plies);
+	uint64_t startNodes = nodes++;
+	bool attacker = isAttacker(plies);
+
+	// The defender is out of plies: only a mate proves the position.
+	if (plies == 0) {
+		bool mated = MoveList(pos).size() == 0 && pos.inCheck();
+		pn = mated ? 0 : infinity;
+		dn = mated ? infinity : 0;
+		store(key, pn, dn, 1);
+		return;
+	}
+
+	Child list[maxMoves];
+	int n = children(pos, plies, list);
+
+	// Without moves, the mating side is mated or stalemated, or has no checks left;
+	// the defender is either mated or stalemated:
+	if (n == 0) {
+		bool mated = !attacker && pos.inCheck();
+		pn = mated ? 0 : infinity;
+		dn = mated ? infinity : 0;
+		store(key, pn, dn, 1);
+		return;
+	}
+
+	for (;;) {
+		uint64_t sum = 0;
+		uint32_t smallest = infinity;
+		int best = 0;
+		uint32_t secondSmallest = infinity;
+
+		for (int i = 0; i < n; i++) {
+			// The number minimized, and the one summed:
+			uint32_t own = attacker ? list[i].pn : list[i].dn;
+			uint32_t other = attacker ? list[i].dn : list[i].pn;
+			sum += other;
+			if (own < smallest) {
+				secondSmallest = smallest;
+				smallest = own;
+				best = i;
+			}
+			else if (own < secondSmallest)
+				secondSmallest = own;
+		}
+
+		uint32_t summed = smallest == 0 ? infinity : saturate(sum);
+		pn = attacker ? smallest : summed;
+		dn = attacker ? summed : smallest;
+
+		if (pn >= thpn || dn >= thdn || (nodeLimit && nodes >= nodeLimit))
+			break;
+
+		Child& c = list[best];
+		uint64_t secondLimit = uint64_t(secondSmallest) + secondSmallest / 4 + 1;
+		uint32_t childPn, childDn;
+
+		if (attacker) {
+			childPn = uint32_t((std::min)(uint64_t(thpn), secondLimit));
+			childDn = saturate(uint64_t(thdn) - dn + c.dn);
+		}
+		else {
+			childPn = saturate(uint64_t(thpn) - pn + c.pn);
+			childDn = uint32_t((std::min)(uint64_t(thdn), secondLimit));
+		}
+
+		pos.makeMove(c.move);
+		mid(pos, plies - 1, childPn, childDn, c.pn, c.dn);
+		pos.unmakeMove(c.move);
+	}
+
+	store(key, pn, dn, uint32_t((std::min)(nodes - startNodes, uint64_t(UINT32_MAX))));
+}
+
+// provenPlies: Position&, plies -> int
+// Returns the fewest plies, at most the given number and of the same parity, in which the
+// position is proven, solving it for each number of plies in turn as needed, or -1 if
+// it is not proven within the given plies.
+int MateSolver::provenPlies(Position& pos, int plies) {
+	for (int q = plies & 1; q <= plies; q += 2) {
+		const Entry* e = find(keyWithPlies(pos.key(), q));
+		uint32_t pn = e ? e->pn : 1, dn = e ? e->dn : 1;
+		if (pn != 0 && dn != 0)
+			mid(pos, q, infinity, infinity, pn, dn);
+		if (pn == 0)
+			return q;
+	}
+	return -1;
+}
+
+// mateLine: const Position&, plies -> std::vector<Move>
+// Returns the line of a proven mate: the mating side plays the move that mates
+// soonest, and the defender the reply that puts the mate off longest.
+std::vector<Move> MateSolver::mateLine(const Position& root, int plies) {
+	Position pos = root;
+	std::vector<Move> line;
+	Child list[maxMoves];
+
+	while (plies > 0) {
+		bool attacker = isAttacker(plies);
+		int n = children(pos, plies, list);
+		Move chosen = noMove;
+		int chosenPlies = 0;
+
+		for (int i = 0; i < n; i++) {
+			pos.makeMove(list[i].move);
+			int q = provenPlies(pos, plies - 1);
+			pos.unmakeMove(list[i].move);
+
+			if (q >= 0 && (chosen == noMove || (attacker ? q < chosenPlies : q > chosenPlies))) {
+				chosen = list[i].move;
+				chosenPlies = q;
+			}
+		}
+
+		if (chosen == noMove)
+			break;
+		line.push_back(chosen);
+		pos.makeMove(chosen);
+		plies = chosenPlies;
+	}
+
+	return line;
+}
+
+// Public methods:
+// -----------------------------
+
+MateSolver::MateSolver(size_t megabytes) {
+	nodes = nodeLimit = 0;
+	resize(megabytes);
+}
+
+// resize: megabytes -> void
+// Resizes the hash table to the given size and clears it.
+void MateSolver::resize(size_t megabytes) {
+	size_t buckets = (std::max)(megabytes * 1024 * 1024 / sizeof(Bucket), size_t(1));
+	table.assign(buckets, Bucket());
+	clear();
+}
+
+void MateSolver::clear() {
+	for (Bucket& b : table)
+		for (Entry& e : b.entries)
+			e = Entry{ 0, 0, 0, 0 };
+}
+
+// solve: const Position&, moves, node limit -> MateResult
+// Looks for a forced mate by the side to move in at most maxMoves moves, giving up once
+// nodeLimit positions have been searched (0 for no limit). The mates in 1, 2, ... moves
+// are tried in turn, so that a mate found is the shortest one. The hash table is kept
+// between the calls; the entries stay valid for any position.
+MateResult MateSolver::solve(const Position& root, int maxMoves, uint64_t limit) {
+	MateResult result;
+	Position pos = root;
+	pos.reserve(2 * maxMoves);
+	nodes = 0;
+	nodeLimit = limit;
+	result.status = MateStatus::Disproven;
+
+	for (int moves = 1; moves <= maxMoves; moves++) {
+		uint32_t pn, dn;
+		mid(pos, 2 * moves - 1, infinity, infinity, pn, dn);
+
+		if (pn == 0) {
+			result.status = MateStatus::Proven;
+			result.moves = moves;
+			nodeLimit = 0;
+			result.line = mateLine(root, 2 * moves - 1);
+			break;
+		}
+		if (dn != 0) {
+			result.status = MateStatus::Unknown;
+			break;
+		}
+	}
+
+	result.nodes = nodes;
+	return result;
+}
+
+std::vector<MateResult> solveMates(const std::vector<Position>& positions, int maxMoves, uint64_t nodeLimit,
+								   size_t megabytes, int threads) {
+	std::vector<MateResult> results(positions.size());
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+
+	for (int t = 0; t < (std::max)(threads, 1); t++)
+		workers.emplace_back([&] {
+			MateSolver solver(megabytes);
+			for (size_t i = next++; i < positions.size(); i = next++)
+				results[i] = solver.solve(positions[i], maxMoves, nodeLimit);
+		});
+	for (std::thread& w : workers)
+		w.join();
+
+	return results;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "Position.h"
+
+// MateStatus tells what a mate search found out:
+enum class MateStatus {
+	Proven,			// The side to move mates by force.
+	Disproven,		// There is no forced mate within the moves given.
+	Unknown			// The node limit was reached first.
+};
+
+// MateResult is the outcome of a mate search:
+struct MateResult {
+	MateStatus status;
+	int moves;					// The length of the mate in moves of the mating side, if proven.
+	std::vector<Move> line;		// The mating line, if proven, ending in the mate.
+	uint64_t nodes;
+
+	MateResult() { status = MateStatus::Unknown; moves = 0; nodes = 0; }
+};
+
+// MateSolver:
+// Proves or disproves forced mates with depth-first proof-number search (df-pn).
+//
+// Unlike alpha-beta, which needs a full-width search to the depth of the mate, proof-number
+// search spends its effort where the proof is cheapest: every position has a proof number
+// (the fewest leaves still to be shown mated to prove the mate) and a disproof number, and
+// the search always expands the most-proving position. Forcing lines with few replies
+// are thereby followed very deep very quickly.
+//
+// The proof and disproof numbers are kept in a hash table of its own, of a fixed size.
+// When a bucket is full, the entry whose subtree took the least work to solve is replaced.
+// The mates are looked for with an increasing number of moves, so that the mate found is
+// the shortest one, and the positions solved for fewer moves are shared between the rounds.
+//
+// The positions are keyed together with the plies left, so a position is never solved
+// for a different distance than it was reached at. Draws by repetition or the fifty-move
+// rule are not considered.
+class MateSolver
+{
+private:
+	static const int bucketSize = 4;
+
+	struct Entry {
+		Key key;				// The position key mixed with the plies left, 0 if empty.
+		uint32_t pn;
+		uint32_t dn;
+		uint32_t work;			// The nodes spent solving the entry, for the replacement.
+	};
+
+	struct Bucket {
+		Entry entries[bucketSize];
+	};
+
+	struct Child {
+		Move move;
+		Key key;
+		uint32_t pn;
+		uint32_t dn;
+	};
+
+	std::vector<Bucket> table;
+	uint64_t nodes;
+	uint64_t nodeLimit;
+
+	Bucket& bucketFor(Key key) { return table[size_t(((key >> 32) * uint64_t(table.size())) >> 32)]; }
+	const Entry* find(Key key);
+	void store(Key key, uint32_t pn, uint32_t dn, uint32_t work);
+	int children(Position& pos, int plies, Child* list);
+	void mid(Position& pos, int plies, uint32_t thpn, uint32_t thdn, uint32_t& pn, uint32_t& dn);
+	int provenPlies(Position& pos, int plies);
+	std::vector<Move> mateLine(const Position& root, int plies);
+
+public:
+	explicit MateSolver(size_t megabytes = 16);
+	void resize(size_t megabytes);
+	void clear();
+	MateResult solve(const Position& pos, int maxMoves, uint64_t nodeLimit = 0);
+};
+
+// solveMates: positions, moves, node limit, hash size, threads -> std::vector<MateResult>
+// Looks for the mates of all the positions, each within the given number of moves and the
+// node limit (0 for none), spread over the given number of threads. Every thread has a
+// solver, and a hash table of the given size, of its own. The results are in the order of
+// the positions.
+std::vector<MateResult> solveMates(const std::vector<Position>& positions, int maxMoves, uint64_t nodeLimit,
+								   size_t megabytes, int threads);
@@ -0,0 +1,123 @@
+#include "Material.h"
+#include "Evaluation.h"
+#include "Position.h"
+
+namespace {
+	// Each piece type's contribution to the game phase:
+	const int phaseWeight[6] = { 0, 1, 1, 2, 4, 0 };
+
+	// nonPawnMaterial: counts, Color -> int
+	inline int nonPawnMaterial(const int counts[pieceCodes], Color c) {
+		int npm = 0;
+		for (int pt = KnightType; pt <= QueenType; pt++)
+			npm += counts[makePiece(c, PieceType(pt))] * pieceValue[pt];
+		return npm;
+	}
+
+	// scaleFor: counts, Color -> int
+	// A side without pawns that is ahead by no more than a minor piece can rarely win: not
+	// at all with less than a rook, and seldom otherwise.
+	int scaleFor(const int counts[pieceCodes], Color c) {
+		int ours = nonPawnMaterial(counts, c);
+		int theirs = nonPawnMaterial(counts, ~c);
+
+		if (counts[makePiece(c, PawnType)] == 0 && ours - theirs <= pieceValue[BishopType]) {
+			if (ours < pieceValue[RookType])
+				return 0;
+			return theirs <= pieceValue[BishopType] ? 4 : 14;
+		}
+		return scaleNormal;
+	}
+}
+
+MaterialTable::MaterialTable() : entries(tableSize) {
+	clear();
+}
+
+// probe: const Position& -> MaterialEntry&
+// Returns the entry of the position's material configuration.
+MaterialEntry& MaterialTable::probe(const Position& pos) {
+	if (version != evalWeightsVersion)
+		clear();
+
+	Key key = pos.materialKey();
+	MaterialEntry& e = entries[key & (tableSize - 1)];
+	if (e.key == key)
+		return e;
+
+	int counts[pieceCodes];
+	for (int piece = 0; piece < pieceCodes; piece++)
+		counts[piece] = popCount(pos.pieces(pieceColor(piece), pieceType(piece)));
+	return probe(key, counts);
+}
+
+// probe: Key, counts -> MaterialEntry&
+// Returns the entry of the material configuration with the given key and piece counts,
+// working it out first if the table does not hold it.
+MaterialEntry& MaterialTable::probe(Key key, const int counts[pieceCodes]) {
+	MaterialEntry& e = entries[key & (tableSize - 1)];
+	if (e.key == key)
+		return e;
+
+	e.key = key;
+	evaluateMaterial(counts, e, nullptr);
+	return e;
+}
+
+void MaterialTable::clear() {
+	for (MaterialEntry& e : entries)
+		e.key = 0;
+	version = evalWeightsVersion;
+	// Every empty entry holds the key 0, so a position whose material key happened to be 0
+	// would take entry 0 for its own. That slot is therefore given a valid entry, the one
+	// of the all-zero piece counts that key 0 stands for:
+	int counts[pieceCodes] = {};
+	entries[0].key = 1;
+	probe(0, counts);
+}
+
+MaterialTable& materialTable() {
+	thread_local MaterialTable table;
+	return table;
+}
+
+void evaluateMaterial(const int counts[pieceCodes], MaterialEntry& e, EvalTrace* trace) {
+	// The imbalance: the bishop pair, and the change in the worth of a knight and of a rook
+	// for each own pawn above five (a knight gains as the position closes, a rook loses as
+	// the files do).
+	int phase = 0;
+	int mg[2] = { 0, 0 };
+	int eg[2] = { 0, 0 };
+	for (int c = White; c <= Black; c++) {
+		const int* n = counts + makePiece(Color(c), PawnType);
+		for (int pt = PawnType; pt <= QueenType; pt++)
+			phase += n[pt] * phaseWeight[pt];
+
+		if (n[BishopType] >= 2)
+			addTerm(mg[c], eg[c], evalWeights.bishopPair, 1, Color(c), trace);
+		addTerm(mg[c], eg[c], evalWeights.knightPerPawn, (n[PawnType] - 5) * n[KnightType], Color(c), trace);
+		addTerm(mg[c], eg[c], evalWeights.rookPerPawn, (n[PawnType] - 5) * n[RookType], Color(c), trace);
+	}
+
+	int minors = counts[makePiece(White, KnightType)] + counts[makePiece(White, BishopType)]
+			   + counts[makePiece(Black, KnightType)] + counts[makePiece(Black, BishopType)];
+	int others = 0;
+	for (int c = White; c <= Black; c++)
+		for (PieceType pt : { PawnType, RookType, QueenType })
+			others += counts[makePiece(Color(c), pt)];
+
+	e.imbalanceMg = int16_t(mg[White] - mg[Black]);
+	e.imbalanceEg = int16_t(eg[White] - eg[Black]);
+	e.phase = uint8_t(phase < maxPhase ? phase : maxPhase);
+	e.scale[White] = uint8_t(scaleFor(counts, White));
+	e.scale[Black] = uint8_t(scaleFor(counts, Black));
+	e.draw = others == 0 && minors <= 1;
+}
+
+bool insufficientMaterial(const Position& pos) {
+	return materialTable().probe(pos).draw;
+}
+
+bool insufficientMaterial(const Position& pos, MaterialTable& table) {
+	return table.probe(pos).draw;
+}
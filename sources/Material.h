@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EngineDefinitions.h"
+
+class Position;
+struct EvalTrace;
+
+// The game phase of the full set of pieces; a bare-king endgame has phase 0:
+const int maxPhase = 24;
+
+// The endgame scale factors are out of scaleNormal:
+const int scaleNormal = 64;
+
+// MaterialEntry holds what the evaluation needs to know about one material configuration,
+// that is, about the number of pieces of each kind on the board.
+struct MaterialEntry {
+	Key key;
+	int16_t imbalanceMg;	// The bishop pair and the pieces' worth with the pawns, from White's point of view.
+	int16_t imbalanceEg;
+	uint8_t phase;			// The game phase, from 0 (bare kings) to maxPhase (all the pieces).
+	uint8_t scale[2];		// How much of the endgame score each side, when ahead, can hope to win.
+	bool draw;				// Neither side has the material to mate with: K v K, KB v K or KN v K.
+};
+
+// MaterialTable:
+// A hash table of material configurations, keyed by the material key.
+//
+// The material changes only with captures and promotions, so that the entries of a
+// search's few configurations are worked out once and read in constant time from then
+// on. Every search thread owns a table, kept from one search to the next, and the
+// code outside the searches uses the table of the calling thread (see materialTable).
+class MaterialTable
+{
+private:
+	static const size_t tableSize = 8192;		// A power of two.
+
+	std::vector<MaterialEntry> entries;
+	int version;								// The evalWeightsVersion the entries were worked out with.
+
+public:
+	MaterialTable();
+	MaterialEntry& probe(const Position& pos);
+	MaterialEntry& probe(Key key, const int counts[pieceCodes]);
+	void clear();
+};
+
+// materialTable: void -> MaterialTable&
+// Returns the material table of the calling thread, for the code outside the searches.
+MaterialTable& materialTable();
+
+// evaluateMaterial: counts, MaterialEntry&, EvalTrace* -> void
+// Works out everything but the key of the entry from the piece counts. Records the
+// imbalance terms in the trace if there is one.
+void evaluateMaterial(const int counts[pieceCodes], MaterialEntry& entry, EvalTrace* trace);
+
+// insufficientMaterial: const Position& -> bool
+// insufficientMaterial: const Position&, MaterialTable& -> bool
+// Returns true if neither side has the material to mate with. The searches pass their
+// own table.
+bool insufficientMaterial(const Position& pos);
+bool insufficientMaterial(const Position& pos, MaterialTable& table);
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "MonteCarloSearch.h"
+#include "Evaluation.h"
+#include "Material.h"
+#include "MoveGen.h"
+#include "SEE.h"
+
+namespace {
+	// The exploration constant of the PUCT formula:
+	const double cpuct = 1.5;
+
+	// The evaluations are turned into winning probabilities with a logistic curve on
+	// which an advantage of 400 centipawns is worth ten to one:
+	const double evalScale = 400.0 / std::log(10.0);
+
+	// The priors are a softmax of the moves' evaluations at this temperature, in centipawns:
+	const double priorTemperature = 100.0;
+
+	// The results are summed as fixed-point numbers:
+	const double valueUnit = 65536.0;
+
+	// The limits are looked at, and the progress reported, every pollInterval playouts:
+	const uint64_t pollInterval = 256;
+
+	inline float winProbability(int score) {
+		return float(1.0 / (1.0 + std::exp(-score / evalScale)));
+	}
+
+	inline int scoreOf(double probability) {
+		probability = (std::min)((std::max)(probability, 0.0001), 0.9999);
+		return int(std::lround(evalScale * std::log(probability / (1.0 - probability))));
+	}
+}
+
+// Private methods:
+// -----------------------------
+
+// allocate: count -> uint32_t
+// Allocates the given number of nodes next to each other and returns the index of the
+// first of them, or noNode if the arena is full. The nodes of one allocation never span
+// two blocks, and a block is only allocated when first needed.
+uint32_t MonteCarloSearch::allocate(uint32_t count) {
+	uint32_t first = used.load(std::memory_order_relaxed);
+	uint32_t start;
+	do {
+		start = first;
+		if ((start & (blockSize - 1)) + count > blockSize)
+			start = (start + blockSize - 1) & ~(blockSize - 1);
+		if ((start >> blockShift) >= maxBlocks)
+			return noNode;
+	} while (!used.compare_exchange_weak(first, start + count, std::memory_order_relaxed));
+
+	uint32_t block = start >> blockShift;
+	if (!blocks[block].load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(blockMutex);
+		if (!blocks[block].load(std::memory_order_relaxed)) {
+			ownedBlocks.emplace_back(new Node[blockSize]);
+			blocks[block].store(ownedBlocks.back().get(), std::memory_order_release);
+		}
+	}
+
+	return start;
+}
+
+// expand: Worker&, Position&, index, root -> bool
+// Creates the children of the node of the given position, or finds out that the position
+// is a checkmate, a stalemate or (except at the root) a draw. Returns false if the arena
+// is full.
+bool MonteCarloSearch::expand(Worker& worker, Position& pos, uint32_t index, bool root) {
+	Node& n = node(index);
+	MoveList moves(pos);
+
+	if (moves.size() == 0 || (!root && (pos.isDraw() || insufficientMaterial(pos, worker.material)))) {
+		// A checkmate is a win for the side that made the move leading to it:
+		n.eval = moves.size() == 0 && pos.inCheck() ? 1.0f : 0.5f;
+		n.state.store(Terminal, std::memory_order_release);
+		return true;
+	}
+
+	uint32_t first = allocate(uint32_t(moves.size()));
+	if (first == noNode) {
+		n.state.store(Leaf, std::memory_order_release);
+		return false;
+	}
+
+	double logits[maxMoves];
+	double largest = -1e9;
+	int i = 0;
+	for (const ScoredMove& sm : moves) {
+		int penalty = (std::min)(0, see(pos, sm.move));
+		pos.makeMove(sm.move);
+		int score = -evaluate(pos, worker.pawns, worker.material) + penalty;
+		pos.unmakeMove(sm.move);
+
+		Node& c = node(first + i);
+		c.visits.store(0, std::memory_order_relaxed);
+		c.virtualLoss.store(0, std::memory_order_relaxed);
+		c.valueSum.store(0, std::memory_order_relaxed);
+		c.eval.store(winProbability(score), std::memory_order_relaxed);
+		c.firstChild = 0;
+		c.move = sm.move;
+		c.childCount = 0;
+		c.state.store(Leaf, std::memory_order_relaxed);
+
+		logits[i] = score / priorTemperature;
+		largest = (std::max)(largest, logits[i]);
+		i++;
+	}
+
+	double sum = 0;
+	for (int j = 0; j < i; j++)
+		sum += (logits[j] = std::exp(logits[j] - largest));
+	for (int j = 0; j < i; j++)
+		node(first + j).prior = float(logits[j] / sum);
+
+	n.firstChild = first;
+	n.childCount = uint8_t(i);
+	n.state.store(Expanded, std::memory_order_release);
+	return true;
+}
+
+// select: index -> uint32_t
+// Returns the child of the expanded node with the highest Q + U. The virtual losses count
+// as visits that lost. A child not visited yet is valued by its static evaluation.
+uint32_t MonteCarloSearch::select(uint32_t index) {
+	Node& n = node(index);
+	double parentVisits = double(n.visits.load(std::memory_order_relaxed) + n.virtualLoss.load(std::memory_order_relaxed));
+	double sqrtVisits = std::sqrt((std::max)(parentVisits, 1.0));
+	uint32_t best = n.firstChild;
+	double bestValue = -1e9;
+
+	for (uint32_t i = n.firstChild; i < n.firstChild + n.childCount; i++) {
+		Node& c = node(i);
+		double visits = double(c.visits.load(std::memory_order_relaxed) + c.virtualLoss.load(std::memory_order_relaxed));
+		double q = visits > 0 ? c.valueSum.load(std::memory_order_relaxed) / valueUnit / visits : c.eval.load(std::memory_order_relaxed);
+		double value = q + cpuct * c.prior * sqrtVisits / (1.0 + visits);
+
+		if (value > bestValue) {
+			bestValue = value;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+// playout: Worker&, Position&, path, moves -> void
+// Walks down from the root to a node not expanded yet, expands it and backs its value
+// up the path. A node that another thread is expanding right now, or that cannot be
+// expanded, is valued by its static evaluation.
+void MonteCarloSearch::playout(Worker& worker, Position& pos, std::vector<uint32_t>& path, std::vector<Move>& moves) {
+	uint32_t current = 0;
+	path.assign(1, current);
+	moves.clear();
+	node(current).virtualLoss.fetch_add(1, std::memory_order_relaxed);
+
+	while (node(current).state.load(std::memory_order_acquire) == Expanded && path.size() < size_t(maxPly)) {
+		current = select(current);
+		node(current).virtualLoss.fetch_add(1, std::memory_order_relaxed);
+		pos.makeMove(node(current).move);
+		path.push_back(current);
+		moves.push_back(node(current).move);
+	}
+
+	Node& leaf = node(current);
+	uint8_t expected = Leaf;
+	if (path.size() < size_t(maxPly) && leaf.state.compare_exchange_strong(expected, Expanding, std::memory_order_acquire))
+		if (!expand(worker, pos, current, false))
+			stopped = true;
+	double value = leaf.eval.load(std::memory_order_relaxed);
+
+	for (size_t i = moves.size(); i > 0; i--)
+		pos.unmakeMove(moves[i - 1]);
+
+	// The value alternates between the sides on the way up:
+	for (size_t i = path.size(); i > 0; i--) {
+		Node& n = node(path[i - 1]);
+		n.valueSum.fetch_add(uint64_t(value * valueUnit), std::memory_order_relaxed);
+		n.visits.fetch_add(1, std::memory_order_relaxed);
+		n.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+		value = 1.0 - value;
+	}
+}
+
+// work: Worker&, bool -> void
+// The body of a search thread. The main thread also looks after the limits and reports
+// the progress whenever the principal variation has grown longer.
+void MonteCarloSearch::work(Worker& worker, bool mainThread) {
+	Position pos = rootPos;
+	pos.reserve(maxPly);
+	std::vector<uint32_t> path;
+	std::vector<Move> moves;
+	int reportedDepth = 0;
+
+	while (!stopped.load(std::memory_order_relaxed)) {
+		playout(worker, pos, path, moves);
+		uint64_t n = playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		if (!mainThread || n % pollInterval != 0)
+			continue;
+
+		if ((limits.nodes && n >= limits.nodes) || (!pondering && timeManager.softLimitReached()))
+			stopped = true;
+
+		int depth = int(line(0).size());
+		if (depth > reportedDepth) {
+			reportedDepth = depth;
+			if (onIteration)
+				onIteration(currentResult());
+			if (depth >= limits.depth)
+				stopped = true;
+		}
+	}
+}
+
+// line: index -> std::vector<Move>
+// Returns the principal variation from the node: the most visited child at every step.
+std::vector<Move> MonteCarloSearch::line(uint32_t index) {
+	std::vector<Move> pv;
+
+	while (node(index).state.load(std::memory_order_acquire) == Expanded && pv.size() < size_t(maxPly)) {
+		Node& n = node(index);
+		uint32_t best = noNode;
+		uint32_t bestVisits = 0;
+		for (uint32_t i = n.firstChild; i < n.firstChild + n.childCount; i++)
+			if (node(i).visits.load(std::memory_order_relaxed) > bestVisits) {
+				bestVisits = node(i).visits.load(std::memory_order_relaxed);
+				best = i;
+			}
+
+		if (best == noNode)
+			break;
+		pv.push_back(node(best).move);
+		index = best;
+	}
+
+	return pv;
+}
+
+// currentResult: void -> SearchResult
+// Describes the tree as it is: the most visited root moves, best first, each with its
+// average result as a score and its principal variation. The depth is the length of the
+// principal variation of the best move.
+SearchResult MonteCarloSearch::currentResult() {
+	SearchResult result;
+	Node& root = node(0);
+	if (root.state.load(std::memory_order_acquire) != Expanded)
+		return result;
+
+	std::vector<uint32_t> children;
+	for (uint32_t i = root.firstChild; i < root.firstChild + root.childCount; i++)
+		children.push_back(i);
+	std::stable_sort(children.begin(), children.end(), [this](uint32_t a, uint32_t b) {
+		return node(a).visits.load(std::memory_order_relaxed) > node(b).visits.load(std::memory_order_relaxed);
+	});
+
+	for (size_t k = 0; k < children.size() && int(k) < multiPV; k++) {
+		Node& c = node(children[k]);
+		uint32_t visits = c.visits.load(std::memory_order_relaxed);
+		PVLine pvLine;
+
+		if (c.state.load(std::memory_order_acquire) == Terminal && c.eval.load(std::memory_order_relaxed) == 1.0f)
+			pvLine.score = mateIn(1);
+		else
+			pvLine.score = scoreOf(visits ? c.valueSum.load(std::memory_order_relaxed) / valueUnit / visits : c.eval.load(std::memory_order_relaxed));
+
+		pvLine.pv.push_back(c.move);
+		std::vector<Move> rest = line(children[k]);
+		pvLine.pv.insert(pvLine.pv.end(), rest.begin(), rest.end());
+		result.lines.push_back(pvLine);
+	}
+
+	result.bestMove = result.lines[0].pv[0];
+	result.score = result.lines[0].score;
+	result.pv = result.lines[0].pv;
+	result.depth = int(result.pv.size());
+	result.nodes = nodeCount();
+	return result;
+}
+
+// Public methods:
+// -----------------------------
+
+// The arena may hold at most the given number of megabytes of nodes.
+MonteCarloSearch::MonteCarloSearch(size_t megabytes) {
+	maxBlocks = uint32_t((std::max)(megabytes * 1024 * 1024 / (sizeof(Node) * blockSize), size_t(1)));
+	blocks.reset(new std::atomic<Node*>[maxBlocks]);
+	for (uint32_t b = 0; b < maxBlocks; b++)
+		blocks[b] = nullptr;
+	used = 0;
+	stopped = pondering = false;
+	playouts = 0;
+	multiPV = 1;
+}
+
+// run: const Position&, const SearchLimits&, threads -> SearchResult
+// Builds the tree with the given number of threads until the limits are reached, the
+// arena is full or the search is stopped, and returns the most visited moves. Counts
+// the playouts as the nodes. A depth limit is taken as the length of the principal
+// variation to reach.
+SearchResult MonteCarloSearch::run(const Position& pos, const SearchLimits& _limits, int threads) {
+	limits = _limits;
+	rootPos = pos;
+	multiPV = (std::max)(limits.multiPV, 1);
+	timeManager.init(limits, pos.sideToMove());
+	playouts = 0;
+	used = 0;
+	while (workers.size() < size_t((std::max)(threads, 1)))
+		workers.emplace_back(new Worker);
+
+	uint32_t root = allocate(1);
+	Node& r = node(root);
+	r.visits = r.virtualLoss = 0;
+	r.valueSum = 0;
+	r.eval = 0.5f;
+	r.childCount = 0;
+	r.state = Expanding;
+	expand(*workers[0], rootPos, root, true);
+
+	SearchResult result;
+	if (r.state == Expanded) {
+		std::vector<std::thread> helpers;
+		for (int t = 1; t < threads; t++)
+			helpers.emplace_back([this, t] { work(*workers[t], false); });
+		work(*workers[0], true);
+		for (std::thread& t : helpers)
+			t.join();
+
+		result = currentResult();
+	}
+
+	stopped = false;
+	pondering = false;
+	return result;
+}
+
+// ponderhit: void -> void
+// The opponent played the move the search was pondering on: the search goes on as
+// a normal search, with the clock running from now. Safe to call from another thread.
+void MonteCarloSearch::ponderhit() {
+	timeManager.restart(now());
+	pondering = false;
+}
+
+void MonteCarloSearch::stop() {
+	stopped = true;
+}
+
+// prepare: const SearchLimits& -> void
+// Withdraws a stop request that arrived when no search was running, and enters the
+// ponder mode if the limits ask for it, like Search::prepare.
+void MonteCarloSearch::prepare(const SearchLimits& limits) {
+	stopped = false;
+	playouts = 0;
+	pondering = limits.ponder;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "Material.h"
+#include "Pawns.h"
+#include "Position.h"
+#include "Search.h"
+#include "TimeManager.h"
+
+// MonteCarloSearch:
+// A Monte Carlo tree search guided by the PUCT formula, as an alternative to the
+// alpha-beta search.
+//
+// Every playout walks down the tree from the root, at each node choosing the child
+// that maximizes Q + U: Q is the average result of the playouts through the child, and
+// U = cpuct * prior * sqrt(parent visits) / (1 + child visits) favours the children that
+// are promising but little visited. The node reached is expanded and its static evaluation,
+// turned into a winning probability, is backed up the path instead of the result of a
+// random game. The priors of the moves come from the static evaluations of the positions
+// they lead to, lowered for moves that put a piece en prise.
+//
+// Several threads build the same tree at once. A thread passing a node adds a virtual
+// loss to it, which makes the node look worse to the other threads until the playout has
+// been backed up, so that they spread out over the tree instead of all following the same
+// path. The counts are atomic and no locks are taken, except when the node arena grows.
+//
+// The nodes are allocated from an arena of fixed-size blocks, which grows as the tree
+// does, up to a limit. The tree is built anew for every search; the blocks are kept
+// for the next one. The search stops when the arena is full.
+class MonteCarloSearch
+{
+private:
+	enum NodeState : uint8_t { Leaf, Expanding, Expanded, Terminal };
+
+	// Node is one position of the tree. The values are from the point of view of the
+	// side that made the move leading to the node, between 0 (a loss) and 1 (a win).
+	struct Node {
+		std::atomic<uint32_t> visits;
+		std::atomic<uint32_t> virtualLoss;		// The playouts passing through the node right now.
+		std::atomic<uint64_t> valueSum;			// The sum of the results, in units of 1 / valueUnit.
+		std::atomic<float> eval;				// The static evaluation, or the exact value if terminal.
+		float prior;
+		uint32_t firstChild;					// The children are next to each other in the arena.
+		Move move;
+		uint8_t childCount;
+		std::atomic<uint8_t> state;
+	};
+
+	// Worker holds what a search thread keeps for itself: the evaluation's tables. The
+	// workers are kept from one search to the next, the first of them for the main thread.
+	struct Worker {
+		PawnTable pawns;
+		MaterialTable material;
+	};
+
+	static const int blockShift = 16;			// 65536 nodes per block.
+	static const uint32_t blockSize = 1u << blockShift;
+	static const uint32_t noNode = UINT32_MAX;
+
+	std::unique_ptr<std::atomic<Node*>[]> blocks;
+	std::vector<std::unique_ptr<Node[]>> ownedBlocks;
+	std::mutex blockMutex;
+	uint32_t maxBlocks;
+	std::atomic<uint32_t> used;
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	std::atomic<bool> stopped;
+	std::atomic<bool> pondering;
+	std::atomic<uint64_t> playouts;
+	SearchLimits limits;
+	TimeManager timeManager;
+	Position rootPos;
+	int multiPV;
+
+	Node& node(uint32_t index) { return blocks[index >> blockShift].load(std::memory_order_acquire)[index & (blockSize - 1)]; }
+	uint32_t allocate(uint32_t count);
+	bool expand(Worker& worker, Position& pos, uint32_t index, bool root);
+	uint32_t select(uint32_t index);
+	void playout(Worker& worker, Position& pos, std::vector<uint32_t>& path, std::vector<Move>& moves);
+	void work(Worker& worker, bool mainThread);
+	std::vector<Move> line(uint32_t index);
+	SearchResult currentResult();
+
+public:
+	std::function<void(const SearchResult&)> onIteration;
+
+	explicit MonteCarloSearch(size_t megabytes = 1024);
+	SearchResult run(const Position& pos, const SearchLimits& limits, int threads);
+	const TimeManager& time() const { return timeManager; }
+	uint64_t nodeCount() const { return playouts.load(std::memory_order_relaxed); }
+	void ponderhit();
+	void stop();
+	void prepare(const SearchLimits& limits);
+};
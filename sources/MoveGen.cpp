@@ -0,0 +1,220 @@
+#include "MoveGen.h"
+#include "Position.h"
+
+namespace {
+
+	// shiftBB: Bitboard, step -> Bitboard
+	// Shifts all the squares of the bitboard one step towards the given square offset,
+	// dropping the squares that would wrap around the board edge.
+	inline Bitboard shiftBB(Bitboard b, int step) {
+		switch (step) {
+			case 8:	  return b << 8;
+			case -8:  return b >> 8;
+			case 9:	  return (b & ~fileHBB) << 9;
+			case 7:	  return (b & ~fileABB) << 7;
+			case -7:  return (b & ~fileHBB) >> 7;
+			case -9:  return (b & ~fileABB) >> 9;
+			default:  return 0;
+		}
+	}
+
+	inline ScoredMove* addMove(ScoredMove* list, Move m) {
+		list->move = m;
+		list->score = 0;
+		return list + 1;
+	}
+
+	// addPromotions: list, from, to, GenType, capture -> list
+	// Queen promotions go to the captures, underpromotions to the quiet moves,
+	// except for capturing promotions, which are all generated with the captures.
+	ScoredMove* addPromotions(ScoredMove* list, int from, int to, GenType type, bool capture) {
+		bool queens = type != Quiets;
+		bool underpromotions = type != Captures || capture;
+		if (capture && type == Quiets)
+			return list;
+
+		if (queens)
+			list = addMove(list, encodeMove(from, to, PromotionMove, QueenType));
+		if (underpromotions) {
+			list = addMove(list, encodeMove(from, to, PromotionMove, RookType));
+			list = addMove(list, encodeMove(from, to, PromotionMove, BishopType));
+			list = addMove(list, encodeMove(from, to, PromotionMove, KnightType));
+		}
+		return list;
+	}
+
+	ScoredMove* generatePawnMoves(const Position& pos, GenType type, Bitboard target, ScoredMove* list) {
+		Color us = pos.sideToMove();
+		Color them = ~us;
+		int up = us == White ? 8 : -8;
+		int upLeft = us == White ? 7 : -9;
+		int upRight = us == White ? 9 : -7;
+		Bitboard rank7 = rankBB(relativeRank(us, 6));
+		Bitboard rank3 = rankBB(relativeRank(us, 2));
+
+		Bitboard pawns = pos.pieces(us, PawnType);
+		Bitboard pawnsOn7 = pawns & rank7;
+		Bitboard others = pawns & ~rank7;
+		Bitboard empty = ~pos.pieces();
+		Bitboard enemies = pos.pieces(them);
+		if (type == Evasions)
+			enemies &= target;
+
+		// 1. Single and double pushes:
+		if (type != Captures) {
+			Bitboard single = shiftBB(others, up) & empty;
+			Bitboard twice = shiftBB(single & rank3, up) & empty;
+			if (type == Evasions) {
+				single &= target;
+				twice &= target;
+			}
+			while (single) {
+				int to = popLsb(single);
+				list = addMove(list, encodeMove(to - up, to));
+			}
+			while (twice) {
+				int to = popLsb(twice);
+				list = addMove(list, encodeMove(to - 2 * up, to));
+			}
+		}
+
+		// 2. Promotions, with and without a capture:
+		if (pawnsOn7) {
+			Bitboard pushes = shiftBB(pawnsOn7, up) & empty;
+			if (type == Evasions)
+				pushes &= target;
+			while (pushes) {
+				int to = popLsb(pushes);
+				list = addPromotions(list, to - up, to, type, false);
+			}
+			for (int step : { upLeft, upRight }) {
+				Bitboard captures = shiftBB(pawnsOn7, step) & enemies;
+				while (captures) {
+					int to = popLsb(captures);
+					list = addPromotions(list, to - step, to, type, true);
+				}
+			}
+		}
+
+		// 3. Ordinary captures and en passant:
+		if (type != Quiets) {
+			for (int step : { upLeft, upRight }) {
+				Bitboard captures = shiftBB(others, step) & enemies;
+				while (captures) {
+					int to = popLsb(captures);
+					list = addMove(list, encodeMove(to - step, to));
+				}
+			}
+
+			int ep = pos.epSquare();
+			if (ep != noSquare) {
+				// When evading a check, an en passant capture helps only if it captures
+				// the checking pawn or blocks the check:
+				if (type == Evasions && !(target & (squareBB(ep) | squareBB(ep - up))))
+					return list;
+
+				Bitboard attackers = others & pawnAttacksBB[them][ep];
+				while (attackers)
+					list = addMove(list, encodeMove(popLsb(attackers), ep, EnPassantMove));
+			}
+		}
+
+		return list;
+	}
+
+	ScoredMove* generatePieceMoves(const Position& pos, PieceType pt, Bitboard target, ScoredMove* list) {
+		Bitboard occupied = pos.pieces();
+		for (Bitboard b = pos.pieces(pos.sideToMove(), pt); b; ) {
+			int from = popLsb(b);
+			Bitboard attacks = pieceAttacks(pt, from, occupied) & target;
+			while (attacks)
+				list = addMove(list, encodeMove(from, popLsb(attacks)));
+		}
+		return list;
+	}
+
+	// generateCastling: const Position&, ScoredMove* -> ScoredMove*
+	// Generates the castling moves of the side to move, which must not be in check.
+	// The squares the king passes over are checked here, so that castling moves
+	// are always legal.
+	ScoredMove* generateCastling(const Position& pos, ScoredMove* list) {
+		Color us = pos.sideToMove();
+		int rights = pos.castlingRights() & (us == White ? (WhiteOO | WhiteOOO) : (BlackOO | BlackOOO));
+		int rank = us == White ? 0 : 7;
+		int kingSq = makeSquare(4, rank);
+		Bitboard occupied = pos.pieces();
+
+		if ((rights & (WhiteOO | BlackOO)) &&
+			!(occupied & (squareBB(makeSquare(5, rank)) | squareBB(makeSquare(6, rank)))) &&
+			!pos.isAttacked(makeSquare(5, rank), ~us) && !pos.isAttacked(makeSquare(6, rank), ~us))
+			list = addMove(list, encodeMove(kingSq, makeSquare(6, rank), CastlingMove));
+
+		if ((rights & (WhiteOOO | BlackOOO)) &&
+			!(occupied & (squareBB(makeSquare(1, rank)) | squareBB(makeSquare(2, rank)) | squareBB(makeSquare(3, rank)))) &&
+			!pos.isAttacked(makeSquare(3, rank), ~us) && !pos.isAttacked(makeSquare(2, rank), ~us))
+			list = addMove(list, encodeMove(kingSq, makeSquare(2, rank), CastlingMove));
+
+		return list;
+	}
+}
+
+ScoredMove* generateMoves(const Position& pos, GenType type, ScoredMove* list) {
+	Color us = pos.sideToMove();
+	int ksq = pos.kingSquare(us);
+	Bitboard target;
+
+	switch (type) {
+		case Captures:	  target = pos.pieces(~us); break;
+		case Quiets:	  target = ~pos.pieces(); break;
+		case NonEvasions: target = ~pos.pieces(us); break;
+		default:
+			// Evasions: in a double check only the king can move. Otherwise the other
+			// pieces have to capture the checker or block the line of the check:
+			if (moreThanOne(pos.checkers())) {
+				Bitboard kingMoves = kingAttacksBB[ksq] & ~pos.pieces(us);
+				while (kingMoves)
+					list = addMove(list, encodeMove(ksq, popLsb(kingMoves)));
+				return list;
+			}
+			int checker = lsb(pos.checkers());
+			target = betweenBB[ksq][checker] | squareBB(checker);
+			break;
+	}
+
+	list = generatePawnMoves(pos, type, target, list);
+	for (PieceType pt : { KnightType, BishopType, RookType, QueenType })
+		list = generatePieceMoves(pos, pt, target, list);
+
+	Bitboard kingTarget = type == Evasions ? ~pos.pieces(us) : target;
+	Bitboard kingMoves = kingAttacksBB[ksq] & kingTarget;
+	while (kingMoves)
+		list = addMove(list, encodeMove(ksq, popLsb(kingMoves)));
+
+	if ((type == Quiets || type == NonEvasions) && pos.castlingRights())
+		list = generateCastling(pos, list);
+
+	return list;
+}
+
+ScoredMove* generateLegal(const Position& pos, ScoredMove* list) {
+	ScoredMove* last = generateMoves(pos, pos.inCheck() ? Evasions : NonEvasions, list);
+
+	for (ScoredMove* cur = list; cur != last; )
+		if (!pos.isLegal(cur->move))
+			*cur = *--last;
+		else
+			++cur;
+
+	return last;
+}
+
+MoveList::MoveList(const Position& pos) {
+	last = generateLegal(pos, moves);
+}
+
+bool MoveList::contains(Move m) const {
+	for (const ScoredMove* sm = moves; sm != last; ++sm)
+		if (sm->move == m)
+			return true;
+	return false;
+}
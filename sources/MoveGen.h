@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include "EngineDefinitions.h"
+
+class Position;
+
+// The move generator produces pseudo-legal moves of the given kind:
+//
+// Captures:	captures of enemy pieces, en passant captures and queen promotions
+// Quiets:		non-capturing moves, castling and underpromotions
+// Evasions:	every move that may get the side to move out of check
+// NonEvasions: Captures and Quiets together, used when not in check
+//
+// The pseudo-legal moves may still leave the mover's king in check, which
+// is verified with Position::isLegal just before the move is made.
+enum GenType { Captures, Quiets, Evasions, NonEvasions };
+
+// generateMoves: const Position&, GenType, ScoredMove* -> ScoredMove*
+// Writes the moves of the given type into the list and returns the end of the list.
+ScoredMove* generateMoves(const Position& pos, GenType type, ScoredMove* list);
+
+// generateLegal: const Position&, ScoredMove* -> ScoredMove*
+// Writes all the legal moves into the list and returns the end of the list.
+ScoredMove* generateLegal(const Position& pos, ScoredMove* list);
+
+// MoveList:
+// A convenience wrapper for iterating over all the legal moves of a position:
+// for (const ScoredMove& sm : MoveList(pos)) { /* Do something */ }
+class MoveList {
+private:
+	ScoredMove moves[maxMoves];
+	ScoredMove* last;
+
+public:
+	explicit MoveList(const Position& pos);
+	const ScoredMove* begin() const { return moves; }
+	const ScoredMove* end() const { return last; }
+	size_t size() const { return last - moves; }
+	bool contains(Move m) const;
+};
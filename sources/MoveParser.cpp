@@ -64,17 +64,6 @@ MoveParser::MoveParser() {
 void MoveParser::parseNewMove(MoveAnalysisResults& results) {
 	std::string& move = results.move;
 
-	// Check for Castling moves:
-	if (!move.compare(shortCastling)) {
-		results.movedP = MoveId::OO;
-		return;
-	}
-
-	if (!move.compare(longCastling)) {
-		results.movedP = MoveId::OOO;
-		return;
-	}
-
 	// Check for a promotion move:
 	// (Promotion moves are maainly used by the game loader)
 	size_t promo = move.find(promotionSymbol);
@@ -87,6 +76,17 @@ void MoveParser::parseNewMove(MoveAnalysisResults& results) {
 	// Before processing further, sptrip the move off of any special notations:
 	stripSpecialNotation(move);
 
+	// Check for Castling moves (the saved games have them with the check notation, too):
+	if (!move.compare(shortCastling)) {
+		results.movedP = MoveId::OO;
+		return;
+	}
+
+	if (!move.compare(longCastling)) {
+		results.movedP = MoveId::OOO;
+		return;
+	}
+
 	size_t i = 1;
 	size_t len = move.length();
 
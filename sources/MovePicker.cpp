@@ -0,0 +1,220 @@
+#include "MovePicker.h"
+#include "Position.h"
+#include "Evaluation.h"
+#include "SEE.h"
+
+namespace {
+
+	// Evasion captures are always tried before the quiet evasions:
+	const int captureBonus = 1 << 24;
+
+	// capturedType: Position, Move -> PieceType
+	// Returns the type of the piece captured by the move (a pawn for en passant).
+	inline PieceType capturedType(const Position& pos, Move m) {
+		if (moveKind(m) == EnPassantMove)
+			return PawnType;
+		int piece = pos.pieceOn(moveTo(m));
+		return piece == noPiece ? NoPieceType : pieceType(piece);
+	}
+}
+
+// Private methods:
+// -----------------------------
+
+// scoreCaptures: void -> void
+// Scores the captures by most valuable victim / least valuable attacker.
+// Promotions get the value of the promoted piece on top.
+void MovePicker::scoreCaptures() {
+	for (ScoredMove* sm = cur; sm != endMoves; ++sm) {
+		Move m = sm->move;
+		sm->score = 8 * pieceValue[capturedType(pos, m)] - pieceValue[pieceType(pos.movedPiece(m))] / 8;
+		if (moveKind(m) == PromotionMove)
+			sm->score += 8 * pieceValue[promotionType(m)];
+	}
+}
+
+void MovePicker::scoreQuiets() {
+	Color us = pos.sideToMove();
+	for (ScoredMove* sm = cur; sm != endMoves; ++sm)
+		sm->score = history[us][moveFrom(sm->move)][moveTo(sm->move)];
+}
+
+void MovePicker::scoreEvasions() {
+	Color us = pos.sideToMove();
+	for (ScoredMove* sm = cur; sm != endMoves; ++sm) {
+		Move m = sm->move;
+		if (pos.isCapture(m))
+			sm->score = captureBonus + 8 * pieceValue[capturedType(pos, m)] - pieceValue[pieceType(pos.movedPiece(m))] / 8;
+		else
+			sm->score = history[us][moveFrom(m)][moveTo(m)];
+	}
+}
+
+// pickBest: void -> ScoredMove*
+// Moves the best scored remaining move to the front of the remaining moves and
+// returns it. A full sort would mostly be wasted, since many nodes only need
+// their first few moves.
+ScoredMove* MovePicker::pickBest() {
+	ScoredMove* best = cur;
+	for (ScoredMove* sm = cur + 1; sm != endMoves; ++sm)
+		if (sm->score > best->score)
+			best = sm;
+
+	ScoredMove tmp = *cur;
+	*cur = *best;
+	*best = tmp;
+	return cur++;
+}
+
+// Public methods:
+// -----------------------------
+
+MovePicker::MovePicker(const Position& _pos, Move _ttMove, const Move* killers, Move counterMove, const ButterflyHistory& _history)
+	: pos(_pos), history(_history) {
+	ttMove = _ttMove != noMove && pos.isPseudoLegal(_ttMove) ? _ttMove : noMove;
+	refutations[0] = killers[0];
+	refutations[1] = killers[1];
+	refutations[2] = counterMove;
+	refutationIdx = 0;
+	cur = endMoves = endBadCaptures = moves;
+
+	if (pos.inCheck())
+		stage = ttMove != noMove ? EvasionTT : EvasionInit;
+	else
+		stage = ttMove != noMove ? MainTT : CaptureInit;
+}
+
+// The quiescence search constructor: only captures and queen promotions are
+// returned, unless the side to move is in check.
+MovePicker::MovePicker(const Position& _pos, Move _ttMove, const ButterflyHistory& _history)
+	: pos(_pos), history(_history) {
+	refutations[0] = refutations[1] = refutations[2] = noMove;
+	refutationIdx = 0;
+	cur = endMoves = endBadCaptures = moves;
+
+	if (pos.inCheck()) {
+		ttMove = _ttMove != noMove && pos.isPseudoLegal(_ttMove) ? _ttMove : noMove;
+		stage = ttMove != noMove ? EvasionTT : EvasionInit;
+	}
+	else {
+		bool tactical = _ttMove != noMove && (pos.isCapture(_ttMove) || moveKind(_ttMove) == PromotionMove);
+		ttMove = tactical && pos.isPseudoLegal(_ttMove) ? _ttMove : noMove;
+		stage = ttMove != noMove ? QSearchTT : QCaptureInit;
+	}
+}
+
+// nextMove: void -> Move
+// Returns the next pseudo-legal move, or noMove when all the moves have been returned.
+Move MovePicker::nextMove() {
+	while (true) {
+		switch (stage) {
+			case MainTT:
+			case EvasionTT:
+				stage++;
+				return ttMove;
+
+			case CaptureInit:
+				cur = endBadCaptures = moves;
+				endMoves = generateMoves(pos, Captures, cur);
+				scoreCaptures();
+				stage++;
+				break;
+
+			case GoodCaptures:
+				while (cur != endMoves) {
+					ScoredMove* sm = pickBest();
+					if (sm->move == ttMove)
+						continue;
+					// Losing captures are moved to the front of the list to be tried last:
+					if (!seeGE(pos, sm->move, 0)) {
+						*endBadCaptures++ = *sm;
+						continue;
+					}
+					return sm->move;
+				}
+				stage++;
+				break;
+
+			case Refutations:
+				while (refutationIdx < refutationCount) {
+					Move& r = refutations[refutationIdx++];
+					bool duplicate = false;
+					for (int i = 0; i < refutationIdx - 1; i++)
+						duplicate |= r == refutations[i];
+
+					if (r != noMove && r != ttMove && !duplicate &&
+						moveKind(r) != PromotionMove && !pos.isCapture(r) && pos.isPseudoLegal(r))
+						return r;
+					// A refutation that was not returned must not be skipped by the quiet stage:
+					r = noMove;
+				}
+				stage++;
+				break;
+
+			case QuietInit:
+				cur = endBadCaptures;
+				endMoves = generateMoves(pos, Quiets, cur);
+				scoreQuiets();
+				stage++;
+				break;
+
+			case QuietMoves:
+				while (cur != endMoves) {
+					Move m = pickBest()->move;
+					if (m != ttMove && m != refutations[0] && m != refutations[1] && m != refutations[2])
+						return m;
+				}
+				cur = moves;
+				stage++;
+				break;
+
+			case BadCaptures:
+				while (cur != endBadCaptures) {
+					Move m = (cur++)->move;
+					if (m != ttMove)
+						return m;
+				}
+				stage = Finished;
+				break;
+
+			case QSearchTT:
+				stage++;
+				return ttMove;
+
+			case QCaptureInit:
+				cur = moves;
+				endMoves = generateMoves(pos, Captures, cur);
+				scoreCaptures();
+				stage++;
+				break;
+
+			case QCaptures:
+				while (cur != endMoves) {
+					Move m = pickBest()->move;
+					if (m != ttMove)
+						return m;
+				}
+				stage = Finished;
+				break;
+
+			case EvasionInit:
+				cur = moves;
+				endMoves = generateMoves(pos, Evasions, cur);
+				scoreEvasions();
+				stage++;
+				break;
+
+			case AllEvasions:
+				while (cur != endMoves) {
+					Move m = pickBest()->move;
+					if (m != ttMove)
+						return m;
+				}
+				stage = Finished;
+				break;
+
+			default:
+				return noMove;
+		}
+	}
+}
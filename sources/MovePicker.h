@@ -0,0 +1,69 @@
+#pragma once
+#include "EngineDefinitions.h"
+#include "MoveGen.h"
+
+class Position;
+
+// ButterflyHistory is indexed by [side][from][to]. It collects the success of the
+// quiet moves during the search and is used for ordering them.
+typedef int ButterflyHistory[2][64][64];
+
+// CounterMoveTable is indexed by [piece][to] of the previous move. It holds the quiet
+// move that last refuted that move.
+typedef Move CounterMoveTable[pieceCodes][64];
+
+// MovePicker:
+// Hands out the pseudo-legal moves of a position one at a time, best guesses first.
+//
+// The moves are produced in stages and each stage is generated only once the previous
+// one has been exhausted, so a node that is cut off by its first move never pays for
+// generating the rest:
+//
+//   1. the transposition table move
+//   2. captures that do not lose material according to SEE, most valuable victim / least
+//      valuable attacker first
+//   3. the refutations: the two killer moves and the countermove
+//   4. quiet moves, ordered by their history
+//   5. the losing captures deferred by stage 2
+//
+// When in check all the evasions are generated at once, captures first.
+//
+// The quiescence search picker returns only the TT move and the captures (including
+// queen promotions), unless in check. Pruning the losing captures is left to the search.
+//
+// The moves coming from outside of the generator (the TT move and the refutations) are
+// checked with Position::isPseudoLegal. Every move still needs to be checked with
+// Position::isLegal before it is made.
+class MovePicker
+{
+private:
+	enum Stage {
+		MainTT, CaptureInit, GoodCaptures, Refutations, QuietInit, QuietMoves, BadCaptures,
+		EvasionTT, EvasionInit, AllEvasions,
+		QSearchTT, QCaptureInit, QCaptures,
+		Finished
+	};
+
+	const Position& pos;
+	const ButterflyHistory& history;
+	Move ttMove;
+	static const int refutationCount = 3;
+	Move refutations[refutationCount];
+	int stage;
+	int refutationIdx;
+
+	ScoredMove moves[maxMoves];
+	ScoredMove* cur;
+	ScoredMove* endMoves;
+	ScoredMove* endBadCaptures;
+
+	void scoreCaptures();
+	void scoreQuiets();
+	void scoreEvasions();
+	ScoredMove* pickBest();
+
+public:
+	MovePicker(const Position& pos, Move ttMove, const Move* killers, Move counterMove, const ButterflyHistory& history);
+	MovePicker(const Position& pos, Move ttMove, const ButterflyHistory& history);
+	Move nextMove();
+};
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include "MoveStats.h"
+
+namespace {
+	const char* phaseNames[movePhases] = { "parse", "extract", "castling", "validate", "commit", "finalize", "canMove", "total" };
+	const char* rejectionNames[moveRejections] = { "parse error", "illegal move", "bad square", "king left in check", "game over" };
+
+	// percentile: const PhaseStats&, fraction -> uint64_t
+	// Returns the upper bound of the histogram bucket holding the given fraction of the runs.
+	uint64_t percentile(const PhaseStats& phase, double fraction) {
+		if (phase.calls == 0)
+			return 0;
+
+		uint64_t target = uint64_t(fraction * phase.calls);
+		uint64_t seen = 0;
+		for (int b = 0; b < latencyBuckets; b++) {
+			seen += phase.histogram[b];
+			if (seen > target || b == latencyBuckets - 1)
+				return (uint64_t(1) << b) - 1;
+		}
+		return 0;
+	}
+}
+
+#if defined(CLICHESS_MOVE_STATS)
+
+MoveStats moveStats = MoveStats();
+
+MoveStats moveStatsSnapshot() {
+	MoveStats snapshot = moveStats;
+	snapshot.enabled = true;
+	return snapshot;
+}
+
+void resetMoveStats() {
+	moveStats = MoveStats();
+}
+
+#else
+
+MoveStats moveStatsSnapshot() {
+	return MoveStats();
+}
+
+void resetMoveStats() {
+}
+
+#endif
+
+std::string moveStatsReport(const MoveStats& stats) {
+	if (!stats.enabled)
+		return "The move statistics are disabled. Build with CLICHESS_MOVE_STATS defined to enable them.\n";
+
+	std::string report;
+	char line[160];
+	std::snprintf(line, sizeof(line), "%-10s %10s %14s %12s %12s %12s\n", "Phase", "calls", "total cycles", "mean", "p50 <=", "p99 <=");
+	report += line;
+
+	for (int p = 0; p < movePhases; p++) {
+		const PhaseStats& phase = stats.phases[p];
+		std::snprintf(line, sizeof(line), "%-10s %10llu %14llu %12llu %12llu %12llu\n", phaseNames[p],
+					  (unsigned long long)phase.calls, (unsigned long long)phase.cycles,
+					  (unsigned long long)(phase.calls ? phase.cycles / phase.calls : 0),
+					  (unsigned long long)percentile(phase, 0.5), (unsigned long long)percentile(phase, 0.99));
+		report += line;
+	}
+
+	report += "Rejected moves:";
+	for (int r = 0; r < moveRejections; r++)
+		report += std::string(r ? ", " : " ") + rejectionNames[r] + " " + std::to_string(stats.rejections[r]);
+	return report + "\n";
+}
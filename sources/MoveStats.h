@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "Bitboards.h"
+
+#if defined(CLICHESS_MOVE_STATS)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+// The instrumentation of GameManager::makeMove: how many times each phase of a move ran,
+// the cycles it took and their histogram, and how many moves were rejected for each reason.
+//
+// The counting is compiled in only when CLICHESS_MOVE_STATS is defined (-DCLICHESS_MOVE_STATS).
+// Otherwise PhaseTimer and countRejection are empty and compile to nothing, and the
+// snapshot tells that the statistics are disabled.
+
+// MovePhase: the phases of makeMove. CanMove runs within Finalize, and Total covers the
+// whole of makeMove:
+enum class MovePhase { Parse, Extract, Castling, Validate, Commit, Finalize, CanMove, Total, Count };
+
+// MoveRejection: the reasons a move is rejected for, the exceptions of the move analysis
+// first:
+enum class MoveRejection { Parse, IllegalMove, SquareValidation, LeavesKingInCheck, GameOver, Count };
+
+const int movePhases = int(MovePhase::Count);
+const int moveRejections = int(MoveRejection::Count);
+
+// The histogram of a phase counts its runs by the bit length of their cycle count:
+// bucket b holds the runs of 2^(b-1) to 2^b - 1 cycles, the last one all the longer runs.
+const int latencyBuckets = 40;
+
+// PhaseStats are the statistics of one phase:
+struct PhaseStats {
+	uint64_t calls;
+	uint64_t cycles;
+	uint64_t histogram[latencyBuckets];
+};
+
+// MoveStats are the statistics of all the phases:
+struct MoveStats {
+	bool enabled;				// False if the program was built without them, when all the counts are zero.
+	PhaseStats phases[movePhases];
+	uint64_t rejections[moveRejections];
+};
+
+// moveStatsSnapshot: void -> MoveStats
+// Returns the statistics gathered since the start of the program or the last reset.
+MoveStats moveStatsSnapshot();
+
+// resetMoveStats: void -> void
+void resetMoveStats();
+
+// moveStatsReport: const MoveStats& -> std::string
+// Returns the statistics as a table: the calls, mean and total cycles and the median and
+// 99th percentile (the upper bounds of their histogram buckets) of each phase, and the
+// rejections of each reason.
+std::string moveStatsReport(const MoveStats& stats);
+
+#if defined(CLICHESS_MOVE_STATS)
+
+// The statistics are counted here. They are not synchronized: the program plays one game
+// at a time.
+extern MoveStats moveStats;
+
+// cycleCount: void -> uint64_t
+// Returns the processor's time stamp counter, or the steady clock where there is none.
+inline uint64_t cycleCount() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// PhaseTimer:
+// Counts a run of a phase and its cycles from its construction to its destruction, so
+// that a phase left with an exception is counted too.
+class PhaseTimer
+{
+private:
+	PhaseStats& stats;
+	uint64_t start;
+
+public:
+	explicit PhaseTimer(MovePhase phase) : stats(moveStats.phases[int(phase)]) { start = cycleCount(); }
+	~PhaseTimer() {
+		uint64_t cycles = cycleCount() - start;
+		int bucket = cycles ? msb(cycles) + 1 : 0;
+		stats.calls++;
+		stats.cycles += cycles;
+		stats.histogram[bucket < latencyBuckets ? bucket : latencyBuckets - 1]++;
+	}
+};
+
+inline void countRejection(MoveRejection reason) {
+	moveStats.rejections[int(reason)]++;
+}
+
+#else
+
+class PhaseTimer
+{
+public:
+	explicit PhaseTimer(MovePhase) {}
+};
+
+inline void countRejection(MoveRejection) {}
+
+#endif
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include "NNUE.h"
+#include "Position.h"
+
+// The widest instruction set the compiler targets is used. The accumulator updates only
+// need SSE2, which every x86-64 CPU has, while the hidden layers need SSSE3 or AVX2:
+#if defined(__AVX2__)
+#define NNUE_AVX2
+#endif
+#if defined(__SSSE3__) || defined(NNUE_AVX2)
+#define NNUE_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(NNUE_SSSE3)
+#define NNUE_SSE2
+#include <immintrin.h>
+#endif
+
+// Network file format (all values little-endian):
+//
+//   char[8]  magic "CLICNNUE"
+//   uint32   version (1)
+//   uint32   nnueInputs, nnueHidden, nnueL2, nnueL3
+//   int16    feature transformer biases  [nnueHidden]
+//   int16    feature transformer weights [nnueInputs][nnueHidden]
+//   int32    hidden layer 1 biases  [nnueL2]
+//   int8     hidden layer 1 weights [nnueL2][2 * nnueHidden]
+//   int32    hidden layer 2 biases  [nnueL3]
+//   int8     hidden layer 2 weights [nnueL3][nnueL2]
+//   int32    output bias
+//   int8     output weights [nnueL3]
+//
+// The hidden layer sums are scaled down by 2^weightShift before the clipped ReLU,
+// and the final output is divided by outputScale to get centipawns.
+
+namespace {
+
+	const char networkMagic[8] = { 'C', 'L', 'I', 'C', 'N', 'N', 'U', 'E' };
+	const uint32_t networkVersion = 1;
+	const int weightShift = 6;
+	const int outputScale = 16;
+	const int maxIncrementalPlies = 8;
+
+	struct Network {
+		alignas(32) int16_t ftBiases[nnueHidden];
+		alignas(32) int16_t ftWeights[nnueInputs * nnueHidden];
+		alignas(32) int32_t l1Biases[nnueL2];
+		alignas(32) int8_t l1Weights[nnueL2 * 2 * nnueHidden];
+		alignas(32) int32_t l2Biases[nnueL3];
+		alignas(32) int8_t l2Weights[nnueL3 * nnueL2];
+		int32_t outBias;
+		alignas(32) int8_t outWeights[nnueL3];
+	};
+
+	// The network is read-only once loaded and shared by all the search threads:
+	std::unique_ptr<Network> network;
+
+	// featureIndex: perspective, piece, square -> int
+	// The 768 inputs are (piece, square) pairs relative to the perspective: the perspective's
+	// own pieces come first, and for Black the board is flipped vertically.
+	inline int featureIndex(Color perspective, int piece, int sq) {
+		int relColor = pieceColor(piece) == perspective ? 0 : 1;
+		int orientedSq = perspective == White ? sq : sq ^ 56;
+		return (relColor * 6 + pieceType(piece)) * 64 + orientedSq;
+	}
+
+	// Vector kernels:
+	// ---------------
+
+	// addColumn / subColumn: accumulator half, feature -> void
+	// Add or remove the weight column of a feature to or from one half of an accumulator.
+	inline void addColumn(int16_t* acc, int feature) {
+		const int16_t* column = network->ftWeights + feature * nnueHidden;
+#if defined(NNUE_AVX2)
+		for (int i = 0; i < nnueHidden; i += 16) {
+			__m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+			__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, w));
+		}
+#elif defined(NNUE_SSE2)
+		for (int i = 0; i < nnueHidden; i += 8) {
+			__m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+			__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(column + i));
+			_mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(a, w));
+		}
+#else
+		for (int i = 0; i < nnueHidden; i++)
+			acc[i] += column[i];
+#endif
+	}
+
+	inline void subColumn(int16_t* acc, int feature) {
+		const int16_t* column = network->ftWeights + feature * nnueHidden;
+#if defined(NNUE_AVX2)
+		for (int i = 0; i < nnueHidden; i += 16) {
+			__m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+			__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, w));
+		}
+#elif defined(NNUE_SSE2)
+		for (int i = 0; i < nnueHidden; i += 8) {
+			__m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+			__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(column + i));
+			_mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi16(a, w));
+		}
+#else
+		for (int i = 0; i < nnueHidden; i++)
+			acc[i] -= column[i];
+#endif
+	}
+
+	// clippedReLU16: int16 input, uint8 output, size -> void
+	// Clamps the accumulator values into [0, 127] and packs them into bytes.
+	inline void clippedReLU16(const int16_t* in, uint8_t* out, int size) {
+#if defined(NNUE_AVX2)
+		const __m256i zero = _mm256_setzero_si256();
+		for (int i = 0; i < size; i += 32) {
+			__m256i a = _mm256_max_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(in + i)), zero);
+			__m256i b = _mm256_max_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(in + i + 16)), zero);
+			// packs works within 128-bit lanes, the permute restores the element order:
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(out + i), packed);
+		}
+#elif defined(NNUE_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		for (int i = 0; i < size; i += 16) {
+			__m128i a = _mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(in + i)), zero);
+			__m128i b = _mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(in + i + 8)), zero);
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi16(a, b));
+		}
+#else
+		for (int i = 0; i < size; i++)
+			out[i] = uint8_t(in[i] < 0 ? 0 : (in[i] > 127 ? 127 : in[i]));
+#endif
+	}
+
+	// clippedReLU32: int32 input, uint8 output, size -> void
+	// Scales the hidden layer sums down and clamps them into [0, 127].
+	inline void clippedReLU32(const int32_t* in, uint8_t* out, int size) {
+		for (int i = 0; i < size; i++) {
+			int v = in[i] >> weightShift;
+			out[i] = uint8_t(v < 0 ? 0 : (v > 127 ? 127 : v));
+		}
+	}
+
+	// affine: uint8 input, input size, int8 weights, int32 biases, int32 output, output size -> void
+	// Computes output = weights * input + biases, with the weights stored row by row.
+	// The vectorized paths multiply unsigned activations with signed weights pairwise
+	// (maddubs), which cannot overflow since the activations are at most 127.
+	inline void affine(const uint8_t* in, int inSize, const int8_t* weights, const int32_t* biases, int32_t* out, int outSize) {
+#if defined(NNUE_AVX2)
+		if (inSize % 32 == 0) {
+			const __m256i ones = _mm256_set1_epi16(1);
+			for (int o = 0; o < outSize; o++) {
+				const int8_t* row = weights + o * inSize;
+				__m256i sum = _mm256_setzero_si256();
+				for (int i = 0; i < inSize; i += 32) {
+					__m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(in + i));
+					__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i));
+					sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+				}
+				__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+				out[o] = biases[o] + _mm_cvtsi128_si32(s);
+			}
+			return;
+		}
+#endif
+#if defined(NNUE_SSSE3)
+		if (inSize % 16 == 0) {
+			const __m128i ones = _mm_set1_epi16(1);
+			for (int o = 0; o < outSize; o++) {
+				const int8_t* row = weights + o * inSize;
+				__m128i sum = _mm_setzero_si128();
+				for (int i = 0; i < inSize; i += 16) {
+					__m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(in + i));
+					__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(row + i));
+					sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+				}
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+				out[o] = biases[o] + _mm_cvtsi128_si32(sum);
+			}
+			return;
+		}
+#endif
+		for (int o = 0; o < outSize; o++) {
+			const int8_t* row = weights + o * inSize;
+			int32_t sum = biases[o];
+			for (int i = 0; i < inSize; i++)
+				sum += int32_t(in[i]) * row[i];
+			out[o] = sum;
+		}
+	}
+
+	// updateAccumulator: Position& -> void
+	// Brings the accumulator of the current position up to date. If one of the last few
+	// positions has a computed accumulator, the piece changes since then are applied to
+	// a copy of it. Otherwise the accumulator is refreshed from scratch.
+	void updateAccumulator(Position& pos) {
+		if (pos.accumulator(0).computed)
+			return;
+
+		int back = 1;
+		int limit = (std::min)(maxIncrementalPlies, pos.stateCount() - 1);
+		while (back <= limit && !pos.accumulator(back).computed)
+			back++;
+
+		if (back > limit) {
+			refreshAccumulator(pos, pos.accumulator(0));
+			return;
+		}
+
+		for (; back > 0; back--) {
+			const Accumulator& prev = pos.accumulator(back);
+			const DirtyPieces& dirty = pos.state(back - 1).dirty;
+			Accumulator& acc = pos.accumulator(back - 1);
+
+			std::memcpy(acc.values, prev.values, sizeof(acc.values));
+			for (int i = 0; i < dirty.count; i++) {
+				int piece = dirty.piece[i];
+				for (Color perspective : { White, Black }) {
+					if (dirty.from[i] != noSquare)
+						subColumn(acc.values[perspective], featureIndex(perspective, piece, dirty.from[i]));
+					if (dirty.to[i] != noSquare)
+						addColumn(acc.values[perspective], featureIndex(perspective, piece, dirty.to[i]));
+				}
+			}
+			acc.computed = true;
+		}
+	}
+
+	template <typename T>
+	bool readArray(std::ifstream& in, T* data, size_t count) {
+		return bool(in.read(reinterpret_cast<char*>(data), sizeof(T) * count));
+	}
+}
+
+bool loadNetwork(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	char magic[8];
+	uint32_t header[5];
+	if (!readArray(in, magic, 8) || std::memcmp(magic, networkMagic, 8) != 0 || !readArray(in, header, 5))
+		return false;
+	if (header[0] != networkVersion || header[1] != nnueInputs || header[2] != nnueHidden ||
+		header[3] != nnueL2 || header[4] != nnueL3)
+		return false;
+
+	std::unique_ptr<Network> net(new Network());
+	bool ok = readArray(in, net->ftBiases, nnueHidden)
+		   && readArray(in, net->ftWeights, size_t(nnueInputs) * nnueHidden)
+		   && readArray(in, net->l1Biases, nnueL2)
+		   && readArray(in, net->l1Weights, size_t(nnueL2) * 2 * nnueHidden)
+		   && readArray(in, net->l2Biases, nnueL3)
+		   && readArray(in, net->l2Weights, size_t(nnueL3) * nnueL2)
+		   && readArray(in, &net->outBias, 1)
+		   && readArray(in, net->outWeights, nnueL3);
+
+	if (!ok)
+		return false;
+
+	network = std::move(net);
+	return true;
+}
+
+void unloadNetwork() {
+	network.reset();
+}
+
+bool networkLoaded() {
+	return network != nullptr;
+}
+
+void refreshAccumulator(const Position& pos, Accumulator& acc) {
+	for (Color perspective : { White, Black }) {
+		std::memcpy(acc.values[perspective], network->ftBiases, sizeof(network->ftBiases));
+		for (Bitboard b = pos.pieces(); b; ) {
+			int sq = popLsb(b);
+			addColumn(acc.values[perspective], featureIndex(perspective, pos.pieceOn(sq), sq));
+		}
+	}
+	acc.computed = true;
+}
+
+int evaluateNNUE(Position& pos) {
+	alignas(32) uint8_t input[2 * nnueHidden];
+	alignas(32) int32_t l1Out[nnueL2];
+	alignas(32) uint8_t l1Act[nnueL2];
+	alignas(32) int32_t l2Out[nnueL3];
+	alignas(32) uint8_t l2Act[nnueL3];
+	int32_t output;
+
+	updateAccumulator(pos);
+	const Accumulator& acc = pos.accumulator(0);
+
+	// The side to move's half always comes first:
+	Color us = pos.sideToMove();
+	clippedReLU16(acc.values[us], input, nnueHidden);
+	clippedReLU16(acc.values[~us], input + nnueHidden, nnueHidden);
+
+	affine(input, 2 * nnueHidden, network->l1Weights, network->l1Biases, l1Out, nnueL2);
+	clippedReLU32(l1Out, l1Act, nnueL2);
+	affine(l1Act, nnueL2, network->l2Weights, network->l2Biases, l2Out, nnueL3);
+	clippedReLU32(l2Out, l2Act, nnueL3);
+	affine(l2Act, nnueL3, network->outWeights, &network->outBias, &output, 1);
+
+	return output / outputScale;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "EngineDefinitions.h"
+
+class Position;
+
+// NNUE:
+// An efficiently updatable neural network evaluation.
+//
+// The network has the following shape:
+//
+//   768 inputs -> 2 x 256 (feature transformer, one half per side) -> 16 -> 32 -> 1
+//
+// The inputs are the (piece, square) pairs of the board as seen from each side's
+// perspective. The feature transformer output of a position is kept in an Accumulator.
+// The Position keeps a stack of them parallel to its StateInfo stack, started only once
+// the network evaluates it, so that positions used without a network carry none. A move
+// only changes two or three features, so instead of recomputing the whole first layer
+// after every move, the accumulator of the previous ply is copied and the weight columns
+// of the changed features are added or removed (see DirtyPieces below). Unmaking a move
+// simply pops the accumulator, so the parent's accumulator is immediately available again.
+//
+// The rest of the network is quantized: the accumulator is int16, the hidden layers
+// use int8 weights with int32 biases and unsigned 8-bit clipped ReLU activations.
+// The kernels are vectorized with AVX2 or SSSE3 when the compiler targets them, with
+// a scalar fallback for every other CPU.
+//
+// The weights are loaded from a local file with loadNetwork, through the EvalFile UCI
+// option or the "nnue file" command. If no network has been loaded, the engine uses the
+// classical evaluation instead.
+const int nnueInputs = 768;
+const int nnueHidden = 256;
+const int nnueL2 = 16;
+const int nnueL3 = 32;
+
+struct alignas(32) Accumulator {
+	int16_t values[2][nnueHidden];	// values[c] is the first layer output from side c's perspective
+	bool computed;
+};
+
+// DirtyPieces records the piece changes made by a move.
+// For each change, from == noSquare means that the piece was added to the board
+// and to == noSquare that it was removed from it. A move changes at most three
+// pieces (a capturing promotion removes two and adds one).
+struct DirtyPieces {
+	int count;
+	int piece[3];
+	int from[3];
+	int to[3];
+};
+
+// loadNetwork: filename -> bool
+// Loads the network weights from the given file. Returns false, and keeps any
+// previously loaded network, if the file cannot be read or has the wrong format.
+//
+// NOTE:
+// Accumulators computed with the previous network are not invalidated, therefore
+// the network should be loaded before the positions to evaluate are set up.
+bool loadNetwork(const std::string& filename);
+
+// unloadNetwork: void -> void
+// Drops the loaded network, so that the engine uses the classical evaluation again.
+void unloadNetwork();
+
+// networkLoaded: void -> bool
+// Returns true if a network has been loaded successfully.
+bool networkLoaded();
+
+// evaluateNNUE: Position& -> int
+// Returns the network's evaluation of the position in centipawns from the side to
+// move's point of view. Updates the position's accumulator as a side effect.
+int evaluateNNUE(Position& pos);
+
+// refreshAccumulator: const Position&, Accumulator& -> void
+// Computes the accumulator of the position from scratch.
+void refreshAccumulator(const Position& pos, Accumulator& acc);
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstdlib>
+#include "Notation.h"
+#include "MoveGen.h"
+#include "Position.h"
+
+namespace {
+	const char pieceLetters[] = "PNBRQK";
+
+	std::string squareName(int sq) {
+		return std::string(1, char('a' + fileOf(sq))) + char('1' + rankOf(sq));
+	}
+}
+
+std::string moveToSAN(const Position& pos, Move m) {
+	int from = moveFrom(m);
+	int to = moveTo(m);
+	PieceType pt = pieceType(pos.movedPiece(m));
+	std::string san;
+
+	// 1. The move itself:
+	if (moveKind(m) == CastlingMove)
+		san = fileOf(to) > fileOf(from) ? "O-O" : "O-O-O";
+	else if (pt == PawnType) {
+		if (pos.isCapture(m))
+			san = std::string(1, char('a' + fileOf(from))) + "x";
+		san += squareName(to);
+		if (moveKind(m) == PromotionMove)
+			san += std::string("=") + pieceLetters[promotionType(m)];
+	}
+	else {
+		san = pieceLetters[pt];
+
+		// If another piece of the same type can move to the same square, the source
+		// file is given, or the source rank if the files are the same, or both:
+		bool ambiguous = false, sameFile = false, sameRank = false;
+		for (const ScoredMove& sm : MoveList(pos)) {
+			int other = moveFrom(sm.move);
+			if (other != from && moveTo(sm.move) == to && pos.pieceOn(other) == pos.pieceOn(from)) {
+				ambiguous = true;
+				sameFile |= fileOf(other) == fileOf(from);
+				sameRank |= rankOf(other) == rankOf(from);
+			}
+		}
+		if (ambiguous) {
+			if (!sameFile)
+				san += char('a' + fileOf(from));
+			else if (!sameRank)
+				san += char('1' + rankOf(from));
+			else
+				san += squareName(from);
+		}
+
+		if (pos.isCapture(m))
+			san += "x";
+		san += squareName(to);
+	}
+
+	// 2. Check and checkmate:
+	Position after = pos;
+	after.makeMove(m);
+	if (after.inCheck())
+		san += MoveList(after).size() == 0 ? "#" : "+";
+
+	return san;
+}
+
+Move moveFromSAN(const Position& pos, const std::string& san) {
+	std::string str = san;
+
+	// 1. Strip the marks that do not identify the move:
+	size_t found = str.find("e.p.");
+	if (found != std::string::npos)
+		str.erase(found);
+	while (!str.empty() && (str.back() == '+' || str.back() == '#' || str.back() == '!' || str.back() == '?'))
+		str.pop_back();
+
+	PieceType promotion = QueenType;
+	found = str.find('=');
+	if (found != std::string::npos) {
+		size_t piece = found + 1 < str.size() ? std::string(pieceLetters).find(str[found + 1]) : std::string::npos;
+		if (piece == std::string::npos || piece == PawnType || piece == KingType)
+			return noMove;
+		promotion = PieceType(piece);
+		str.erase(found);
+	}
+
+	MoveList legal(pos);
+
+	// 2. Castling:
+	if (str == "O-O" || str == "0-0" || str == "O-O-O" || str == "0-0-0") {
+		bool kingside = str.size() == 3;
+		for (const ScoredMove& sm : legal)
+			if (moveKind(sm.move) == CastlingMove && (fileOf(moveTo(sm.move)) > fileOf(moveFrom(sm.move))) == kingside)
+				return sm.move;
+		return noMove;
+	}
+
+	// 3. The moved piece, the source file or rank if given, and the destination:
+	if (str.size() < 2)
+		return noMove;
+
+	PieceType pt = PawnType;
+	size_t first = 0;
+	size_t piece = std::string(pieceLetters).find(str[0]);
+	if (piece != std::string::npos && piece != PawnType) {
+		pt = PieceType(piece);
+		first = 1;
+	}
+
+	size_t last = str.size() - 2;
+	if (str[last] < 'a' || str[last] > 'h' || str[last + 1] < '1' || str[last + 1] > '8')
+		return noMove;
+	int to = makeSquare(str[last] - 'a', str[last + 1] - '1');
+
+	int fromFile = -1, fromRank = -1;
+	for (size_t i = first; i < last; i++) {
+		if (str[i] >= 'a' && str[i] <= 'h')
+			fromFile = str[i] - 'a';
+		else if (str[i] >= '1' && str[i] <= '8')
+			fromRank = str[i] - '1';
+		else if (str[i] != 'x' && str[i] != '-')
+			return noMove;
+	}
+
+	// 4. The move must be the only legal one that fits:
+	Move match = noMove;
+	for (const ScoredMove& sm : legal) {
+		Move m = sm.move;
+		int from = moveFrom(m);
+		if (moveTo(m) != to || moveKind(m) == CastlingMove || pieceType(pos.movedPiece(m)) != pt)
+			continue;
+		if ((fromFile >= 0 && fileOf(from) != fromFile) || (fromRank >= 0 && rankOf(from) != fromRank))
+			continue;
+		if (moveKind(m) == PromotionMove && promotionType(m) != promotion)
+			continue;
+		if (match != noMove)
+			return noMove;
+		match = m;
+	}
+
+	return match;
+}
+
+std::string lineToSAN(const Position& pos, const std::vector<Move>& line) {
+	Position p = pos;
+	std::string str;
+
+	for (Move m : line) {
+		if (!str.empty())
+			str += " ";
+		str += moveToSAN(p, m);
+		p.makeMove(m);
+	}
+
+	return str;
+}
+
+std::string formatScore(int score) {
+	if (score >= mateBound)
+		return "#" + std::to_string((mateScore - score + 1) / 2);
+	if (score <= -mateBound)
+		return "#-" + std::to_string((mateScore + score) / 2);
+
+	char buf[16];
+	std::snprintf(buf, sizeof(buf), "%+.2f", score / 100.0);
+	return buf;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "EngineDefinitions.h"
+
+class Position;
+
+// The engine's moves and scores in the forms shown to the players.
+
+// moveToSAN: const Position&, Move -> std::string
+// Returns the legal move in standard algebraic notation, the same notation the
+// players type in: "Nbd7", "exd5", "e8=Q", "O-O", with "+" or "#" appended for
+// checks and checkmates.
+std::string moveToSAN(const Position& pos, Move m);
+
+// moveFromSAN: const Position&, const std::string& -> Move
+// Returns the legal move of the position given in algebraic notation, or noMove if
+// there is no such move or the notation fits more than one. Accepts the notation of
+// the saved games: the check, checkmate and "e.p." marks are optional, a superfluous
+// source file or rank is allowed, and a promotion without a piece promotes to a queen.
+Move moveFromSAN(const Position& pos, const std::string& san);
+
+// lineToSAN: const Position&, const std::vector<Move>& -> std::string
+// Returns a line of moves played from the position, separated by spaces.
+std::string lineToSAN(const Position& pos, const std::vector<Move>& line);
+
+// formatScore: score -> std::string
+// Returns the score in pawns from the side to move's point of view ("+0.35"),
+// or the distance to mate in moves ("#3" to give mate, "#-3" to be mated).
+std::string formatScore(int score);
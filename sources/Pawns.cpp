@@ -0,0 +1,141 @@
+#include <algorithm>
+#include "Pawns.h"
+#include "Bitboards.h"
+#include "Position.h"
+
+namespace {
+	// forwardRanks: Color, square -> Bitboard
+	// The ranks in front of the square, seen from the given side.
+	inline Bitboard forwardRanks(Color c, int sq) {
+		int r = rankOf(sq);
+		if (c == White)
+			return r == 7 ? 0 : ~0ULL << (8 * (r + 1));
+		return (1ULL << (8 * r)) - 1;
+	}
+
+	inline Bitboard adjacentFiles(int file) {
+		return (file > 0 ? fileBB(file - 1) : 0) | (file < 7 ? fileBB(file + 1) : 0);
+	}
+
+	// evaluateSide: const Position&, Color, mg&, eg&, passed&, EvalTrace* -> void
+	// Adds the pawn structure terms of the side, from its own point of view, to mg and eg,
+	// and marks its passed pawns.
+	void evaluateSide(const Position& pos, Color c, int& mg, int& eg, Bitboard& passed, EvalTrace* trace) {
+		const EvalWeights& w = evalWeights;
+		Bitboard ours = pos.pieces(c, PawnType);
+		Bitboard theirs = pos.pieces(~c, PawnType);
+
+		for (Bitboard b = ours; b; ) {
+			int sq = popLsb(b);
+			int file = fileOf(sq);
+			Bitboard ahead = forwardRanks(c, sq);
+			Bitboard neighbours = ours & adjacentFiles(file);
+
+			// A pawn with a friendly pawn in front of it is doubled, and only the front
+			// one of them can be passed:
+			bool doubled = (ours & ahead & fileBB(file)) != 0;
+			if (doubled)
+				addTerm(mg, eg, w.doubled, 1, c, trace);
+
+			if (!neighbours)
+				addTerm(mg, eg, w.isolated, 1, c, trace);
+			// Backward: no neighbour level with it or behind to support its advance, and its
+			// stop square is guarded by an enemy pawn.
+			else if (!(neighbours & ~ahead) && (pawnAttacksBB[c][sq + (c == White ? 8 : -8)] & theirs))
+				addTerm(mg, eg, w.backward, 1, c, trace);
+
+			if (!doubled && !(theirs & ahead & (fileBB(file) | adjacentFiles(file)))) {
+				addTerm(mg, eg, w.passed[relativeRank(c, rankOf(sq))], 1, c, trace);
+				passed |= squareBB(sq);
+			}
+		}
+	}
+}
+
+PawnTable::PawnTable() : buckets(bucketCount) {
+	clear();
+}
+
+// probe: const Position& -> PawnEntry&
+// Returns the entry of the position's pawn structure, working it out first if the
+// table does not hold it.
+PawnEntry& PawnTable::probe(const Position& pos) {
+	if (version != evalWeightsVersion)
+		clear();
+
+	Key key = pos.pawnKey();
+	PawnEntry* entries = buckets[key & (bucketCount - 1)].entries;
+	probes++;
+
+	for (int i = 0; i < bucketSize; i++)
+		if (entries[i].key == key && entries[i].shelterSquare[White] != 0xFF) {
+			hits++;
+			std::rotate(entries, entries + i, entries + i + 1);
+			return entries[0];
+		}
+
+	// The least recently used entry, the last one, makes room for the new structure:
+	std::rotate(entries, entries + bucketSize - 1, entries + bucketSize);
+	PawnEntry& e = entries[0];
+	e.key = key;
+	evaluatePawns(pos, e, nullptr);
+	e.shelterSquare[White] = e.shelterSquare[Black] = noSquare;
+	return e;
+}
+
+// shelter: const Position&, PawnEntry&, Color -> EvalTerm
+// Returns the pawn shield score of the side's king, from the entry if it was worked out
+// for the king's square.
+EvalTerm PawnTable::shelter(const Position& pos, PawnEntry& e, Color c) {
+	int ksq = pos.kingSquare(c);
+	if (e.shelterSquare[c] != ksq) {
+		EvalTerm s = kingShelter(pos, c, nullptr);
+		e.shelterMg[c] = int16_t(s.mg);
+		e.shelterEg[c] = int16_t(s.eg);
+		e.shelterSquare[c] = uint8_t(ksq);
+	}
+	return EvalTerm{ e.shelterMg[c], e.shelterEg[c] };
+}
+
+void PawnTable::clear() {
+	for (Bucket& b : buckets)
+		for (PawnEntry& e : b.entries) {
+			e.key = 0;
+			e.shelterSquare[White] = 0xFF;	// Marks the entry empty, even for the key 0 of no pawns.
+		}
+	probes = hits = 0;
+	version = evalWeightsVersion;
+}
+
+void evaluatePawns(const Position& pos, PawnEntry& e, EvalTrace* trace) {
+	int mg[2] = { 0, 0 };
+	int eg[2] = { 0, 0 };
+	e.passed = 0;
+	for (int c = White; c <= Black; c++)
+		evaluateSide(pos, Color(c), mg[c], eg[c], e.passed, trace);
+
+	e.mg = int16_t(mg[White] - mg[Black]);
+	e.eg = int16_t(eg[White] - eg[Black]);
+}
+
+EvalTerm kingShelter(const Position& pos, Color c, EvalTrace* trace) {
+	const EvalWeights& w = evalWeights;
+	Bitboard ours = pos.pieces(c, PawnType);
+	int ksq = pos.kingSquare(c);
+	int kingFile = fileOf(ksq) < 1 ? 1 : (fileOf(ksq) > 6 ? 6 : fileOf(ksq));
+	int kingRank = rankOf(ksq);
+	int forward = c == White ? 1 : -1;
+	EvalTerm score = { 0, 0 };
+
+	for (int f = kingFile - 1; f <= kingFile + 1; f++) {
+		int near = kingRank + forward, far = kingRank + 2 * forward;
+		if (near >= 0 && near <= 7 && (ours & squareBB(makeSquare(f, near))))
+			addTerm(score.mg, score.eg, w.shieldNear, 1, c, trace);
+		else if (far >= 0 && far <= 7 && (ours & squareBB(makeSquare(f, far))))
+			addTerm(score.mg, score.eg, w.shieldFar, 1, c, trace);
+		else
+			addTerm(score.mg, score.eg, w.shieldMissing, 1, c, trace);
+	}
+
+	return score;
+}
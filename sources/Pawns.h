@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "Evaluation.h"
+
+class Position;
+
+// PawnEntry holds the evaluation of one pawn structure. The scores are in centipawns
+// from White's point of view.
+struct PawnEntry {
+	Key key;
+	Bitboard passed;			// The passed pawns of both sides.
+	int16_t mg, eg;				// Doubled, isolated, backward and passed pawns.
+	int16_t shelterMg[2];		// The pawn shield of each side's king, on the king square below.
+	int16_t shelterEg[2];
+	uint8_t shelterSquare[2];	// noSquare if the shield has not been worked out yet.
+};
+
+// PawnTable:
+// A hash table of pawn structure evaluations, keyed by the pawn key of the position.
+//
+// The pawn terms cost much more than the rest of the classical evaluation but change
+// only when a pawn moves, is captured or promotes, so that nearly every evaluation in a
+// search finds its pawn structure in the table. The pawn shield depends on the king too;
+// it is kept for the king square it was worked out for, and worked out again when the
+// king has moved.
+//
+// The table consists of 64-byte buckets of two entries, so that a probe touches a single
+// cache line. The entries of a bucket are kept with the most recently used first, and a
+// new structure replaces the least recently used one.
+//
+// Every search thread owns a table (see Search and MonteCarloSearch), so the entries are
+// read and written without locking. The tables live as long as the engine, so that the
+// structures of one move's search are mostly found again in the next.
+class PawnTable
+{
+private:
+	static const int bucketSize = 2;
+	static const size_t bucketCount = 32768;	// A power of two.
+
+	struct alignas(64) Bucket {
+		PawnEntry entries[bucketSize];
+	};
+
+	std::vector<Bucket> buckets;
+	uint64_t probes;
+	uint64_t hits;
+	int version;								// The evalWeightsVersion the entries were worked out with.
+
+public:
+	PawnTable();
+	PawnEntry& probe(const Position& pos);
+	EvalTerm shelter(const Position& pos, PawnEntry& entry, Color c);
+	void clear();
+
+	uint64_t probeCount() const { return probes; }
+	uint64_t hitCount() const { return hits; }
+	double hitRate() const { return probes ? double(hits) / probes : 0.0; }
+};
+
+// evaluatePawns: const Position&, PawnEntry&, EvalTrace* -> void
+// Works out the pawn structure terms and the passed pawns of the entry, leaving the key and
+// the shelters alone. Records the terms in the trace if there is one.
+void evaluatePawns(const Position& pos, PawnEntry& entry, EvalTrace* trace);
+
+// kingShelter: const Position&, Color, EvalTrace* -> EvalTerm
+// Returns the pawn shield score of the side's king, from its own point of view: the pawns
+// on the king's file and the files next to it, one or two ranks in front of it.
+EvalTerm kingShelter(const Position& pos, Color c, EvalTrace* trace);
@@ -73,23 +73,39 @@ bool Piece::canMoveTo(MoveAnalysisResults& results, const Board& board) const {
 	else return false;
 }
 
-// reachableSquares: std::vector<SquareCoords>&, int, Board -> void
-// Finds all the reachable squares for the piece and pushes them into the given sqList.
+// visitReachableSquares: SquareVisitor, int, Board -> bool
+// Calls the visitor for each square the piece can reach, one square at a time,
+// and stops as soon as the visitor returns true. Returns true if the visitor
+// stopped the iteration.
+//
+// Unlike with reachableSquares, no list of squares is built, so a caller that is
+// looking for a single usable square (like GameManager::canMove) does not pay for
+// finding all the rest.
 // NOTE:
 // This is not the most efficient solution by any means, but it perfectly reuses code
 // already implemented. In a two player chess it should not cause any bottlenecks, but
 // for a full-fledged computer chess engine, this would obviously be an inefficient solution.
+// The engine has its own move generator for that purpose (see MoveGen.h).
 //
 // Note: Pawn moves in a highly specialized and asymmetric fasion,
-// therefore it has its own implementation of reachableSquares.
-void Piece::reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const {
+// therefore it has its own implementation of visitReachableSquares.
+bool Piece::visitReachableSquares(const SquareVisitor& visit, int oppDir, const Board& board) const {
 	for (int file=0; file<fileLim; file++)
 		for (int rank=0; rank<rankLim; rank++) {
 			SquareCoords next(file, rank);
 			if (threatensSquare(next, oppDir, board) &&
-				(!board.hasPiece(next) || board.squareOwner(next) != player) )
-				sqList.push_back(next);
+				(!board.hasPiece(next) || board.squareOwner(next) != player) &&
+				visit(next))
+				return true;
 		}
+
+	return false;
+}
+
+// reachableSquares: std::vector<SquareCoords>&, int, Board -> void
+// Finds all the reachable squares for the piece and pushes them into the given sqList.
+void Piece::reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const {
+	visitReachableSquares([&sqList](const SquareCoords& sq) { sqList.push_back(sq); return false; }, oppDir, board);
 }
 
 bool Pawn::canCapture(MoveAnalysisResults& results, int opponentDir, const Board& board) const {
@@ -162,16 +178,17 @@ bool Pawn::canMoveTo(MoveAnalysisResults& results, const Board& board) const {
 	}
 }
 
-void Pawn::reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const {
+bool Pawn::visitReachableSquares(const SquareVisitor& visit, int oppDir, const Board& board) const {
 	SquareCoords next(coords.file(), coords.rank() + oppDir);
 
 	// check non-capture squares:
 	if (legalSquare_p(next) && !board.hasPiece(next)) {
-		sqList.push_back(next);
+		if (visit(next))
+			return true;
 		if (!hasMoved) {
 			next.setCoords(next.file(), next.rank() + oppDir);
-			if (legalSquare_p(next) && !board.hasPiece(next))
-				sqList.push_back(next);
+			if (legalSquare_p(next) && !board.hasPiece(next) && visit(next))
+				return true;
 		}
 	}
 	
@@ -180,13 +197,15 @@ void Pawn::reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const
 	SquareCoords epSq(coords.file() - 1, coords.rank());
 
 	if (legalSquare_p(next)) {
-		if (board.hasPiece(next) && board.squareOwner(next) != player)
-			sqList.push_back(next);
+		if (board.hasPiece(next) && board.squareOwner(next) != player) {
+			if (visit(next))
+				return true;
+		}
 		else if (!board.hasPiece(next)) {
 			if (board.hasPiece(epSq) && board.squareOwner(epSq) != player) {
 				std::shared_ptr<Piece> opp = board.getPiece(epSq);
-				if (opp->getType() == MoveId::P && !opp->moved_p())
-					sqList.push_back(next);
+				if (opp->getType() == MoveId::P && !opp->moved_p() && visit(next))
+					return true;
 			}
 		}
 	}
@@ -196,16 +215,20 @@ void Pawn::reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const
 	epSq.setCoords(coords.file() + 1, coords.rank());
 
 	if (legalSquare_p(next)) {
-		if (board.hasPiece(next) && board.squareOwner(next) != player)
-			sqList.push_back(next);
+		if (board.hasPiece(next) && board.squareOwner(next) != player) {
+			if (visit(next))
+				return true;
+		}
 		else if (!board.hasPiece(next)) {
 			if (board.hasPiece(epSq) && board.squareOwner(epSq) != player) {
 				std::shared_ptr<Piece> opp = board.getPiece(epSq);
-				if (opp->getType() == MoveId::P && !opp->moved_p())
-					sqList.push_back(next);
+				if (opp->getType() == MoveId::P && !opp->moved_p() && visit(next))
+					return true;
 			}
 		}
 	}
+
+	return false;
 }
 
 bool Pawn::threatensSquare(const SquareCoords& destCoords, int opponentDir, const Board& board) const {
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -7,6 +8,10 @@
 
 class Player;
 
+// SquareVisitor is called by visitReachableSquares for each reachable square.
+// Returning true from the visitor stops the iteration.
+typedef std::function<bool(const SquareCoords&)> SquareVisitor;
+
 // Piece is an abstract class that defines the basic data structure and interface
 // for every individual chess piece in the game.
 //
@@ -35,7 +40,8 @@ public:
 	void setCoords(const SquareCoords& newCoords) { coords = newCoords; }
 	bool moved_p() const { return hasMoved; }
 	virtual bool canMoveTo(MoveAnalysisResults& results, const Board& board) const;
-	virtual void reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const;
+	virtual bool visitReachableSquares(const SquareVisitor& visit, int oppDir, const Board& board) const;
+	void reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const;
 	virtual bool threatensSquare(const SquareCoords& destCoords, int opponentDir, const Board& board) const = 0;
 	virtual bool canBeEnPassanted() const { return false; }
 	virtual void setEnPassant() { }
@@ -58,7 +64,7 @@ public:
 	Pawn(const SquareCoords& _coords, const Player* _player) : Piece(_coords, _player) { enPassantThreat = false; }
 	virtual MoveId getType() const { return MoveId::P; }
 	virtual bool canMoveTo(MoveAnalysisResults& results, const Board& board) const;
-	virtual void reachableSquares(std::vector<SquareCoords>& sqList, int oppDir, const Board& board) const;
+	virtual bool visitReachableSquares(const SquareVisitor& visit, int oppDir, const Board& board) const;
 	virtual bool threatensSquare(const SquareCoords& destCoords, int opponentDir, const Board& board) const;
 	virtual bool canBeEnPassanted() const { return enPassantThreat; }
 	virtual void setEnPassant() { enPassantThreat = true; }
@@ -0,0 +1,641 @@
+#include <algorithm>
+#include <sstream>
+#include "Position.h"
+#include "MoveGen.h"
+#include "CLIChessExceptions.h"
+
+namespace {
+
+	// Zobrist keys:
+	// Every (piece, square) pair, castling right combination, en passant file and the side
+	// to move have a random key. The key of a position is the XOR of the keys of its features,
+	// which allows it to be updated incrementally as pieces move.
+	Key zobristPiece[pieceCodes][64];
+	Key zobristCastling[16];
+	Key zobristEpFile[8];
+	Key zobristSide;
+
+	// castlingMask[sq] contains the castling rights that survive a move from or to sq:
+	int castlingMask[64];
+
+	const std::string pieceChars = "PNBRQKpnbrqk";
+
+	// A fixed seed keeps the keys, and therefore the transposition table contents, reproducible:
+	struct ZobristInitializer {
+		ZobristInitializer() {
+			uint64_t seed = 1070372;
+			auto rand64 = [&seed]() {
+				// xorshift64*
+				seed ^= seed >> 12;
+				seed ^= seed << 25;
+				seed ^= seed >> 27;
+				return seed * 2685821657736338717ULL;
+			};
+
+			for (int p = 0; p < pieceCodes; p++)
+				for (int sq = 0; sq < 64; sq++)
+					zobristPiece[p][sq] = rand64();
+			for (int cr = 0; cr < 16; cr++)
+				zobristCastling[cr] = rand64();
+			for (int file = 0; file < 8; file++)
+				zobristEpFile[file] = rand64();
+			zobristSide = rand64();
+
+			for (int sq = 0; sq < 64; sq++)
+				castlingMask[sq] = AnyCastling;
+			castlingMask[makeSquare(4, 0)] &= ~(WhiteOO | WhiteOOO);
+			castlingMask[makeSquare(7, 0)] &= ~WhiteOO;
+			castlingMask[makeSquare(0, 0)] &= ~WhiteOOO;
+			castlingMask[makeSquare(4, 7)] &= ~(BlackOO | BlackOOO);
+			castlingMask[makeSquare(7, 7)] &= ~BlackOO;
+			castlingMask[makeSquare(0, 7)] &= ~BlackOOO;
+		}
+	};
+
+	ZobristInitializer zobristInitializer;
+
+	// addDirty: DirtyPieces&, piece, from, to -> void
+	// Records a piece change for the incremental NNUE update.
+	inline void addDirty(DirtyPieces& dp, int piece, int from, int to) {
+		dp.piece[dp.count] = piece;
+		dp.from[dp.count] = from;
+		dp.to[dp.count] = to;
+		dp.count++;
+	}
+}
+
+const std::string Position::startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Private methods:
+// -----------------------------
+
+// clear: void -> void
+// Empties the board and the state stack.
+void Position::clear() {
+	for (int sq = 0; sq < 64; sq++)
+		board[sq] = noPiece;
+	for (int pt = 0; pt < 6; pt++)
+		byType[pt] = 0;
+	byColor[White] = byColor[Black] = 0;
+	stm = White;
+	gamePly = 0;
+	states.clear();
+	accumulators.clear();
+}
+
+void Position::putPiece(int piece, int sq) {
+	board[sq] = piece;
+	byType[pieceType(piece)] |= squareBB(sq);
+	byColor[pieceColor(piece)] |= squareBB(sq);
+}
+
+void Position::removePiece(int sq) {
+	int piece = board[sq];
+	byType[pieceType(piece)] ^= squareBB(sq);
+	byColor[pieceColor(piece)] ^= squareBB(sq);
+	board[sq] = noPiece;
+}
+
+void Position::movePiece(int from, int to) {
+	int piece = board[from];
+	Bitboard fromTo = squareBB(from) | squareBB(to);
+	byType[pieceType(piece)] ^= fromTo;
+	byColor[pieceColor(piece)] ^= fromTo;
+	board[from] = noPiece;
+	board[to] = piece;
+}
+
+// pushState: void -> StateInfo&
+// Pushes a new StateInfo on the stack, copying the fields that carry over from the
+// previous one. If the accumulators are kept, an accumulator that is not yet computed
+// is pushed along: it is brought up to date lazily by the evaluation.
+StateInfo& Position::pushState() {
+	states.emplace_back();
+	StateInfo& st = states.back();
+	const StateInfo& prev = states[states.size() - 2];
+
+	st.key = prev.key ^ zobristSide;
+	st.pawnKey = prev.pawnKey;
+	st.materialKey = prev.materialKey;
+	st.castlingRights = prev.castlingRights;
+	st.epSquare = noSquare;
+	st.halfmoveClock = prev.halfmoveClock + 1;
+	st.pliesFromNull = prev.pliesFromNull + 1;
+	st.capturedPiece = noPiece;
+	st.dirty.count = 0;
+
+	if (prev.epSquare != noSquare)
+		st.key ^= zobristEpFile[fileOf(prev.epSquare)];
+
+	if (!accumulators.empty()) {
+		accumulators.emplace_back();
+		accumulators.back().computed = false;
+	}
+
+	return st;
+}
+
+// popState: void -> void
+// Pops the StateInfo of the last move, and its accumulator if the accumulators are kept.
+void Position::popState() {
+	states.pop_back();
+	if (!accumulators.empty())
+		accumulators.pop_back();
+}
+
+// updateCheckInfo: void -> void
+// Finds the checkers and the pinned pieces of the side to move.
+void Position::updateCheckInfo() {
+	StateInfo& st = states.back();
+	st.checkers = attackersTo(kingSquare(stm)) & pieces(~stm);
+	st.pinned = pinnedPieces(stm);
+}
+
+// computeKey: void -> Key
+// Computes the Zobrist key of the position from scratch.
+Key Position::computeKey() const {
+	const StateInfo& st = states.back();
+	Key k = zobristCastling[st.castlingRights];
+
+	for (Bitboard b = pieces(); b; ) {
+		int sq = popLsb(b);
+		k ^= zobristPiece[board[sq]][sq];
+	}
+	if (st.epSquare != noSquare)
+		k ^= zobristEpFile[fileOf(st.epSquare)];
+	if (stm == Black)
+		k ^= zobristSide;
+
+	return k;
+}
+
+// computePawnKey: void -> Key
+// Computes the pawn key, made of the keys of the pawns only, from scratch.
+Key Position::computePawnKey() const {
+	Key k = 0;
+	for (Bitboard b = pieces(PawnType); b; ) {
+		int sq = popLsb(b);
+		k ^= zobristPiece[board[sq]][sq];
+	}
+	return k;
+}
+
+// computeMaterialKey: void -> Key
+// Computes the material key from the piece counts from scratch.
+Key Position::computeMaterialKey() const {
+	Key k = 0;
+	for (int piece = 0; piece < pieceCodes; piece++) {
+		int count = popCount(pieces(pieceColor(piece), pieceType(piece)));
+		for (int i = 0; i < count; i++)
+			k ^= materialKeyOf(piece, i);
+	}
+	return k;
+}
+
+// Public methods:
+// -----------------------------
+Position::Position() {
+	setFromFEN(startFEN);
+}
+
+// A copy gets only the states of the original. A search reserves the room it needs
+// on the copy's state stack with reserve:
+Position::Position(const Position& other) {
+	*this = other;
+}
+
+Position& Position::operator=(const Position& other) {
+	if (this == &other)
+		return *this;
+
+	std::copy(other.board, other.board + 64, board);
+	std::copy(other.byType, other.byType + 6, byType);
+	std::copy(other.byColor, other.byColor + 2, byColor);
+	stm = other.stm;
+	gamePly = other.gamePly;
+	states = other.states;
+	accumulators = other.accumulators;
+	return *this;
+}
+
+// reserve: plies -> void
+// Reserves room for the given number of moves on top of the current state stack, so
+// that a search making and unmaking them never has to reallocate the stack. The room
+// for the accumulators is reserved only when a network is loaded.
+void Position::reserve(int plies) {
+	states.reserve(states.size() + plies);
+	if (networkLoaded())
+		accumulators.reserve(states.size() + plies);
+}
+
+// accumulator: pliesBack -> Accumulator&
+// Returns the accumulator of the position the given number of moves back. The first call
+// starts keeping the accumulators, none of them computed yet. Until then the positions
+// that are never evaluated by the network do not pay for them.
+Accumulator& Position::accumulator(int pliesBack) {
+	if (accumulators.empty()) {
+		accumulators.resize(states.size());
+		for (Accumulator& acc : accumulators)
+			acc.computed = false;
+	}
+	return accumulators[accumulators.size() - 1 - pliesBack];
+}
+
+// setFromFEN: const std::string& -> void
+// Sets up the position described by the given FEN string.
+// Throws a ParseException if the string is not a valid FEN.
+//
+// The halfmove clock and the fullmove number may be omitted.
+void Position::setFromFEN(const std::string& fen) {
+	std::istringstream in(fen);
+	std::string placement, side, castling, ep;
+	int halfmoves = 0, fullmoves = 1;
+
+	in >> placement >> side >> castling >> ep;
+	if (!(in >> halfmoves))
+		halfmoves = 0;
+	if (!(in >> fullmoves))
+		fullmoves = 1;
+
+	if (placement.empty() || (side != "w" && side != "b") || castling.empty() || ep.empty())
+		throw ParseException("[" + fen + "]: Malformed FEN string.");
+
+	clear();
+
+	// 1. Piece placement, from rank 8 down to rank 1:
+	int file = 0, rank = 7;
+	for (char c : placement) {
+		if (c == '/') {
+			if (file != 8)
+				throw ParseException("[" + fen + "]: Bad rank length in the FEN string.");
+			file = 0;
+			rank--;
+		}
+		else if (c >= '1' && c <= '8')
+			file += c - '0';
+		else {
+			size_t piece = pieceChars.find(c);
+			if (piece == std::string::npos || file > 7 || rank < 0)
+				throw ParseException("[" + fen + "]: Bad piece placement in the FEN string.");
+			putPiece(int(piece), makeSquare(file, rank));
+			file++;
+		}
+	}
+	if (rank != 0 || file != 8 || popCount(pieces(White, KingType)) != 1 || popCount(pieces(Black, KingType)) != 1)
+		throw ParseException("[" + fen + "]: Bad piece placement in the FEN string.");
+
+	// 2. Side to move:
+	stm = side == "w" ? White : Black;
+	gamePly = 2 * (std::max)(fullmoves - 1, 0) + (stm == Black ? 1 : 0);
+
+	// 3. Castling rights. Rights without the king and the rook on their original squares are dropped:
+	states.emplace_back();
+	StateInfo& st = states.back();
+	st.castlingRights = 0;
+	for (char c : castling) {
+		switch (c) {
+			case 'K': st.castlingRights |= WhiteOO; break;
+			case 'Q': st.castlingRights |= WhiteOOO; break;
+			case 'k': st.castlingRights |= BlackOO; break;
+			case 'q': st.castlingRights |= BlackOOO; break;
+			case '-': break;
+			default: throw ParseException("[" + fen + "]: Bad castling rights in the FEN string.");
+		}
+	}
+	for (int sq : { makeSquare(4, 0), makeSquare(7, 0), makeSquare(0, 0), makeSquare(4, 7), makeSquare(7, 7), makeSquare(0, 7) }) {
+		int expected = sq == makeSquare(4, 0) || sq == makeSquare(4, 7) ? KingType : RookType;
+		if (board[sq] != makePiece(rankOf(sq) == 0 ? White : Black, PieceType(expected)))
+			st.castlingRights &= castlingMask[sq];
+	}
+
+	// 4. En passant square. It is only kept if a pawn can actually make the capture,
+	//    so that positions differing only by a useless en passant square hash alike:
+	st.epSquare = noSquare;
+	if (ep != "-") {
+		if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || (ep[1] != '3' && ep[1] != '6'))
+			throw ParseException("[" + fen + "]: Bad en passant square in the FEN string.");
+		int epSq = makeSquare(ep[0] - 'a', ep[1] - '1');
+		if (pawnAttacksBB[~stm][epSq] & pieces(stm, PawnType))
+			st.epSquare = epSq;
+	}
+
+	st.halfmoveClock = halfmoves;
+	st.pliesFromNull = 0;
+	st.capturedPiece = noPiece;
+	st.dirty.count = 0;
+	st.key = computeKey();
+	st.pawnKey = computePawnKey();
+	st.materialKey = computeMaterialKey();
+	updateCheckInfo();
+
+	if (attackersTo(kingSquare(~stm)) & pieces(stm))
+		throw ParseException("[" + fen + "]: The side not to move is in check.");
+}
+
+// toFEN: void -> std::string
+// Returns the FEN string of the position.
+std::string Position::toFEN() const {
+	std::ostringstream out;
+
+	for (int rank = 7; rank >= 0; rank--) {
+		int empty = 0;
+		for (int file = 0; file < 8; file++) {
+			int piece = board[makeSquare(file, rank)];
+			if (piece == noPiece)
+				empty++;
+			else {
+				if (empty)
+					out << empty;
+				empty = 0;
+				out << pieceChars[piece];
+			}
+		}
+		if (empty)
+			out << empty;
+		if (rank > 0)
+			out << '/';
+	}
+
+	const StateInfo& st = states.back();
+	out << (stm == White ? " w " : " b ");
+	if (st.castlingRights & WhiteOO)  out << 'K';
+	if (st.castlingRights & WhiteOOO) out << 'Q';
+	if (st.castlingRights & BlackOO)  out << 'k';
+	if (st.castlingRights & BlackOOO) out << 'q';
+	if (!st.castlingRights)
+		out << '-';
+
+	if (st.epSquare == noSquare)
+		out << " -";
+	else
+		out << ' ' << char('a' + fileOf(st.epSquare)) << char('1' + rankOf(st.epSquare));
+
+	out << ' ' << st.halfmoveClock << ' ' << 1 + gamePly / 2;
+	return out.str();
+}
+
+// attackersTo: square, occupancy -> Bitboard
+// Returns all the pieces of both sides attacking the given square,
+// with sliders' rays blocked by the given occupancy.
+Bitboard Position::attackersTo(int sq, Bitboard occupied) const {
+	return (pawnAttacksBB[Black][sq] & pieces(White, PawnType))
+		 | (pawnAttacksBB[White][sq] & pieces(Black, PawnType))
+		 | (knightAttacksBB[sq] & pieces(KnightType))
+		 | (kingAttacksBB[sq] & pieces(KingType))
+		 | (rookAttacks(sq, occupied) & pieces(RookType, QueenType))
+		 | (bishopAttacks(sq, occupied) & pieces(BishopType, QueenType));
+}
+
+// pinnedPieces: Color -> Bitboard
+// Returns the pieces of the given side that are pinned to their own king.
+Bitboard Position::pinnedPieces(Color c) const {
+	int ksq = kingSquare(c);
+	Bitboard pinned = 0;
+	Bitboard snipers = (rookAttacks(ksq, 0) & pieces(~c, RookType, QueenType))
+					 | (bishopAttacks(ksq, 0) & pieces(~c, BishopType, QueenType));
+
+	while (snipers) {
+		Bitboard between = betweenBB[ksq][popLsb(snipers)] & pieces();
+		if (between && !moreThanOne(between))
+			pinned |= between & pieces(c);
+	}
+	return pinned;
+}
+
+// isCapture: Move -> bool
+// Returns true if the move captures a piece (including en passant).
+bool Position::isCapture(Move m) const {
+	return (board[moveTo(m)] != noPiece && moveKind(m) != CastlingMove) || moveKind(m) == EnPassantMove;
+}
+
+// isPseudoLegal: Move -> bool
+// Returns true if the given move could have been generated in the current position.
+// Is used to validate moves coming from outside of the move generator, such as the
+// transposition table and the killer slots, which may belong to another position.
+bool Position::isPseudoLegal(Move m) const {
+	int from = moveFrom(m);
+	int to = moveTo(m);
+	int piece = board[from];
+
+	if (m == noMove || m == nullMove || piece == noPiece || pieceColor(piece) != stm)
+		return false;
+
+	// Special moves are rare enough to be checked against the full move list:
+	if (moveKind(m) != NormalMove) {
+		for (const ScoredMove& sm : MoveList(*this))
+			if (sm.move == m)
+				return true;
+		return false;
+	}
+
+	// Only promotions may carry a promotion piece:
+	if ((m & (3 << 12)) || (pieces(stm) & squareBB(to)))
+		return false;
+
+	if (pieceType(piece) == PawnType) {
+		int up = stm == White ? 8 : -8;
+		if (relativeRank(stm, rankOf(to)) == 7)
+			return false;
+
+		bool capture = (pawnAttacksBB[stm][from] & pieces(~stm) & squareBB(to)) != 0;
+		bool push = to == from + up && board[to] == noPiece;
+		bool doublePush = to == from + 2 * up && relativeRank(stm, rankOf(from)) == 1 &&
+						  board[to] == noPiece && board[from + up] == noPiece;
+		if (!capture && !push && !doublePush)
+			return false;
+	}
+	else if (!(pieceAttacks(pieceType(piece), from, pieces()) & squareBB(to)))
+		return false;
+
+	// When in check, a non-king move must capture the checker or block the check:
+	if (inCheck() && pieceType(piece) != KingType) {
+		if (moreThanOne(checkers()))
+			return false;
+		int checker = lsb(checkers());
+		if (!((betweenBB[kingSquare(stm)][checker] | squareBB(checker)) & squareBB(to)))
+			return false;
+	}
+
+	return true;
+}
+
+// isLegal: Move -> bool
+// Returns true if the pseudo-legal move does not leave the mover's king in check.
+//
+// Assumes that the move is pseudo-legal, and, when in check, that it is one of the
+// evasions produced by the move generator.
+bool Position::isLegal(Move m) const {
+	int from = moveFrom(m);
+	int to = moveTo(m);
+	int ksq = kingSquare(stm);
+
+	if (moveKind(m) == EnPassantMove) {
+		int capSq = to - (stm == White ? 8 : -8);
+		Bitboard occupied = (pieces() ^ squareBB(from) ^ squareBB(capSq)) | squareBB(to);
+		return !(rookAttacks(ksq, occupied) & pieces(~stm, RookType, QueenType)) &&
+			   !(bishopAttacks(ksq, occupied) & pieces(~stm, BishopType, QueenType));
+	}
+
+	// The castling path has already been checked by the move generator:
+	if (moveKind(m) == CastlingMove)
+		return true;
+
+	if (from == ksq)
+		return !(attackersTo(to, pieces() ^ squareBB(from)) & pieces(~stm));
+
+	return !(state().pinned & squareBB(from)) || aligned(from, to, ksq);
+}
+
+// makeMove: Move -> void
+// Makes the given legal move on the board.
+void Position::makeMove(Move m) {
+	StateInfo& st = pushState();
+	Color us = stm;
+	Color them = ~stm;
+	int from = moveFrom(m);
+	int to = moveTo(m);
+	int piece = board[from];
+
+	if (moveKind(m) == CastlingMove) {
+		bool kingSide = to > from;
+		int rookFrom = kingSide ? to + 1 : to - 2;
+		int rookTo = kingSide ? to - 1 : to + 1;
+		int rook = board[rookFrom];
+
+		movePiece(from, to);
+		movePiece(rookFrom, rookTo);
+		st.key ^= zobristPiece[piece][from] ^ zobristPiece[piece][to]
+				^ zobristPiece[rook][rookFrom] ^ zobristPiece[rook][rookTo];
+		addDirty(st.dirty, piece, from, to);
+		addDirty(st.dirty, rook, rookFrom, rookTo);
+	}
+	else {
+		int capSq = moveKind(m) == EnPassantMove ? to - (us == White ? 8 : -8) : to;
+		int captured = board[capSq];
+
+		if (captured != noPiece) {
+			removePiece(capSq);
+			st.key ^= zobristPiece[captured][capSq];
+			if (pieceType(captured) == PawnType)
+				st.pawnKey ^= zobristPiece[captured][capSq];
+			st.materialKey ^= materialKeyOf(captured, popCount(pieces(pieceColor(captured), pieceType(captured))));
+			st.capturedPiece = captured;
+			st.halfmoveClock = 0;
+			addDirty(st.dirty, captured, capSq, noSquare);
+		}
+
+		movePiece(from, to);
+		st.key ^= zobristPiece[piece][from] ^ zobristPiece[piece][to];
+
+		if (pieceType(piece) == PawnType) {
+			st.halfmoveClock = 0;
+			st.pawnKey ^= zobristPiece[piece][from] ^ zobristPiece[piece][to];
+
+			if (moveKind(m) == PromotionMove) {
+				int promoted = makePiece(us, promotionType(m));
+				removePiece(to);
+				putPiece(promoted, to);
+				st.key ^= zobristPiece[piece][to] ^ zobristPiece[promoted][to];
+				st.pawnKey ^= zobristPiece[piece][to];
+				st.materialKey ^= materialKeyOf(piece, popCount(pieces(us, PawnType)))
+								^ materialKeyOf(promoted, popCount(pieces(us, promotionType(m))) - 1);
+				addDirty(st.dirty, piece, from, noSquare);
+				addDirty(st.dirty, promoted, noSquare, to);
+			}
+			else {
+				addDirty(st.dirty, piece, from, to);
+
+				// A double push only sets the en passant square if the capture is possible:
+				if ((to ^ from) == 16 && (pawnAttacksBB[us][(from + to) / 2] & pieces(them, PawnType))) {
+					st.epSquare = (from + to) / 2;
+					st.key ^= zobristEpFile[fileOf(st.epSquare)];
+				}
+			}
+		}
+		else
+			addDirty(st.dirty, piece, from, to);
+	}
+
+	int rights = st.castlingRights & castlingMask[from] & castlingMask[to];
+	if (rights != st.castlingRights) {
+		st.key ^= zobristCastling[st.castlingRights] ^ zobristCastling[rights];
+		st.castlingRights = rights;
+	}
+
+	stm = them;
+	gamePly++;
+	updateCheckInfo();
+}
+
+// unmakeMove: Move -> void
+// Unmakes the given move, which must have been the last move made.
+void Position::unmakeMove(Move m) {
+	stm = ~stm;
+	gamePly--;
+	Color us = stm;
+	int from = moveFrom(m);
+	int to = moveTo(m);
+
+	if (moveKind(m) == CastlingMove) {
+		bool kingSide = to > from;
+		movePiece(to, from);
+		movePiece(kingSide ? to - 1 : to + 1, kingSide ? to + 1 : to - 2);
+	}
+	else {
+		if (moveKind(m) == PromotionMove) {
+			removePiece(to);
+			putPiece(makePiece(us, PawnType), to);
+		}
+		movePiece(to, from);
+
+		int captured = states.back().capturedPiece;
+		if (captured != noPiece)
+			putPiece(captured, moveKind(m) == EnPassantMove ? to - (us == White ? 8 : -8) : to);
+	}
+
+	popState();
+}
+
+// makeNullMove: void -> void
+// Passes the turn to the opponent. Must not be called when in check.
+void Position::makeNullMove() {
+	StateInfo& st = pushState();
+	st.pliesFromNull = 0;
+	stm = ~stm;
+	gamePly++;
+	updateCheckInfo();
+}
+
+void Position::unmakeNullMove() {
+	stm = ~stm;
+	gamePly--;
+	popState();
+}
+
+// isRepetition: void -> bool
+// Returns true if the current position has already occurred since the last
+// irreversible move. Within the search a single repetition is scored as a draw.
+bool Position::isRepetition() const {
+	const StateInfo& st = states.back();
+	int end = (std::min)(st.halfmoveClock, st.pliesFromNull);
+	int last = int(states.size()) - 1;
+
+	for (int i = 4; i <= end && last - i >= 0; i += 2)
+		if (states[last - i].key == st.key)
+			return true;
+
+	return false;
+}
+
+// isDraw: void -> bool
+// Returns true if the position is drawn by the fifty-move rule or by repetition.
+bool Position::isDraw() const {
+	if (states.back().halfmoveClock >= 100)
+		return true;
+	return isRepetition();
+}
+
+// The material keys reuse the piece-square keys, the count standing in for the square:
+Key materialKeyOf(int piece, int count) {
+	return zobristPiece[piece][count];
+}
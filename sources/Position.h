@@ -0,0 +1,111 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "Bitboards.h"
+#include "NNUE.h"
+
+// StateInfo holds the part of the position that cannot be restored from the move alone
+// when a move is unmade. The Position keeps a stack of them, one per move made.
+struct StateInfo {
+	Key key;
+	Key pawnKey;				// The key of the pawns alone, for the pawn hash table.
+	Key materialKey;			// The key of the piece counts, for the material hash table.
+	int castlingRights;
+	int epSquare;				// Set only when a pawn of the side to move can actually capture en passant.
+	int halfmoveClock;
+	int pliesFromNull;
+	int capturedPiece;
+	Bitboard checkers;			// The opponent's pieces giving check to the side to move.
+	Bitboard pinned;			// The side to move's pieces pinned to its own king.
+	DirtyPieces dirty;
+};
+
+// Position:
+// The board representation of the chess engine.
+//
+// Unlike the GameManager, the Position can make and unmake moves in constant time
+// and keeps a Zobrist hash key of the position up to date incrementally. It is
+// set up from a FEN string, which is also how the GameManager's game state can be
+// handed over to the engine.
+class Position
+{
+private:
+	int board[64];
+	Bitboard byType[6];
+	Bitboard byColor[2];
+	Color stm;
+	int gamePly;
+	std::vector<StateInfo> states;
+	std::vector<Accumulator> accumulators;	// Parallel to the states, but kept only once the network evaluation has used them.
+
+	void clear();
+	void putPiece(int piece, int sq);
+	void removePiece(int sq);
+	void movePiece(int from, int to);
+	StateInfo& pushState();
+	void popState();
+	void updateCheckInfo();
+	Key computeKey() const;
+	Key computePawnKey() const;
+	Key computeMaterialKey() const;
+
+public:
+	static const std::string startFEN;
+
+	Position();
+	Position(const Position& other);
+	Position& operator=(const Position& other);
+	void setFromFEN(const std::string& fen);
+	std::string toFEN() const;
+	void reserve(int plies);
+
+	Color sideToMove() const { return stm; }
+	int pieceOn(int sq) const { return board[sq]; }
+	Bitboard pieces() const { return byColor[White] | byColor[Black]; }
+	Bitboard pieces(Color c) const { return byColor[c]; }
+	Bitboard pieces(PieceType pt) const { return byType[pt]; }
+	Bitboard pieces(PieceType pt1, PieceType pt2) const { return byType[pt1] | byType[pt2]; }
+	Bitboard pieces(Color c, PieceType pt) const { return byColor[c] & byType[pt]; }
+	Bitboard pieces(Color c, PieceType pt1, PieceType pt2) const { return byColor[c] & (byType[pt1] | byType[pt2]); }
+	int kingSquare(Color c) const { return lsb(pieces(c, KingType)); }
+	bool hasNonPawnMaterial(Color c) const { return (pieces(c) & ~pieces(PawnType, KingType)) != 0; }
+
+	const StateInfo& state() const { return states.back(); }
+	StateInfo& state(int pliesBack) { return states[states.size() - 1 - pliesBack]; }
+	int stateCount() const { return int(states.size()); }
+	Accumulator& accumulator(int pliesBack);
+	Key key() const { return states.back().key; }
+	Key pawnKey() const { return states.back().pawnKey; }
+	Key materialKey() const { return states.back().materialKey; }
+	int castlingRights() const { return states.back().castlingRights; }
+	int epSquare() const { return states.back().epSquare; }
+	int halfmoveClock() const { return states.back().halfmoveClock; }
+	int plyCount() const { return gamePly; }
+	Bitboard checkers() const { return states.back().checkers; }
+	bool inCheck() const { return states.back().checkers != 0; }
+
+	Bitboard attackersTo(int sq, Bitboard occupied) const;
+	Bitboard attackersTo(int sq) const { return attackersTo(sq, pieces()); }
+	bool isAttacked(int sq, Color by) const { return (attackersTo(sq) & pieces(by)) != 0; }
+	Bitboard pinnedPieces(Color c) const;
+
+	int movedPiece(Move m) const { return board[moveFrom(m)]; }
+	bool isCapture(Move m) const;
+	bool isPseudoLegal(Move m) const;
+	bool isLegal(Move m) const;
+
+	void makeMove(Move m);
+	void unmakeMove(Move m);
+	void makeNullMove();
+	void unmakeNullMove();
+
+	bool isRepetition() const;
+	bool isDraw() const;
+};
+
+// materialKeyOf: piece, count -> Key
+// Returns the key of the count-th piece (counting from 0) of the given kind: the material
+// key of a position is the XOR of the keys of 0 ... n - 1 for every kind of piece it has
+// n of. Lets the GameManager keep a material key of its own.
+Key materialKeyOf(int piece, int count);
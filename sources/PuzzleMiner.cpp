@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "PuzzleMiner.h"
+#include "Engine.h"
+#include "GameFiles.h"
+#include "MateSolver.h"
+#include "MoveGen.h"
+#include "Notation.h"
+
+namespace {
+	// Puzzle is a position found to have a single winning move:
+	struct Puzzle {
+		Position pos;
+		std::vector<Move> line;		// The solution, starting with the winning move.
+		int score;
+		bool mate;
+		int ply;					// Where it was found in its game.
+	};
+
+	// uniqueMate: MateSolver&, const Position&, const PuzzleOptions&, MateResult& -> bool
+	// Returns true if the side to move mates by force within mateMoves moves, with the
+	// mate in the result, and no other first move mates as fast. A mate the solver cannot
+	// decide within its node budget counts as not verified.
+	bool uniqueMate(MateSolver& solver, const Position& pos, const PuzzleOptions& options, MateResult& result) {
+		result = solver.solve(pos, options.mateMoves, options.mateNodes);
+		if (result.status != MateStatus::Proven)
+			return false;
+
+		for (const ScoredMove& sm : MoveList(pos)) {
+			if (sm.move == result.line[0])
+				continue;
+
+			Position p = pos;
+			p.makeMove(sm.move);
+			MoveList replies(p);
+			if (replies.size() == 0) {
+				if (p.inCheck())
+					return false;
+				continue;
+			}
+			if (result.moves == 1)
+				continue;
+
+			// The move mates as fast only if every reply is mated in one move less:
+			bool mates = true;
+			for (const ScoredMove& reply : replies) {
+				Position q = p;
+				q.makeMove(reply.move);
+				MateResult r = solver.solve(q, result.moves - 1, options.mateNodes);
+				if (r.status == MateStatus::Unknown)
+					return false;
+				if (r.status == MateStatus::Disproven) {
+					mates = false;
+					break;
+				}
+			}
+			if (mates)
+				return false;
+		}
+		return true;
+	}
+
+	// findPuzzle: Engine&, MateSolver&, const Position&, previous score, const PuzzleOptions&, PuzzleStats&, Puzzle&, score -> bool
+	// Analyses the position and returns true if it is a puzzle. The score of the position,
+	// from the side to move's point of view, is left in score for the next position.
+	// The previous score is that of the position before, from the opponent's point of view.
+	bool findPuzzle(Engine& engine, MateSolver& solver, const Position& pos, int previousScore,
+					const PuzzleOptions& options, PuzzleStats& counts, Puzzle& puzzle, int& score) {
+		SearchLimits limits;
+		limits.nodes = options.nodes;
+		limits.multiPV = 2;
+		limits.startTime = now();
+		SearchResult result = engine.think(pos, limits);
+		counts.positions++;
+		score = result.score;
+
+		// A forced move, or a win that was already there, makes no puzzle:
+		if (result.lines.size() < 2 || -previousScore >= options.minScore)
+			return false;
+		if (result.score < options.minScore || result.score - result.lines[1].score < options.gap)
+			return false;
+
+		puzzle.pos = pos;
+		puzzle.score = result.score;
+		puzzle.mate = result.score >= mateBound;
+
+		if (puzzle.mate) {
+			MateResult mate;
+			if (!uniqueMate(solver, pos, options, mate)) {
+				counts.rejectedMates++;
+				return false;
+			}
+			puzzle.line = mate.line;
+			puzzle.score = mateIn(2 * mate.moves - 1);
+			return true;
+		}
+
+		puzzle.line.assign(result.pv.begin(), result.pv.begin() + (std::min)(int(result.pv.size()), options.linePlies));
+		return !puzzle.line.empty();
+	}
+}
+
+bool minePuzzles(const std::vector<std::string>& gameFiles, const std::string& puzzleFile, const PuzzleOptions& options,
+				 PuzzleStats& stats, std::function<void(const std::string&)> report, std::string& errorMsg) {
+	std::ofstream out(puzzleFile, std::ios::trunc);
+	if (!out.is_open()) {
+		errorMsg = "PUZZLE ERROR: could not open the file " + puzzleFile;
+		return false;
+	}
+
+	SavedGameStream stream(gameFiles);
+	std::mutex outMutex;
+	std::unordered_set<Key> written;		// The same position may turn up in many games.
+	stats = PuzzleStats();
+
+	auto work = [&] {
+		Engine engine;
+		engine.setHashSize(options.hashMB);
+		MateSolver solver;
+		std::vector<Move> moves;
+		std::vector<Puzzle> puzzles;
+		std::string file;
+
+		while (stream.next(file)) {
+			PuzzleStats counts;
+			puzzles.clear();
+			bool replayed = readSavedGame(file, moves);
+
+			Position pos;
+			pos.setFromFEN(Position::startFEN);
+			engine.newGame();
+			int score = 0;
+			for (int ply = 0; ply <= int(moves.size()); ply++) {
+				if (ply >= options.skipPlies && MoveList(pos).size() > 0) {
+					Puzzle puzzle;
+					int previousScore = score;
+					if (findPuzzle(engine, solver, pos, previousScore, options, counts, puzzle, score)) {
+						puzzle.ply = ply;
+						puzzles.push_back(puzzle);
+					}
+				}
+				if (ply < int(moves.size()))
+					pos.makeMove(moves[ply]);
+			}
+
+			std::lock_guard<std::mutex> lock(outMutex);
+			stats.games++;
+			stats.badGames += !replayed;
+			stats.positions += counts.positions;
+			stats.rejectedMates += counts.rejectedMates;
+
+			for (const Puzzle& p : puzzles) {
+				if (!written.insert(p.pos.key()).second)
+					continue;
+				out << p.pos.toFEN() << " ; " << lineToSAN(p.pos, p.line) << " ; " << formatScore(p.score)
+					<< " (" << file << ", move " << p.ply / 2 + 1 << ")\n";
+				stats.puzzles++;
+				stats.mates += p.mate;
+			}
+			out.flush();
+
+			if (!puzzles.empty())
+				report(file + ": " + std::to_string(puzzles.size()) + " puzzles");
+		}
+	};
+
+	int threadCount = options.threads > 0 ? options.threads : (std::max)(1, int(std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+		threads.emplace_back(work);
+	for (std::thread& t : threads)
+		t.join();
+
+	out.close();
+	if (out.fail()) {
+		errorMsg = "PUZZLE ERROR: could not write the file " + puzzleFile;
+		return false;
+	}
+	return true;
+}
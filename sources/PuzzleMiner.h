@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// PuzzleOptions controls how the positions are analysed and which of them make puzzles:
+struct PuzzleOptions {
+	uint64_t nodes;				// The node budget of the two-line analysis of every position.
+	int threads;				// The games mined at once; 0 for one per core.
+	size_t hashMB;				// The transposition table of each thread.
+	int skipPlies;				// The first plies of every game are left out.
+	int minScore;				// The best move must win at least this many centipawns,
+	int gap;					// and the second best this many less.
+	int mateMoves;				// The longest mates verified by the mate solver,
+	uint64_t mateNodes;			// with this many nodes for each of its searches.
+	int linePlies;				// The length of the solution lines of the puzzles that are not mates.
+
+	PuzzleOptions() {
+		nodes = 100000; threads = 0; hashMB = 32; skipPlies = 10; minScore = 200; gap = 200;
+		mateMoves = 5; mateNodes = 200000; linePlies = 6;
+	}
+};
+
+// PuzzleStats reports what the mining went through:
+struct PuzzleStats {
+	uint64_t games;				// The games read,
+	uint64_t badGames;			// of which this many had a move that could not be replayed.
+	uint64_t positions;			// The positions analysed.
+	uint64_t puzzles;			// The puzzles written,
+	uint64_t mates;				// of which this many are verified mates.
+	uint64_t rejectedMates;		// The mates the solver could not show to be forced and unique.
+
+	PuzzleStats() { games = badGames = positions = puzzles = mates = rejectedMates = 0; }
+};
+
+// minePuzzles: game files, puzzle file name, const PuzzleOptions&, PuzzleStats&, report, error message -> bool
+// Looks for tactical puzzles in the saved games (in the .clc format written by
+// GameManager::save; directories are searched for .clc files) and writes them into the
+// puzzle file, one per line: the FEN, the solution line and its evaluation, and the game
+// and move it comes from.
+//
+// A position is a puzzle when a two-line (Multi-PV) analysis finds one move winning at
+// least minScore and every other move at least gap less, and the side to move was not
+// already winning as much before the opponent's last move. A winning move that mates is
+// handed to the mate solver, which must prove the mate and that no other first move mates
+// as fast; the puzzle's solution is then the mating line.
+//
+// The games are streamed: the threads take the files one at a time from a SavedGameStream
+// and write the puzzles as they are found, so the memory used does not grow with the size
+// of the archive; only the keys of the puzzles written are kept, so that a position is
+// written once. The puzzles come in no particular order. Every game with puzzles is reported.
+//
+// Returns false, with the reason in errorMsg, if the puzzle file cannot be written.
+bool minePuzzles(const std::vector<std::string>& gameFiles, const std::string& puzzleFile, const PuzzleOptions& options,
+				 PuzzleStats& stats, std::function<void(const std::string&)> report, std::string& errorMsg);
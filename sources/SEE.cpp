@@ -0,0 +1,126 @@
+#include <algorithm>
+#include "SEE.h"
+#include "Position.h"
+#include "Evaluation.h"
+
+namespace {
+
+	// The longest possible capture sequence on one square is bounded by the number of pieces:
+	const int maxExchanges = 32;
+
+	inline int promotionGain(PieceType promo) {
+		return pieceValue[promo] - pieceValue[PawnType];
+	}
+}
+
+// see: const Position&, Move -> int
+// The exchange is played out as a swap list: gain[d] is the material balance for the
+// side making the d:th capture, assuming the exchange stops right after it. The list
+// is then folded backwards, letting each side stop as soon as it would lose material.
+int see(const Position& pos, Move m) {
+	if (moveKind(m) == CastlingMove)
+		return 0;
+
+	int from = moveFrom(m);
+	int to = moveTo(m);
+	int gain[maxExchanges];
+	int d = 0;
+
+	Color stm = pieceColor(pos.movedPiece(m));
+	PieceType attacker = pieceType(pos.movedPiece(m));
+	Bitboard occupied = pos.pieces() ^ squareBB(from);
+	bool promotionSquare = rankOf(to) == 0 || rankOf(to) == 7;
+
+	// 1. The first capture:
+	if (moveKind(m) == EnPassantMove) {
+		occupied ^= squareBB(makeSquare(fileOf(to), rankOf(from)));
+		gain[0] = pieceValue[PawnType];
+	}
+	else
+		gain[0] = pos.pieceOn(to) == noPiece ? 0 : pieceValue[pieceType(pos.pieceOn(to))];
+
+	if (moveKind(m) == PromotionMove) {
+		attacker = promotionType(m);
+		gain[0] += promotionGain(attacker);
+	}
+
+	// 2. The recaptures, least valuable attacker first:
+	Bitboard diagonalSliders = pos.pieces(BishopType, QueenType);
+	Bitboard straightSliders = pos.pieces(RookType, QueenType);
+	Bitboard attackers = pos.attackersTo(to, occupied) & occupied;
+
+	while (d + 1 < maxExchanges) {
+		stm = ~stm;
+		Bitboard ours = attackers & pos.pieces(stm);
+		if (!ours)
+			break;
+
+		int pt = PawnType;
+		while (!(ours & pos.pieces(PieceType(pt))))
+			pt++;
+
+		// The king cannot capture a defended piece:
+		if (pt == KingType && (attackers & pos.pieces(~stm)))
+			break;
+
+		d++;
+		gain[d] = pieceValue[attacker] - gain[d - 1];
+		occupied ^= squareBB(lsb(ours & pos.pieces(PieceType(pt))));
+
+		// Removing the capturing piece may uncover a slider behind it:
+		if (pt == PawnType || pt == BishopType || pt == QueenType)
+			attackers |= bishopAttacks(to, occupied) & diagonalSliders;
+		if (pt == RookType || pt == QueenType)
+			attackers |= rookAttacks(to, occupied) & straightSliders;
+		attackers &= occupied;
+
+		attacker = PieceType(pt);
+		if (pt == PawnType && promotionSquare) {
+			attacker = QueenType;
+			gain[d] += promotionGain(QueenType);
+		}
+	}
+
+	// 3. Fold the swap list back to the first capture:
+	for (; d > 0; d--)
+		gain[d - 1] = -(std::max)(-gain[d - 1], gain[d]);
+
+	return gain[0];
+}
+
+bool seeGE(const Position& pos, Move m, int threshold) {
+	return see(pos, m) >= threshold;
+}
+
+// exchangeGain: const Position&, square -> int
+// Tries every capture of the piece and keeps the best one.
+int exchangeGain(const Position& pos, int sq) {
+	int piece = pos.pieceOn(sq);
+	if (piece == noPiece)
+		return 0;
+
+	Color them = ~pieceColor(piece);
+	int best = 0;
+
+	for (Bitboard b = pos.attackersTo(sq) & pos.pieces(them); b; ) {
+		int from = popLsb(b);
+		Move m = encodeMove(from, sq);
+		if (pieceType(pos.pieceOn(from)) == PawnType && (rankOf(sq) == 0 || rankOf(sq) == 7))
+			m = encodeMove(from, sq, PromotionMove, QueenType);
+		best = (std::max)(best, see(pos, m));
+	}
+
+	return best;
+}
+
+Bitboard hangingPieces(const Position& pos, Color c) {
+	Bitboard hanging = 0;
+
+	for (Bitboard b = pos.pieces(c) & ~pos.pieces(KingType); b; ) {
+		int sq = popLsb(b);
+		if (exchangeGain(pos, sq) > 0)
+			hanging |= squareBB(sq);
+	}
+
+	return hanging;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "EngineDefinitions.h"
+
+class Position;
+
+// Static exchange evaluation (SEE):
+// Works out the material outcome of a sequence of captures on one square from the
+// attack sets alone, without making any moves. Both sides always recapture with their
+// least valuable piece and may stop capturing whenever continuing would lose material.
+//
+// NOTE:
+// Pins and checks are not taken into account, so the result is an estimate.
+// Sliders lined up behind the capturing pieces (x-rays) are taken into account.
+
+// see: const Position&, Move -> int
+// Returns the material the side making the capture gains (or loses, if negative)
+// in centipawns. A non-capturing move gets the value of losing the moved piece
+// to the best exchange on its destination square, if any.
+int see(const Position& pos, Move m);
+
+// seeGE: const Position&, Move, threshold -> bool
+// Returns true if the static exchange evaluation of the move is at least the threshold.
+bool seeGE(const Position& pos, Move m, int threshold);
+
+// exchangeGain: const Position&, square -> int
+// Returns the most material the opponent of the piece on the given square can win by
+// capturing it, or 0 if the piece cannot be won.
+int exchangeGain(const Position& pos, int sq);
+
+// hangingPieces: const Position&, Color -> Bitboard
+// Returns the pieces of the given side that the opponent can win material by capturing.
+// The king is never included.
+Bitboard hangingPieces(const Position& pos, Color c);
@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "Search.h"
+#include "Evaluation.h"
+#include "Material.h"
+#include "SEE.h"
+#include "Tablebase.h"
+
+namespace {
+	// The history values stay within [-historyMax, historyMax]:
+	const int historyMax = 16384;
+	const int historyBonusMax = 1200;
+
+	// Selective search parameters. Depths are in plies and margins in centipawns:
+	const int reverseFutilityDepth = 6;
+	const int reverseFutilityMargin = 90;
+	const int nullMoveDepth = 3;
+	const int futilityDepth = 3;
+	const int futilityMargin = 120;
+	const int lmrDepth = 3;
+	const int lmrHistoryDivisor = 8192;
+	const int aspirationDepth = 5;
+	const int aspirationDelta = 25;
+
+	// The late move reductions by depth and move number, filled in before main is entered:
+	int reductions[64][64];
+
+	struct ReductionInitializer {
+		ReductionInitializer() {
+			for (int depth = 1; depth < 64; depth++)
+				for (int moveNum = 1; moveNum < 64; moveNum++)
+					reductions[depth][moveNum] = int(0.75 + std::log(double(depth)) * std::log(double(moveNum)) / 2.25);
+		}
+	};
+
+	ReductionInitializer reductionInitializer;
+
+	inline int reduction(int depth, int moveNum) {
+		return reductions[(std::min)(depth, 63)][(std::min)(moveNum, 63)];
+	}
+
+	// updateHistory: history entry, bonus -> void
+	// Adds the bonus to the entry, scaled down the closer the entry already is to the limit.
+	// The old value thus decays a little with every update, and recent cutoffs count the most.
+	inline void updateHistory(int& entry, int bonus) {
+		entry += bonus - entry * std::abs(bonus) / historyMax;
+	}
+}
+
+// Private methods:
+// -----------------------------
+
+// aspirationSearch: Position&, depth, previous score -> int
+// Searches the root to the given depth with a narrow window around the score the
+// same line had in the previous iteration, which makes most iterations cheaper.
+// When the score falls outside the window, the window is widened on that side and
+// the root is searched again, until the score is exact.
+int Search::aspirationSearch(Position& pos, int depth, int prevScore) {
+	int alpha = -infiniteScore;
+	int beta = infiniteScore;
+	int delta = aspirationDelta;
+
+	if (depth >= aspirationDepth && std::abs(prevScore) < mateBound) {
+		alpha = (std::max)(prevScore - delta, -infiniteScore);
+		beta = (std::min)(prevScore + delta, int(infiniteScore));
+	}
+
+	while (true) {
+		int score = alphaBeta(pos, alpha, beta, depth, 0);
+		if (stopped.load(std::memory_order_relaxed))
+			return score;
+
+		if (score <= alpha)
+			alpha = (std::max)(score - delta, -infiniteScore);
+		else if (score >= beta)
+			beta = (std::min)(score + delta, int(infiniteScore));
+		else
+			return score;
+
+		delta *= 2;
+	}
+}
+
+// alphaBeta: Position&, alpha, beta, depth, ply -> int
+// Searches the position to the given depth and returns its score from the side
+// to move's point of view. The score is exact if it falls within (alpha, beta),
+// otherwise it is an upper bound (score <= alpha) or a lower bound (score >= beta).
+//
+// Besides the plain alpha-beta cutoffs, lines that are unlikely to matter are pruned
+// or searched to a reduced depth (see SearchOptions).
+int Search::alphaBeta(Position& pos, int alpha, int beta, int depth, int ply) {
+	bool pvNode = beta - alpha > 1;
+	bool rootNode = ply == 0;
+	bool inCheck = pos.inCheck();
+	pvLength[ply] = ply;
+
+	// Check extension: a check is never left for the quiescence search to resolve.
+	if (inCheck && options.checkExtensions && !rootNode)
+		depth++;
+
+	if (depth <= 0)
+		return quiescence(pos, alpha, beta, ply);
+
+	countNode();
+
+	if (!rootNode) {
+		if (pos.isDraw() || insufficientMaterial(pos, material))
+			return drawScore;
+		if (ply >= maxPly)
+			return inCheck ? drawScore : evaluate(pos, pawns, material);
+
+		// Mate distance pruning: no line from here can beat a shorter mate already found.
+		alpha = (std::max)(alpha, matedIn(ply));
+		beta = (std::min)(beta, mateIn(ply + 1));
+		if (alpha >= beta)
+			return alpha;
+
+		// With few enough pieces left, the tablebases know the exact value:
+		if (tablebasePieces() && pos.castlingRights() == 0 && popCount(pos.pieces()) <= tablebasePieces()) {
+			TBResult tb;
+			if (probeTablebase(pos, tb)) {
+				tbHits++;
+				return tablebaseScore(tb, ply);
+			}
+		}
+	}
+
+	// 1. Probe the transposition table:
+	TTEntry tte;
+	bool ttHit = tt.probe(pos.key(), tte);
+	Move ttMove = ttHit ? tte.move : noMove;
+
+	if (ttHit && !pvNode && tte.depth >= depth) {
+		int ttScore = scoreFromTT(tte.score, ply);
+		if ((tte.bound() == ExactBound) ||
+			(tte.bound() == LowerBound && ttScore >= beta) ||
+			(tte.bound() == UpperBound && ttScore <= alpha))
+			return ttScore;
+	}
+
+	// 2. Node pruning, based on the static evaluation:
+	int staticEval = inCheck ? -infiniteScore : evaluate(pos, pawns, material);
+
+	if (!pvNode && !inCheck && std::abs(beta) < mateBound) {
+		// Reverse futility pruning: far enough above beta, a shallow search is
+		// not expected to bring the score back down.
+		if (options.reverseFutility && depth <= reverseFutilityDepth &&
+			staticEval - reverseFutilityMargin * depth >= beta)
+			return staticEval;
+
+		// Null move pruning: if passing the turn still fails high, a real move would too.
+		// This fails in zugzwang, which is common in endings with only pawns left, so the
+		// side to move must have a piece. Two null moves in a row are not allowed.
+		if (options.nullMove && depth >= nullMoveDepth && staticEval >= beta &&
+			pos.state().pliesFromNull > 0 && pos.hasNonPawnMaterial(pos.sideToMove())) {
+			int R = 3 + depth / 6;
+
+			moveStack[ply] = nullMove;
+			pos.makeNullMove();
+			int score = -alphaBeta(pos, -beta, -beta + 1, depth - 1 - R, ply + 1);
+			pos.unmakeNullMove();
+
+			if (stopped.load(std::memory_order_relaxed))
+				return 0;
+
+			// Mate scores found after a null move cannot be trusted:
+			if (score >= beta)
+				return score >= mateBound ? beta : score;
+		}
+	}
+
+	// 3. Search the moves:
+	Move prevMove = rootNode ? noMove : moveStack[ply - 1];
+	Move counterMove = prevMove != noMove && prevMove != nullMove ?
+					   counterMoves[pos.pieceOn(moveTo(prevMove))][moveTo(prevMove)] : noMove;
+
+	MovePicker picker(pos, ttMove, killers[ply], counterMove, history);
+	Move quiets[maxMoves];
+	int quietCount = 0;
+	int moveCount = 0;
+	int bestScore = -infiniteScore;
+	Move bestMove = noMove;
+	int oldAlpha = alpha;
+	Move m;
+
+	// Futility pruning: quiet moves that cannot raise the static evaluation
+	// anywhere near alpha are not searched at the last few plies.
+	bool futile = options.futility && !pvNode && !inCheck && depth <= futilityDepth &&
+				  staticEval + futilityMargin * depth <= alpha;
+
+	while ((m = picker.nextMove()) != noMove) {
+		if (!pos.isLegal(m))
+			continue;
+		if (rootNode && std::find(excludedRootMoves.begin(), excludedRootMoves.end(), m) != excludedRootMoves.end())
+			continue;
+
+		moveCount++;
+		bool quiet = !pos.isCapture(m) && moveKind(m) != PromotionMove;
+
+		moveStack[ply] = m;
+		pos.makeMove(m);
+		bool givesCheck = pos.inCheck();
+
+		if (futile && quiet && !givesCheck && bestScore > -mateBound) {
+			pos.unmakeMove(m);
+			continue;
+		}
+
+		int score;
+		if (moveCount == 1)
+			score = -alphaBeta(pos, -beta, -alpha, depth - 1, ply + 1);
+		else {
+			// Late move reductions: the later a quiet move comes in the move order, the
+			// less likely it is to be best, so it is first searched to a reduced depth.
+			int R = 0;
+			if (options.lateMoveReductions && depth >= lmrDepth && quiet && !inCheck && !givesCheck) {
+				R = reduction(depth, moveCount);
+				if (pvNode)
+					R--;
+				if (m == killers[ply][0] || m == killers[ply][1])
+					R--;
+				R -= history[~pos.sideToMove()][moveFrom(m)][moveTo(m)] / lmrHistoryDivisor;
+				R = (std::max)(0, (std::min)(R, depth - 2));
+			}
+
+			// The later moves are expected to fail low, which is first tested
+			// with a null window and only re-searched if the test fails:
+			score = -alphaBeta(pos, -alpha - 1, -alpha, depth - 1 - R, ply + 1);
+			if (R > 0 && score > alpha)
+				score = -alphaBeta(pos, -alpha - 1, -alpha, depth - 1, ply + 1);
+			if (score > alpha && score < beta)
+				score = -alphaBeta(pos, -beta, -alpha, depth - 1, ply + 1);
+		}
+		pos.unmakeMove(m);
+
+		if (stopped.load(std::memory_order_relaxed))
+			return 0;
+
+		if (score > bestScore) {
+			bestScore = score;
+			if (score > alpha) {
+				bestMove = m;
+				alpha = score;
+				updatePV(ply, m);
+				if (score >= beta) {
+					cutoffs++;
+					if (moveCount == 1)
+						firstMoveCutoffs++;
+					if (quiet)
+						updateQuietStats(pos, m, prevMove, quiets, quietCount, depth, ply);
+					break;
+				}
+			}
+		}
+
+		if (quiet)
+			quiets[quietCount++] = m;
+	}
+
+	// 4. Checkmate or stalemate:
+	if (moveCount == 0)
+		return inCheck ? matedIn(ply) : drawScore;
+
+	// The root scores of the later Multi-PV lines are not scores of the position:
+	if (rootNode && !excludedRootMoves.empty())
+		return bestScore;
+
+	Bound bound = bestScore >= beta ? LowerBound : (bestScore > oldAlpha ? ExactBound : UpperBound);
+	tt.store(pos.key(), scoreToTT(bestScore, ply), bound, depth, bestMove);
+
+	return bestScore;
+}
+
+// quiescence: Position&, alpha, beta, ply -> int
+// Extends the search at the leaves until the position is quiet, so that the
+// static evaluation is never taken in the middle of an exchange.
+//
+// Only captures and queen promotions are searched, and the side to move may always
+// "stand pat" on its static evaluation instead of capturing. Captures that lose
+// material according to SEE are skipped. When in check, all the evasions are searched
+// and standing pat is not allowed.
+int Search::quiescence(Position& pos, int alpha, int beta, int ply) {
+	bool pvNode = beta - alpha > 1;
+	bool inCheck = pos.inCheck();
+	pvLength[ply] = ply;
+
+	countNode();
+
+	if (pos.isDraw() || insufficientMaterial(pos, material))
+		return drawScore;
+	if (ply >= maxPly)
+		return inCheck ? drawScore : evaluate(pos, pawns, material);
+
+	// 1. Probe the transposition table. Any entry is deep enough here:
+	TTEntry tte;
+	bool ttHit = tt.probe(pos.key(), tte);
+	Move ttMove = ttHit ? tte.move : noMove;
+
+	if (ttHit && !pvNode) {
+		int ttScore = scoreFromTT(tte.score, ply);
+		if ((tte.bound() == ExactBound) ||
+			(tte.bound() == LowerBound && ttScore >= beta) ||
+			(tte.bound() == UpperBound && ttScore <= alpha))
+			return ttScore;
+	}
+
+	// 2. Stand pat:
+	int bestScore = -infiniteScore;
+	if (!inCheck) {
+		bestScore = evaluate(pos, pawns, material);
+		if (bestScore >= beta)
+			return bestScore;
+		if (bestScore > alpha)
+			alpha = bestScore;
+	}
+
+	// 3. Search the captures:
+	MovePicker picker(pos, ttMove, history);
+	int moveCount = 0;
+	Move m;
+
+	while ((m = picker.nextMove()) != noMove) {
+		if (!inCheck && !seeGE(pos, m, 0))
+			continue;
+		if (!pos.isLegal(m))
+			continue;
+
+		moveCount++;
+		pos.makeMove(m);
+		int score = -quiescence(pos, -beta, -alpha, ply + 1);
+		pos.unmakeMove(m);
+
+		if (stopped.load(std::memory_order_relaxed))
+			return 0;
+
+		if (score > bestScore) {
+			bestScore = score;
+			if (score > alpha) {
+				alpha = score;
+				updatePV(ply, m);
+				if (score >= beta)
+					break;
+			}
+		}
+	}
+
+	// 4. Checkmate. Stalemates are not detected, since the quiet moves are not generated:
+	if (inCheck && moveCount == 0)
+		return matedIn(ply);
+
+	return bestScore;
+}
+
+// countNode: void -> void
+// Counts a visited node and polls the limits when it is time to.
+// Only this thread writes the counter, so no atomic read-modify-write is needed.
+inline void Search::countNode() {
+	uint64_t n = nodes.load(std::memory_order_relaxed) + 1;
+	nodes.store(n, std::memory_order_relaxed);
+	if (n >= nextPoll)
+		pollLimits();
+}
+
+// pollLimits: void -> void
+// Stops the search if the node limit or the hard time budget has been reached.
+// The clock is not looked at while pondering.
+// Is called only every pollInterval nodes, so that reading the clock costs next to
+// nothing per node. The first iteration is always completed, so that there is a move
+// to play.
+void Search::pollLimits() {
+	uint64_t n = nodeCount();
+	nextPoll = n + pollInterval;
+	if (limits.nodes)
+		nextPoll = (std::min)(nextPoll, limits.nodes);
+
+	if (completedDepth == 0)
+		return;
+
+	if ((limits.nodes && n >= limits.nodes) || (!pondering && timeManager.hardLimitReached()))
+		stopped = true;
+}
+
+// updatePV: ply, Move -> void
+// Makes the given move followed by the child's principal variation the
+// principal variation of the node at the given ply.
+void Search::updatePV(int ply, Move m) {
+	pvTable[ply][ply] = m;
+	for (int i = ply + 1; i < pvLength[ply + 1]; i++)
+		pvTable[ply][i] = pvTable[ply + 1][i];
+	pvLength[ply] = (std::max)(pvLength[ply + 1], ply + 1);
+}
+
+// updateQuietStats: Position, best move, previous move, tried quiets, count, depth, ply -> void
+// Rewards the quiet move that caused a beta cutoff and penalizes the quiet moves
+// tried before it. The move also becomes a killer of its ply and the countermove
+// of the previous move.
+void Search::updateQuietStats(const Position& pos, Move best, Move prevMove, const Move* quiets, int quietCount, int depth, int ply) {
+	Color us = pos.sideToMove();
+	int bonus = (std::min)(depth * depth, historyBonusMax);
+
+	if (killers[ply][0] != best) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = best;
+	}
+
+	if (prevMove != noMove && prevMove != nullMove)
+		counterMoves[pos.pieceOn(moveTo(prevMove))][moveTo(prevMove)] = best;
+
+	updateHistory(history[us][moveFrom(best)][moveTo(best)], bonus);
+	for (int i = 0; i < quietCount; i++)
+		updateHistory(history[us][moveFrom(quiets[i])][moveTo(quiets[i])], -bonus);
+}
+
+// Public methods:
+// -----------------------------
+
+Search::Search(TranspositionTable& _tt) : tt(_tt) {
+	stopped = false;
+	pondering = false;
+	nodes = 0;
+	cutoffs = firstMoveCutoffs = tbHits = 0;
+	nextPoll = pollInterval;
+	completedDepth = 0;
+	clearHistory();
+}
+
+// run: const Position&, const SearchLimits& -> SearchResult
+// Searches the position with iterative deepening until the limits are reached or
+// the search is stopped. Returns the result of the last completed iteration.
+//
+// The search works on its own copy of the position. When it returns, the search
+// is no longer stopped and can be run again.
+SearchResult Search::run(const Position& rootPos, const SearchLimits& _limits) {
+	Position pos = rootPos;
+	pos.reserve(maxPly);
+	SearchResult result;
+
+	limits = _limits;
+	timeManager.init(limits, pos.sideToMove());
+	nodes = 0;
+	nextPoll = limits.nodes ? (std::min)(pollInterval, limits.nodes) : pollInterval;
+	completedDepth = 0;
+	cutoffs = firstMoveCutoffs = tbHits = 0;
+	tt.newSearch();
+	for (int ply = 0; ply <= maxPly; ply++)
+		killers[ply][0] = killers[ply][1] = noMove;
+
+	// The history of the previous searches still helps, but is given less weight:
+	for (int c = 0; c < 2; c++)
+		for (int from = 0; from < 64; from++)
+			for (int to = 0; to < 64; to++)
+				history[c][from][to] /= 2;
+
+	// In the Multi-PV mode, each iteration searches the root once per line, every time
+	// leaving out the moves of the lines already found:
+	int multiPV = (std::max)(1, (std::min)(limits.multiPV, int(MoveList(pos).size())));
+	std::vector<PVLine> lines;
+
+	for (int depth = 1; depth <= limits.depth && depth < maxPly; depth++) {
+		std::vector<PVLine> iterationLines;
+		int score = 0;
+		excludedRootMoves.clear();
+
+		for (int pvIdx = 0; pvIdx < multiPV; pvIdx++) {
+			score = aspirationSearch(pos, depth, pvIdx < int(lines.size()) ? lines[pvIdx].score : 0);
+			if (stopped.load() || pvLength[0] == 0)
+				break;
+
+			PVLine line;
+			line.score = score;
+			line.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+			iterationLines.push_back(line);
+			excludedRootMoves.push_back(line.pv[0]);
+		}
+		excludedRootMoves.clear();
+
+		// An interrupted iteration is discarded, unless there is nothing else:
+		if (stopped.load() && (result.bestMove != noMove || iterationLines.empty()))
+			break;
+
+		// A later line may turn out better than an earlier one, whose score was found
+		// with the later move still among the candidates:
+		std::stable_sort(iterationLines.begin(), iterationLines.end(),
+						 [](const PVLine& a, const PVLine& b) { return a.score > b.score; });
+		lines = iterationLines;
+
+		completedDepth = depth;
+		result.depth = depth;
+		result.score = lines.empty() ? score : lines[0].score;
+		result.nodes = nodeCount();
+		result.cutoffs = cutoffs;
+		result.firstMoveCutoffs = firstMoveCutoffs;
+		result.tbHits = tbHits;
+		result.pv = lines.empty() ? std::vector<Move>() : lines[0].pv;
+		result.bestMove = result.pv.empty() ? noMove : result.pv[0];
+		result.lines = lines;
+
+		if (onIteration)
+			onIteration(result);
+
+		// There is no need to look deeper once a mate has been found, or if
+		// there are no moves at all. A new iteration is not started once the
+		// soft time budget has been used, since it would hardly ever finish:
+		if (result.bestMove == noMove || stopped.load() || (multiPV == 1 && std::abs(result.score) >= mateBound))
+			break;
+		if ((!pondering && timeManager.softLimitReached()) || (limits.nodes && nodeCount() >= limits.nodes))
+			break;
+	}
+
+	// A search stopped before its first iteration completed still has to play a move:
+	if (result.bestMove == noMove) {
+		MoveList legal(pos);
+		if (legal.size() > 0) {
+			result.bestMove = legal.begin()->move;
+			result.pv.assign(1, result.bestMove);
+		}
+	}
+
+	result.nodes = nodeCount();
+	result.cutoffs = cutoffs;
+	result.firstMoveCutoffs = firstMoveCutoffs;
+	result.tbHits = tbHits;
+	stopped = false;
+	pondering = false;
+	return result;
+}
+
+// stop: void -> void
+// Stops a running search as soon as possible. Safe to call from another thread.
+void Search::stop() {
+	stopped = true;
+}
+
+// prepare: const SearchLimits& -> void
+// Withdraws a stop request that arrived when no search was running, and enters the
+// ponder mode if the limits ask for it. Is called before a search is started on another
+// thread, so that a stop() or ponderhit() arriving before run is entered is not lost.
+void Search::prepare(const SearchLimits& limits) {
+	stopped = false;
+	nodes = 0;
+	pondering = limits.ponder;
+}
+
+// ponderhit: void -> void
+// The opponent played the move the search was pondering on: the search goes on as
+// a normal search, with the clock running from now. Safe to call from another thread.
+void Search::ponderhit() {
+	timeManager.restart(now());
+	pondering = false;
+}
+
+// clearHistory: void -> void
+// Forgets the move ordering statistics, for example when a new game starts.
+void Search::clearHistory() {
+	std::memset(history, 0, sizeof(history));
+	std::memset(killers, 0, sizeof(killers));
+	std::memset(counterMoves, 0, sizeof(counterMoves));
+}
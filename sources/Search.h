@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "EngineDefinitions.h"
+#include "Material.h"
+#include "MovePicker.h"
+#include "Pawns.h"
+#include "Position.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+// SearchOptions switches the selective search techniques on and off, so that the
+// effect of each of them on the node counts and playing strength can be measured.
+struct SearchOptions {
+	bool nullMove;				// Null move pruning.
+	bool lateMoveReductions;	// Reducing the depth of the late quiet moves.
+	bool futility;				// Skipping quiet moves near the leaves when far below alpha.
+	bool reverseFutility;		// Cutting off nodes near the leaves when far above beta.
+	bool checkExtensions;		// Searching positions in check one ply deeper.
+
+	SearchOptions() { nullMove = lateMoveReductions = futility = reverseFutility = checkExtensions = true; }
+};
+
+// PVLine is one of the best moves found at the root, with its score and principal variation.
+struct PVLine {
+	int score;
+	std::vector<Move> pv;
+};
+
+// SearchResult describes the outcome of a completed search iteration.
+// In the Multi-PV mode, lines holds the best moves in order, the first of them
+// being the one given by bestMove, score and pv.
+struct SearchResult {
+	Move bestMove;
+	int score;
+	int depth;
+	uint64_t nodes;
+	uint64_t cutoffs;				// The beta cutoffs of the main search,
+	uint64_t firstMoveCutoffs;		// and how many of them were caused by the first move searched.
+	uint64_t tbHits;				// The positions found in the tablebases.
+	std::vector<Move> pv;
+	std::vector<PVLine> lines;
+
+	SearchResult() { bestMove = noMove; score = 0; depth = 0; nodes = cutoffs = firstMoveCutoffs = tbHits = 0; }
+
+	// firstMoveCutoffRate: void -> double
+	// The share of the beta cutoffs caused by the first move, which measures the move ordering.
+	double firstMoveCutoffRate() const { return cutoffs ? double(firstMoveCutoffs) / cutoffs : 0.0; }
+};
+
+// Search:
+// An alpha-beta (principal variation) searcher with iterative deepening.
+//
+// A Search object holds the state of one search thread: its node counter, the
+// principal variation, the move ordering tables and the pawn and material tables of
+// the evaluation, which are kept from one search to the next. The transposition table
+// is passed in so that it can be shared between threads and between searches.
+//
+// A search can be stopped from another thread with stop(). Whoever starts the search
+// on another thread calls prepare() first, after which a stop requested before run is
+// entered is honoured.
+class Search
+{
+private:
+	TranspositionTable& tt;
+	std::atomic<bool> stopped;
+	std::atomic<bool> pondering;
+	std::atomic<uint64_t> nodes;		// Read by other threads for reporting.
+	uint64_t cutoffs;
+	uint64_t firstMoveCutoffs;
+	uint64_t tbHits;
+
+	// The limits are polled every pollInterval nodes, or sooner if the node limit comes first:
+	static const uint64_t pollInterval = 1024;
+	SearchLimits limits;
+	TimeManager timeManager;
+	uint64_t nextPoll;
+	int completedDepth;
+
+	// The move ordering tables:
+	Move killers[maxPly + 1][2];
+	ButterflyHistory history;
+	CounterMoveTable counterMoves;
+	Move moveStack[maxPly + 1];		// The moves leading to the current node, for the countermoves.
+	Move pvTable[maxPly + 1][maxPly + 1];
+	int pvLength[maxPly + 1];
+
+	// The evaluation's tables, read and written by this thread only:
+	PawnTable pawns;
+	MaterialTable material;
+
+	// In the Multi-PV mode, the root moves whose lines have already been found in the
+	// current iteration are left out when searching for the next best move:
+	std::vector<Move> excludedRootMoves;
+
+	int aspirationSearch(Position& pos, int depth, int prevScore);
+	int alphaBeta(Position& pos, int alpha, int beta, int depth, int ply);
+	int quiescence(Position& pos, int alpha, int beta, int ply);
+	void pollLimits();
+	void countNode();
+	void updatePV(int ply, Move m);
+	void updateQuietStats(const Position& pos, Move best, Move prevMove, const Move* quiets, int quietCount, int depth, int ply);
+
+public:
+	SearchOptions options;
+
+	// onIteration is called after every completed iteration, for reporting the progress:
+	std::function<void(const SearchResult&)> onIteration;
+
+	explicit Search(TranspositionTable& tt);
+	SearchResult run(const Position& pos, const SearchLimits& limits);
+	const TimeManager& time() const { return timeManager; }
+	uint64_t nodeCount() const { return nodes.load(std::memory_order_relaxed); }
+	const PawnTable& pawnTable() const { return pawns; }
+	bool isPondering() const { return pondering; }
+	void ponderhit();
+	void stop();
+	void prepare(const SearchLimits& limits);
+	void clearHistory();
+};
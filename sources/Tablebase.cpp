@@ -0,0 +1,804 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <thread>
+#include "Tablebase.h"
+#include "Bitboards.h"
+#include "MappedFile.h"
+#include "Position.h"
+
+namespace {
+
+	// The values are stored in one byte, from the side to move's point of view:
+	//		0				a draw (or, during the generation, not known yet)
+	//		1 ... 127		a win, mate in that many plies
+	//		128 ... 255		a loss, mated in (value - 128) plies
+	const uint8_t drawValue = 0;
+	const int maxPlies = 127;
+
+	inline uint8_t winIn(int plies) { return uint8_t(plies); }
+	inline uint8_t lossIn(int plies) { return uint8_t(128 + plies); }
+	inline bool isWin(uint8_t v) { return v > 0 && v < 128; }
+	inline bool isLoss(uint8_t v) { return v >= 128; }
+	inline int pliesOf(uint8_t v) { return v >= 128 ? v - 128 : v; }
+
+	// rank: value -> int
+	// Orders the values from the side to move's point of view: the quicker the win the better,
+	// and the slower the loss the better.
+	inline int rank(uint8_t v) {
+		return isWin(v) ? 1000 - v : (isLoss(v) ? -1000 + pliesOf(v) : 0);
+	}
+
+	// afterMove: value -> value
+	// Converts the value of the position after a move into the value of the move for the
+	// side that made it.
+	inline uint8_t afterMove(uint8_t v) {
+		return isWin(v) ? lossIn(pliesOf(v) + 1) : (isLoss(v) ? winIn(pliesOf(v) + 1) : drawValue);
+	}
+
+	const char pieceLetters[] = "PNBRQK";
+
+	// The file layout: the header, the block offsets of both sides, and the blocks. A block
+	// holds the values of blockEntries consecutive positions as a series of chunks, each
+	// starting with a control byte c:
+	//		0 ... 127		a run of c + 1 equal values, given in the next byte
+	//		128 ... 255		c - 127 different values, given in the next bytes
+	const char fileMagic[4] = { 'C', 'L', 'T', 'B' };
+	const uint32_t fileVersion = 1;
+	const size_t nameLength = 16;
+	const size_t headerSize = 4 + 4 + nameLength + 8;
+	const uint64_t blockEntries = 256;
+	const std::string fileExtension = ".cltb";
+
+	uint64_t readLittleEndian(const unsigned char* p, int bytes) {
+		uint64_t value = 0;
+		for (int i = bytes - 1; i >= 0; i--)
+			value = (value << 8) | p[i];
+		return value;
+	}
+
+	void writeLittleEndian(std::ostream& out, uint64_t value, int bytes) {
+		for (int i = 0; i < bytes; i++) {
+			out.put(char(value & 0xFF));
+			value >>= 8;
+		}
+	}
+
+	struct TBPiece {
+		Color color;
+		PieceType type;
+		int sq;
+	};
+
+	// The king squares of the stronger side are limited by the symmetries of the board:
+	// to the a1-d1-d4 triangle without pawns, and to the files a-d with pawns.
+	struct KingSquares {
+		int index[2][64];		// [hasPawns][square], -1 if the square is not used.
+		int square[2][32];
+		int count[2];
+
+		KingSquares() {
+			count[0] = count[1] = 0;
+			for (int sq = 0; sq < 64; sq++) {
+				int f = fileOf(sq), r = rankOf(sq);
+				index[0][sq] = index[1][sq] = -1;
+				if (f < 4 && r <= f) {
+					square[0][count[0]] = sq;
+					index[0][sq] = count[0]++;
+				}
+				if (f < 4) {
+					square[1][count[1]] = sq;
+					index[1][sq] = count[1]++;
+				}
+			}
+		}
+	};
+
+	const KingSquares kingSquares;
+
+	// transform: square, symmetry -> square
+	// Applies one of the eight symmetries of the board: bit 2 mirrors the square in the
+	// a1-h8 diagonal, bit 0 flips the files and bit 1 flips the ranks.
+	inline int transform(int sq, int symmetry) {
+		if (symmetry & 4)
+			sq = ((sq & 7) << 3) | (sq >> 3);
+		if (symmetry & 1)
+			sq ^= 7;
+		if (symmetry & 2)
+			sq ^= 56;
+		return sq;
+	}
+
+	// materialName: pieces, count -> std::string
+	// Returns the name of the material, like "KRvKN", with the pieces from the strongest down.
+	std::string materialName(const TBPiece* pieces, int n) {
+		std::string side[2];
+		for (int c = White; c <= Black; c++)
+			for (int pt = KingType; pt >= PawnType; pt--)
+				for (int i = 0; i < n; i++)
+					if (pieces[i].color == c && pieces[i].type == pt)
+						side[c] += pieceLetters[pt];
+
+		return side[White] + "v" + side[Black];
+	}
+
+	// canonicalOrder: pieces, count -> void
+	// Sorts the pieces in the order of the table index: the white king, the black king,
+	// then the other white pieces from the strongest down, then the other black pieces.
+	void canonicalOrder(TBPiece* pieces, int n) {
+		auto order = [](const TBPiece& p) {
+			return p.type == KingType ? p.color : 2 + p.color * 8 + (KingType - p.type);
+		};
+		std::stable_sort(pieces, pieces + n, [&order](const TBPiece& a, const TBPiece& b) { return order(a) < order(b); });
+	}
+
+	// Table:
+	// The values of one material set for both sides to move, either held in memory
+	// right after generating them, or read from a mapped file.
+	class Table
+	{
+	public:
+		std::string name;
+		TBPiece pieces[maxTablebasePieces];		// In the canonical order; the squares are not used.
+		int pieceCount;
+		bool hasPawns;
+		uint64_t size;							// The positions per side to move.
+
+		std::vector<uint8_t> values[2];
+		std::vector<uint8_t> used[2];			// Whether a position can be probed, once generated.
+		MappedFile file;
+		uint64_t blockCount;
+
+		// parse: material name -> bool
+		// Sets up the pieces of the material named like "KQvKR". Returns false if the name is
+		// not a supported material set.
+		bool parse(const std::string& material) {
+			size_t v = material.find('v');
+			if (v == std::string::npos || material.size() > nameLength)
+				return false;
+
+			pieceCount = 0;
+			hasPawns = false;
+			int kings[2] = { 0, 0 };
+			for (size_t i = 0; i < material.size(); i++) {
+				if (i == v)
+					continue;
+				const char* letter = std::find(pieceLetters, pieceLetters + 6, material[i]);
+				if (letter == pieceLetters + 6 || pieceCount == maxTablebasePieces)
+					return false;
+
+				TBPiece& p = pieces[pieceCount++];
+				p.color = i < v ? White : Black;
+				p.type = PieceType(letter - pieceLetters);
+				p.sq = noSquare;
+				hasPawns |= p.type == PawnType;
+				kings[p.color] += p.type == KingType;
+			}
+
+			canonicalOrder(pieces, pieceCount);
+			name = materialName(pieces, pieceCount);
+			size = uint64_t(kingSquares.count[hasPawns]);
+			for (int i = 1; i < pieceCount; i++)
+				size *= 64;
+
+			return kings[White] == 1 && kings[Black] == 1 && name == material;
+		}
+
+		// index: squares -> uint64_t
+		// Returns the index of the position with the pieces on the given squares, in the
+		// canonical order. Of the symmetric positions, the one with the lowest index is used.
+		uint64_t index(const int* squares) const {
+			uint64_t best = UINT64_MAX;
+			int symmetries = hasPawns ? 2 : 8;
+
+			for (int s = 0; s < symmetries; s++) {
+				int k = kingSquares.index[hasPawns][transform(squares[0], s)];
+				if (k < 0)
+					continue;
+
+				uint64_t idx = uint64_t(k);
+				for (int i = 1; i < pieceCount; i++)
+					idx = idx * 64 + uint64_t(transform(squares[i], s));
+				best = (std::min)(best, idx);
+			}
+
+			return best;
+		}
+
+		// squaresOf: index, squares -> void
+		// The inverse of index, without the symmetries.
+		void squaresOf(uint64_t idx, int* squares) const {
+			for (int i = pieceCount - 1; i > 0; i--) {
+				squares[i] = int(idx % 64);
+				idx /= 64;
+			}
+			squares[0] = kingSquares.square[hasPawns][idx];
+		}
+
+		uint8_t value(Color stm, uint64_t idx) const {
+			if (!file.isOpen())
+				return values[stm][idx];
+
+			const unsigned char* offsets = file.bytes() + headerSize;
+			const unsigned char* blocks = offsets + 2 * (blockCount + 1) * 4;
+			uint64_t block = idx / blockEntries;
+			uint64_t within = idx % blockEntries;
+
+			const unsigned char* p = blocks + readLittleEndian(offsets + (stm * (blockCount + 1) + block) * 4, 4);
+			for (;;) {
+				uint64_t count = p[0] < 128 ? uint64_t(p[0]) + 1 : uint64_t(p[0]) - 127;
+				if (within < count)
+					return p[0] < 128 ? p[1] : p[1 + within];
+				within -= count;
+				p += p[0] < 128 ? 2 : 1 + count;
+			}
+		}
+
+		// open: file name -> bool
+		// Maps the table file, checking that it holds this material set.
+		bool open(const std::string& fileName) {
+			if (!file.open(fileName))
+				return false;
+
+			const unsigned char* h = file.bytes();
+			blockCount = (size + blockEntries - 1) / blockEntries;
+			bool valid = file.size() >= headerSize + 2 * (blockCount + 1) * 4 &&
+						 std::equal(fileMagic, fileMagic + 4, h) &&
+						 readLittleEndian(h + 4, 4) == fileVersion &&
+						 std::string(reinterpret_cast<const char*>(h + 8), name.size()) == name &&
+						 readLittleEndian(h + 8 + nameLength, 8) == size;
+			if (!valid)
+				file.close();
+			return valid;
+		}
+
+		// write: file name -> bool
+		// Writes the values held in memory into a table file.
+		bool write(const std::string& fileName) const {
+			std::vector<std::vector<unsigned char>> blocks;
+			std::vector<uint32_t> offsets;
+			uint64_t blocks64 = (size + blockEntries - 1) / blockEntries;
+			uint32_t offset = 0;
+
+			for (int stm = White; stm <= Black; stm++) {
+				for (uint64_t b = 0; b < blocks64; b++) {
+					// The positions that are never probed (the impossible ones and those stored
+					// under a symmetric index) take the value before them, to lengthen the runs:
+					uint64_t begin = b * blockEntries;
+					uint64_t end = (std::min)(size, begin + blockEntries);
+					std::vector<uint8_t> v(values[stm].begin() + begin, values[stm].begin() + end);
+					for (size_t i = 1; i < v.size(); i++)
+						if (!used[stm][begin + i])
+							v[i] = v[i - 1];
+
+					std::vector<unsigned char> block;
+					size_t literals = 0;		// One past the control byte of the open literal chunk, if any.
+					for (size_t i = 0; i < v.size(); ) {
+						size_t run = 1;
+						while (i + run < v.size() && run < 128 && v[i + run] == v[i])
+							run++;
+
+						if (run >= 3) {
+							block.push_back((unsigned char)(run - 1));
+							block.push_back(v[i]);
+							literals = 0;
+							i += run;
+						}
+						else {
+							if (literals == 0 || block[literals - 1] == 255) {
+								block.push_back(127);
+								literals = block.size();
+							}
+							block[literals - 1]++;
+							block.push_back(v[i]);
+							i++;
+						}
+					}
+					offsets.push_back(offset);
+					offset += uint32_t(block.size());
+					blocks.push_back(std::move(block));
+				}
+				offsets.push_back(offset);
+			}
+
+			std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+			out.write(fileMagic, 4);
+			writeLittleEndian(out, fileVersion, 4);
+			std::string paddedName = name;
+			paddedName.resize(nameLength, '\0');
+			out.write(paddedName.data(), std::streamsize(nameLength));
+			writeLittleEndian(out, size, 8);
+			for (uint32_t o : offsets)
+				writeLittleEndian(out, o, 4);
+			for (const std::vector<unsigned char>& block : blocks)
+				out.write(reinterpret_cast<const char*>(block.data()), std::streamsize(block.size()));
+
+			out.close();
+			return !out.fail();
+		}
+	};
+
+	// The loaded tables by material name:
+	std::map<std::string, std::unique_ptr<Table>> tables;
+	int largestTable = 0;
+
+	// lookup: pieces, count, side to move, value& -> bool
+	// Finds the value of the position with the given pieces from the tables, with the colors
+	// reversed if the table has the stronger side the other way round. Returns false if there
+	// is no table for the material.
+	bool lookup(TBPiece* pieces, int n, Color stm, uint8_t& value) {
+		// Two kings, or two kings and a single minor piece, cannot mate:
+		if (n == 2 || (n == 3 && std::any_of(pieces, pieces + n, [](const TBPiece& p) {
+				return p.type == KnightType || p.type == BishopType; }))) {
+			value = drawValue;
+			return true;
+		}
+
+		auto found = tables.find(materialName(pieces, n));
+		if (found == tables.end()) {
+			for (int i = 0; i < n; i++) {
+				pieces[i].color = ~pieces[i].color;
+				pieces[i].sq ^= 56;
+			}
+			stm = ~stm;
+			found = tables.find(materialName(pieces, n));
+			if (found == tables.end())
+				return false;
+		}
+
+		canonicalOrder(pieces, n);
+		int squares[maxTablebasePieces];
+		for (int i = 0; i < n; i++)
+			squares[i] = pieces[i].sq;
+
+		value = found->second->value(stm, found->second->index(squares));
+		return true;
+	}
+
+	// Generation:
+	// -----------------------------
+
+	// TBBoard is a position of a table being generated, with the pieces in the table's order:
+	struct TBBoard {
+		TBPiece pieces[maxTablebasePieces];
+		int n;
+		Bitboard occupied;
+		Bitboard byColor[2];
+
+		void update() {
+			occupied = byColor[White] = byColor[Black] = 0;
+			for (int i = 0; i < n; i++) {
+				occupied |= squareBB(pieces[i].sq);
+				byColor[pieces[i].color] |= squareBB(pieces[i].sq);
+			}
+		}
+
+		int kingOf(Color c) const {
+			for (int i = 0; i < n; i++)
+				if (pieces[i].color == c && pieces[i].type == KingType)
+					return pieces[i].sq;
+			return noSquare;
+		}
+
+		bool attacked(int sq, Color by) const {
+			for (int i = 0; i < n; i++) {
+				const TBPiece& p = pieces[i];
+				if (p.color != by)
+					continue;
+				Bitboard attacks = p.type == PawnType ? pawnAttacksBB[by][p.sq] : pieceAttacks(p.type, p.sq, occupied);
+				if (attacks & squareBB(sq))
+					return true;
+			}
+			return false;
+		}
+
+		bool inCheck(Color c) const { return attacked(kingOf(c), ~c); }
+	};
+
+	// forEachMove: const TBBoard&, side to move, function -> void
+	// Calls the function with the board after every legal move of the side to move, and
+	// with whether the move was a capture or a promotion, which leave the table.
+	template <typename F>
+	void forEachMove(const TBBoard& board, Color stm, F f) {
+		for (int i = 0; i < board.n; i++) {
+			const TBPiece& p = board.pieces[i];
+			if (p.color != stm)
+				continue;
+
+			Bitboard targets;
+			if (p.type == PawnType) {
+				int push = stm == White ? 8 : -8;
+				targets = pawnAttacksBB[stm][p.sq] & board.byColor[~stm];
+				if (!(board.occupied & squareBB(p.sq + push))) {
+					targets |= squareBB(p.sq + push);
+					int startRank = stm == White ? 1 : 6;
+					if (rankOf(p.sq) == startRank && !(board.occupied & squareBB(p.sq + 2 * push)))
+						targets |= squareBB(p.sq + 2 * push);
+				}
+			}
+			else
+				targets = pieceAttacks(p.type, p.sq, board.occupied) & ~board.byColor[stm];
+
+			while (targets) {
+				int to = popLsb(targets);
+				TBBoard next = board;
+				bool conversion = false;
+
+				for (int j = 0; j < next.n; j++)
+					if (next.pieces[j].sq == to) {
+						std::copy(next.pieces + j + 1, next.pieces + next.n, next.pieces + j);
+						next.n--;
+						conversion = true;
+						break;
+					}
+
+				// The captured piece was taken out, so the moving piece is found again by its square:
+				int moved = 0;
+				while (next.pieces[moved].sq != p.sq)
+					moved++;
+				next.pieces[moved].sq = to;
+				next.update();
+
+				if (next.inCheck(stm))
+					continue;
+
+				if (p.type == PawnType && (rankOf(to) == 0 || rankOf(to) == 7)) {
+					for (int pt = QueenType; pt >= KnightType; pt--) {
+						next.pieces[moved].type = PieceType(pt);
+						f(next, true);
+					}
+				}
+				else
+					f(next, conversion);
+			}
+		}
+	}
+
+	// forEachUnmove: const TBBoard&, side to move, function -> void
+	// Calls the function with the board before every move that the side not to move could
+	// have made into the position without capturing or promoting.
+	template <typename F>
+	void forEachUnmove(const TBBoard& board, Color stm, F f) {
+		Color moved = ~stm;
+
+		for (int i = 0; i < board.n; i++) {
+			const TBPiece& p = board.pieces[i];
+			if (p.color != moved)
+				continue;
+
+			Bitboard sources;
+			if (p.type == PawnType) {
+				int push = moved == White ? 8 : -8;
+				int from = p.sq - push;
+				sources = 0;
+				if (rankOf(from) != (moved == White ? 0 : 7) && !(board.occupied & squareBB(from))) {
+					sources |= squareBB(from);
+					int startRank = moved == White ? 1 : 6;
+					if (rankOf(from - push) == startRank && !(board.occupied & squareBB(from - push)))
+						sources |= squareBB(from - push);
+				}
+			}
+			else
+				sources = pieceAttacks(p.type, p.sq, board.occupied) & ~board.occupied;
+
+			while (sources) {
+				TBBoard prev = board;
+				prev.pieces[i].sq = popLsb(sources);
+				prev.update();
+
+				// The side to move could not have been left in check:
+				if (!prev.inCheck(stm))
+					f(prev);
+			}
+		}
+	}
+
+	// parallelFor: threads, count, function -> void
+	// Calls the function with the ranges [begin, end) that together cover [0, count),
+	// one range per thread.
+	template <typename F>
+	void parallelFor(int threads, uint64_t count, F f) {
+		std::vector<std::thread> workers;
+		uint64_t chunk = (count + uint64_t(threads) - 1) / uint64_t(threads);
+
+		for (int t = 0; t < threads; t++) {
+			uint64_t begin = (std::min)(count, uint64_t(t) * chunk);
+			uint64_t end = (std::min)(count, begin + chunk);
+			workers.emplace_back([begin, end, &f] { f(begin, end); });
+		}
+		for (std::thread& w : workers)
+			w.join();
+	}
+
+	// generate: Table&, threads, error message -> bool
+	// Solves all the positions of the table by retrograde analysis.
+	//
+	// First every position is set up and its moves counted. The moves that leave the table
+	// are valued right away from the smaller tables, and checkmates and stalemates are found.
+	// Then the positions solved at ply n - 1 are taken one ply further back: the positions
+	// that can move into a loss are wins at ply n, and a position all of whose moves have
+	// turned out to be wins for the opponent is lost at ply n. The positions never solved
+	// are draws.
+	bool generate(Table& table, int threads, std::string& errorMsg) {
+		uint64_t size = table.size;
+		std::unique_ptr<std::atomic<uint8_t>[]> values[2];
+		std::unique_ptr<std::atomic<uint8_t>[]> moveCounts[2];
+		std::vector<uint8_t> exitValues[2];			// The best of the moves leaving the table,
+		std::vector<uint8_t> hasExit[2];			// if there are any.
+		std::atomic<int> latestExit(0);			// The longest mate found through an exit.
+		std::atomic<bool> missingTable(false);
+
+		for (int stm = White; stm <= Black; stm++) {
+			values[stm].reset(new std::atomic<uint8_t>[size]());
+			moveCounts[stm].reset(new std::atomic<uint8_t>[size]());
+			exitValues[stm].assign(size, drawValue);
+			hasExit[stm].assign(size, 0);
+			table.used[stm].assign(size, 0);
+		}
+
+		// setUp: side to move, index, TBBoard& -> bool
+		// Sets up the position of the index. Returns false for the impossible positions and
+		// for the indices of positions stored under a symmetric index.
+		auto setUp = [&table](uint64_t idx, TBBoard& board) {
+			int squares[maxTablebasePieces];
+			table.squaresOf(idx, squares);
+
+			board.n = table.pieceCount;
+			for (int i = 0; i < board.n; i++) {
+				board.pieces[i] = table.pieces[i];
+				board.pieces[i].sq = squares[i];
+				if (board.pieces[i].type == PawnType && (rankOf(squares[i]) == 0 || rankOf(squares[i]) == 7))
+					return false;
+			}
+			board.update();
+
+			return popCount(board.occupied) == board.n && table.index(squares) == idx;
+		};
+
+		auto indexOf = [&table](const TBBoard& board) {
+			int squares[maxTablebasePieces];
+			for (int i = 0; i < board.n; i++)
+				squares[i] = board.pieces[i].sq;
+			return table.index(squares);
+		};
+
+		// 1. Count the moves within the table, and value the moves leaving it:
+		parallelFor(threads, 2 * size, [&](uint64_t begin, uint64_t end) {
+			for (uint64_t i = begin; i < end; i++) {
+				Color stm = Color(i / size);
+				uint64_t idx = i % size;
+				TBBoard board;
+				if (!setUp(idx, board) || board.inCheck(~stm))
+					continue;
+				table.used[stm][idx] = 1;
+
+				// Moves to symmetric positions lead to the same index and are counted once,
+				// just as they are found once when going backwards:
+				uint64_t successors[256];
+				int successorCount = 0;
+				bool anyMove = false;
+				uint8_t bestExit = drawValue;
+				bool exit = false;
+
+				forEachMove(board, stm, [&](TBBoard& next, bool conversion) {
+					anyMove = true;
+					if (conversion) {
+						TBPiece pieces[maxTablebasePieces];
+						std::copy(next.pieces, next.pieces + next.n, pieces);
+						uint8_t v;
+						if (!lookup(pieces, next.n, ~stm, v)) {
+							missingTable = true;
+							return;
+						}
+						v = afterMove(v);
+						if (!exit || rank(v) > rank(bestExit))
+							bestExit = v;
+						exit = true;
+					}
+					else {
+						uint64_t s = indexOf(next);
+						if (std::find(successors, successors + successorCount, s) == successors + successorCount)
+							successors[successorCount++] = s;
+					}
+				});
+
+				if (!anyMove)
+					values[stm][idx] = board.inCheck(stm) ? lossIn(0) : drawValue;
+				else if (successorCount == 0)
+					values[stm][idx] = bestExit;
+				else {
+					moveCounts[stm][idx] = uint8_t(successorCount);
+					exitValues[stm][idx] = bestExit;
+					hasExit[stm][idx] = exit;
+				}
+
+				// The plies of the values found through the exits come in later:
+				int latest = latestExit;
+				while (exit && pliesOf(bestExit) > latest && !latestExit.compare_exchange_weak(latest, pliesOf(bestExit)));
+			}
+		});
+
+		if (missingTable) {
+			errorMsg = "TABLEBASE ERROR: " + table.name + " needs the tables of the material its captures and promotions lead to.";
+			return false;
+		}
+
+		// 2. Go backwards from the positions solved at the previous ply:
+		for (int ply = 1; ; ply++) {
+			if (ply > maxPlies) {
+				errorMsg = "TABLEBASE ERROR: " + table.name + " has mates too long to be stored.";
+				return false;
+			}
+
+			std::atomic<bool> changed(false);
+			parallelFor(threads, 2 * size, [&](uint64_t begin, uint64_t end) {
+				for (uint64_t i = begin; i < end; i++) {
+					Color stm = Color(i / size);
+					uint64_t idx = i % size;
+					uint8_t v = values[stm][idx];
+
+					// A move leaving the table may win at this ply:
+					if (v == drawValue && hasExit[stm][idx] && exitValues[stm][idx] == winIn(ply)) {
+						uint8_t expected = drawValue;
+						if (values[stm][idx].compare_exchange_strong(expected, winIn(ply)))
+							changed = true;
+						continue;
+					}
+					if (v == drawValue || pliesOf(v) != ply - 1)
+						continue;
+
+					TBBoard board;
+					setUp(idx, board);
+					uint64_t predecessors[256];
+					int predecessorCount = 0;
+					forEachUnmove(board, stm, [&](const TBBoard& prev) {
+						uint64_t p = indexOf(prev);
+						if (std::find(predecessors, predecessors + predecessorCount, p) == predecessors + predecessorCount)
+							predecessors[predecessorCount++] = p;
+					});
+
+					Color prevStm = ~stm;
+					for (int k = 0; k < predecessorCount; k++) {
+						uint64_t p = predecessors[k];
+						if (values[prevStm][p] != drawValue)
+							continue;
+
+						uint8_t result;
+						if (isLoss(v))
+							result = winIn(ply);
+						else {
+							// The last move not yet known to lose has turned out to lose too:
+							if (moveCounts[prevStm][p].fetch_sub(1) != 1)
+								continue;
+							if (!hasExit[prevStm][p])
+								result = lossIn(ply);
+							else if (isLoss(exitValues[prevStm][p]))
+								result = lossIn((std::max)(ply, pliesOf(exitValues[prevStm][p])));
+							else
+								continue;
+						}
+
+						uint8_t expected = drawValue;
+						if (values[prevStm][p].compare_exchange_strong(expected, result))
+							changed = true;
+					}
+				}
+			});
+
+			if (!changed && ply > latestExit + 1)
+				break;
+		}
+
+		for (int stm = White; stm <= Black; stm++) {
+			table.values[stm].resize(size);
+			for (uint64_t i = 0; i < size; i++)
+				table.values[stm][i] = values[stm][i];
+		}
+
+		return true;
+	}
+}
+
+std::vector<std::string> defaultTablebaseSets() {
+	return {
+		"KQvK", "KRvK", "KPvK", "KBNvK", "KBBvK", "KNNvK",
+		"KQQvK", "KQRvK", "KQBvK", "KQNvK", "KRRvK", "KRBvK", "KRNvK",
+		"KQvKQ", "KQvKR", "KQvKB", "KQvKN", "KRvKR", "KRvKB", "KRvKN", "KBvKB", "KBvKN", "KNvKN"
+	};
+}
+
+bool generateTablebases(const std::string& directory, const std::vector<std::string>& sets, int threads,
+						std::function<void(const std::string&)> progress, std::string& errorMsg) {
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	threads = (std::max)(1, threads);
+
+	for (const std::string& material : sets) {
+		std::unique_ptr<Table> table(new Table);
+		if (!table->parse(material) || (table->hasPawns && material != "KPvK")) {
+			errorMsg = "TABLEBASE ERROR: unsupported material set " + material;
+			return false;
+		}
+
+		std::string fileName = (std::filesystem::path(directory) / (material + fileExtension)).string();
+		if (table->open(fileName)) {
+			if (progress)
+				progress(material + ": already generated");
+		}
+		else {
+			auto start = std::chrono::steady_clock::now();
+			if (!generate(*table, threads, errorMsg))
+				return false;
+			if (!table->write(fileName)) {
+				errorMsg = "TABLEBASE ERROR: could not write the file " + fileName;
+				return false;
+			}
+
+			if (progress) {
+				auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+				int longest = 0;
+				for (int stm = White; stm <= Black; stm++)
+					for (uint8_t v : table->values[stm])
+						longest = (std::max)(longest, pliesOf(v));
+				progress(material + ": " + std::to_string(2 * table->size) + " positions, longest mate " +
+						 std::to_string((longest + 1) / 2) + " moves, " + std::to_string(ms) + " ms, " +
+						 std::to_string(std::filesystem::file_size(fileName, ec) / 1024) + " KB");
+			}
+		}
+
+		largestTable = (std::max)(largestTable, table->pieceCount);
+		tables[material] = std::move(table);
+	}
+
+	return true;
+}
+
+int loadTablebases(const std::string& directory) {
+	int loaded = 0;
+	std::error_code ec;
+
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+		if (entry.path().extension() != fileExtension)
+			continue;
+
+		std::unique_ptr<Table> table(new Table);
+		std::string material = entry.path().stem().string();
+		if (!table->parse(material) || !table->open(entry.path().string()))
+			continue;
+
+		largestTable = (std::max)(largestTable, table->pieceCount);
+		tables[material] = std::move(table);
+		loaded++;
+	}
+
+	return loaded;
+}
+
+int tablebasePieces() {
+	return largestTable;
+}
+
+bool probeTablebase(const Position& pos, TBResult& result) {
+	Bitboard occupied = pos.pieces();
+	int n = popCount(occupied);
+	if (n > maxTablebasePieces || pos.castlingRights() != 0)
+		return false;
+
+	TBPiece pieces[maxTablebasePieces];
+	for (int i = 0; occupied; i++) {
+		int sq = popLsb(occupied);
+		pieces[i] = TBPiece{ Color(pos.pieceOn(sq) / 6), PieceType(pos.pieceOn(sq) % 6), sq };
+	}
+
+	uint8_t v;
+	if (!lookup(pieces, n, pos.sideToMove(), v))
+		return false;
+
+	result.wdl = isWin(v) ? 1 : (isLoss(v) ? -1 : 0);
+	result.dtm = pliesOf(v);
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "EngineDefinitions.h"
+
+class Position;
+
+// Endgame tablebases:
+// The exact value of every position of a small material set (like KQvK or KRvKN), with
+// the distance to mate, worked out beforehand by retrograde analysis: starting from the
+// checkmates, the positions are solved backwards one ply at a time.
+//
+// Each material set is stored in a file of its own (e.g. "KRvKN.cltb") and mapped into
+// memory when loaded. The positions are indexed directly, the symmetries of the board
+// being used to store only one of the equivalent positions, and the values are compressed
+// in blocks of run lengths, so that a probe reads at most one block.
+//
+// The tables assume that neither side can castle. The sets with pawns are limited to KPvK,
+// where en passant can never arise.
+
+// TBResult is the value of a tablebase position for the side to move:
+struct TBResult {
+	int wdl;		// 1 for a win, 0 for a draw, -1 for a loss.
+	int dtm;		// The plies to mate with the best play of both sides, 0 for a draw.
+};
+
+const int maxTablebasePieces = 4;
+
+// defaultTablebaseSets: void -> std::vector<std::string>
+// Returns the material sets generated by default, in the order they have to be generated
+// in: a set can only be generated once the sets its captures and promotions lead to exist.
+std::vector<std::string> defaultTablebaseSets();
+
+// generateTablebases: directory, material sets, thread count, progress report, error message -> bool
+// Generates the tables of the given material sets (named like "KQvKR", the stronger side
+// first) into the directory and loads them. Sets whose files already exist are loaded
+// instead of generated again. Returns false, with the reason in errorMsg, if a set is not
+// supported or a file cannot be written.
+bool generateTablebases(const std::string& directory, const std::vector<std::string>& sets, int threads,
+						std::function<void(const std::string&)> progress, std::string& errorMsg);
+
+// loadTablebases: directory -> int
+// Maps all the table files in the directory, replacing the tables of the same material
+// loaded before. Returns the number of tables loaded. Must not be called during a search.
+int loadTablebases(const std::string& directory);
+
+// tablebasePieces: void -> int
+// Returns the most pieces, kings included, of any loaded table, or 0 if none is loaded.
+int tablebasePieces();
+
+// probeTablebase: const Position&, TBResult& -> bool
+// Looks the position up in the tables. Returns false if there is no table for its material
+// or a side can still castle. Positions with only kings, or kings and a single minor
+// piece, are always found as draws.
+bool probeTablebase(const Position& pos, TBResult& result);
+
+// tablebaseScore: const TBResult&, ply -> int
+// Converts a tablebase result into a search score at the given distance from the root.
+inline int tablebaseScore(const TBResult& result, int ply) {
+	return result.wdl > 0 ? mateIn(ply + result.dtm) : (result.wdl < 0 ? matedIn(ply + result.dtm) : drawScore);
+}
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <chrono>
+#include "TimeManager.h"
+
+namespace {
+
+	// When the number of moves to the next time control is not known,
+	// the remaining time is spread over this many moves:
+	const int defaultMovesToGo = 30;
+	const int maxMovesToGo = 50;
+
+	// The hard budget may be this many times the soft budget:
+	const int hardToSoftRatio = 4;
+}
+
+TimePoint now() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TimeManager::TimeManager() {
+	startTime = now();
+	softBudget = hardBudget = 0;
+	timed = false;
+	moveOverhead = 30;
+}
+
+// init: const SearchLimits&, Color -> void
+// Allocates the time for a move of the given side.
+//
+// With a fixed move time both budgets equal the move time. With a game clock, the
+// remaining time is spread evenly over the moves to go, and most of the increment
+// is spent on top of that. The hard budget allows a difficult move to take several
+// times its share, but never more than half of the clock (or all of it, when only
+// one move is left before the time control).
+void TimeManager::init(const SearchLimits& limits, Color us) {
+	startTime = limits.startTime;
+	timed = false;
+
+	if (limits.moveTime > 0) {
+		softBudget = hardBudget = (std::max)(limits.moveTime - moveOverhead, TimePoint(1));
+		timed = true;
+	}
+	else if (limits.useTimeManagement()) {
+		int movesToGo = limits.movesToGo > 0 ? (std::min)(limits.movesToGo, maxMovesToGo) : defaultMovesToGo;
+		TimePoint usable = (std::max)(limits.time[us] - moveOverhead, TimePoint(1));
+		TimePoint cap = movesToGo == 1 ? usable : usable / 2;
+
+		TimePoint share = limits.time[us] / movesToGo + limits.inc[us] * 3 / 4;
+		softBudget = (std::max)((std::min)(share, cap), TimePoint(1));
+		hardBudget = (std::max)((std::min)(softBudget * hardToSoftRatio, cap), softBudget);
+		timed = true;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "EngineDefinitions.h"
+
+// TimePoint is a point in time, or a duration, in milliseconds.
+typedef int64_t TimePoint;
+
+// now: void -> TimePoint
+// Returns the current time of a monotonic clock, which never jumps
+// when the system time is adjusted.
+TimePoint now();
+
+// SearchLimits tells the search when to stop. A zero limit is not in use.
+// The search stops at whichever of the limits in use is reached first.
+// It also tells how many of the best moves are to be searched and reported.
+struct SearchLimits {
+	int depth;
+	uint64_t nodes;
+	TimePoint moveTime;			// A fixed time for the move.
+	TimePoint time[2];			// The time left on the clocks of White and Black,
+	TimePoint inc[2];			// and their increments per move.
+	int movesToGo;				// The moves until the next time control, or 0 if the rest of the game.
+	bool infinite;				// Search until stopped.
+	bool ponder;				// Search on the opponent's time until a ponderhit or a stop.
+	TimePoint startTime;		// When the search was requested. The clock runs from here.
+	int multiPV;				// The number of best moves to find, each with its own line.
+
+	SearchLimits() {
+		depth = maxPly - 1;
+		nodes = 0;
+		moveTime = 0;
+		time[White] = time[Black] = 0;
+		inc[White] = inc[Black] = 0;
+		movesToGo = 0;
+		infinite = ponder = false;
+		startTime = now();
+		multiPV = 1;
+	}
+
+	bool useTimeManagement() const { return time[White] != 0 || time[Black] != 0; }
+};
+
+// TimeManager:
+// Allocates the thinking time of one move.
+//
+// The soft budget is the time the search aims to use: no new iteration is started
+// once it has passed. The hard budget is never exceeded: the search is interrupted
+// in the middle of an iteration when it runs out.
+//
+// The clock can be restarted from another thread, which is how a ponder search is
+// turned into a normal search when the expected move is played.
+class TimeManager
+{
+private:
+	std::atomic<TimePoint> startTime;
+	TimePoint softBudget;
+	TimePoint hardBudget;
+	bool timed;
+
+public:
+	// The time lost per move in communication and process scheduling:
+	TimePoint moveOverhead;
+
+	TimeManager();
+	void init(const SearchLimits& limits, Color us);
+	void restart(TimePoint time) { startTime = time; }
+	TimePoint elapsed() const { return now() - startTime; }
+	bool isTimed() const { return timed; }
+	bool softLimitReached() const { return timed && elapsed() >= softBudget; }
+	bool hardLimitReached() const { return timed && elapsed() >= hardBudget; }
+	TimePoint soft() const { return softBudget; }
+	TimePoint hard() const { return hardBudget; }
+};
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable() {
+	currentGeneration = 0;
+	resize(16);
+}
+
+// resize: megabytes -> void
+// Resizes the table to the given size and clears it.
+void TranspositionTable::resize(size_t megabytes) {
+	size_t clusters = (std::max)(megabytes * 1024 * 1024 / sizeof(Cluster), size_t(1));
+	table.assign(clusters, Cluster());
+	clear();
+}
+
+// clear: void -> void
+// Empties the table.
+void TranspositionTable::clear() {
+	for (Cluster& c : table)
+		for (TTEntry& e : c.entries)
+			e = TTEntry{ 0, noMove, 0, 0, 0 };
+	currentGeneration = 0;
+}
+
+// newSearch: void -> void
+// Is called at the start of every search, so that the entries of the previous
+// searches can be told apart and replaced first.
+void TranspositionTable::newSearch() {
+	currentGeneration = (currentGeneration + 1) & 63;
+}
+
+// probe: Key, TTEntry& -> bool
+// Looks up the given key. If the position is found, copies its entry into
+// result and returns true.
+bool TranspositionTable::probe(Key key, TTEntry& result) {
+	Cluster& c = clusterFor(key);
+	uint16_t key16 = uint16_t(key);
+
+	for (TTEntry& e : c.entries)
+		if (e.key16 == key16 && e.genBound != 0) {
+			result = e;
+			return true;
+		}
+
+	return false;
+}
+
+// store: Key, score, Bound, depth, Move -> void
+// Stores a search result. An existing entry of the same position is overwritten,
+// keeping its move if no new move is given. Otherwise the least valuable entry of
+// the cluster is replaced.
+void TranspositionTable::store(Key key, int score, Bound bound, int depth, Move move) {
+	Cluster& c = clusterFor(key);
+	uint16_t key16 = uint16_t(key);
+	TTEntry* replace = &c.entries[0];
+
+	for (TTEntry& e : c.entries) {
+		if (e.key16 == key16 || e.genBound == 0) {
+			replace = &e;
+			break;
+		}
+
+		// Entries from older searches lose 8 plies of depth per generation:
+		int age = (currentGeneration - e.generation()) & 63;
+		int replaceAge = (currentGeneration - replace->generation()) & 63;
+		if (e.depth - 8 * age < replace->depth - 8 * replaceAge)
+			replace = &e;
+	}
+
+	if (move == noMove && replace->key16 == key16)
+		move = replace->move;
+
+	replace->key16 = key16;
+	replace->move = move;
+	replace->score = int16_t(score);
+	replace->depth = uint8_t((std::max)(depth, 0));
+	replace->genBound = uint8_t((currentGeneration << 2) | bound);
+}
+
+// hashfull: void -> int
+// Returns the permille of entries written during the current search,
+// estimated from the first thousand clusters.
+int TranspositionTable::hashfull() const {
+	size_t sample = (std::min)(table.size(), size_t(1000));
+	int used = 0;
+
+	for (size_t i = 0; i < sample; i++)
+		for (const TTEntry& e : table[i].entries)
+			if (e.genBound != 0 && e.generation() == currentGeneration)
+				used++;
+
+	return sample ? int(used * 1000 / (sample * clusterSize)) : 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "EngineDefinitions.h"
+
+// Bound tells how a stored score relates to the true score of the position:
+enum Bound { NoBound = 0, UpperBound = 1, LowerBound = 2, ExactBound = UpperBound | LowerBound };
+
+// TTEntry:
+// A transposition table entry. Only 16 bits of the position key are stored,
+// the rest being implied by the entry's place in the table.
+struct TTEntry {
+	uint16_t key16;
+	Move move;
+	int16_t score;
+	uint8_t depth;
+	uint8_t genBound;		// The table generation in the upper 6 bits, the Bound in the lower 2.
+
+	Bound bound() const { return Bound(genBound & 3); }
+	int generation() const { return genBound >> 2; }
+};
+
+// TranspositionTable:
+// A hash table of search results shared by all the search threads.
+//
+// The table consists of 32-byte clusters of four entries, so that a probe touches a single
+// cache line. When a cluster is full, the entry with the lowest depth, with entries from
+// older searches considered less valuable, is replaced.
+//
+// The threads access the table without locking. A torn entry can only produce a wrong
+// move or score hint, and moves read from the table are validated before use.
+class TranspositionTable
+{
+private:
+	static const int clusterSize = 4;
+
+	struct alignas(32) Cluster {
+		TTEntry entries[clusterSize];
+	};
+
+	std::vector<Cluster> table;
+	uint8_t currentGeneration;
+
+	// The upper half of the key selects the cluster, the lowest 16 bits are stored in the entry:
+	Cluster& clusterFor(Key key) { return table[size_t(((key >> 32) * uint64_t(table.size())) >> 32)]; }
+
+public:
+	TranspositionTable();
+	void resize(size_t megabytes);
+	void clear();
+	void newSearch();
+	bool probe(Key key, TTEntry& result);
+	void store(Key key, int score, Bound bound, int depth, Move move);
+	int hashfull() const;
+};
+
+// scoreToTT / scoreFromTT: score, ply -> score
+// Mate scores are stored relative to the position they were found in, rather than
+// relative to the root, so that they stay valid when the position is reached through
+// a different path.
+inline int scoreToTT(int score, int ply) {
+	return score >= mateBound ? score + ply : (score <= -mateBound ? score - ply : score);
+}
+
+inline int scoreFromTT(int score, int ply) {
+	return score >= mateBound ? score - ply : (score <= -mateBound ? score + ply : score);
+}
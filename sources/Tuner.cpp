@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "Tuner.h"
+#include "GameFiles.h"
+#include "Material.h"
+#include "MoveGen.h"
+#include "Position.h"
+#include "SEE.h"
+#include "Tablebase.h"
+#include "TimeManager.h"
+
+namespace {
+	// TuneFeature is one term of a position's evaluation: how many times more it counts for
+	// White than for Black.
+	struct TuneFeature {
+		uint16_t index;
+		int16_t count;
+	};
+
+	// TunePosition is one training position. Its features are features[first, first + size).
+	// The evaluation is mgFactor * (the mg sum of the features) + egFactor * (the eg sum),
+	// from White's point of view.
+	struct TunePosition {
+		uint32_t first;
+		uint16_t size;
+		float mgFactor;
+		float egFactor;
+		float result;				// 1, 0.5 or 0, from White's point of view.
+	};
+
+	// TuneData holds the training positions, with the features of all of them in one array:
+	struct TuneData {
+		std::vector<TunePosition> positions;
+		std::vector<TuneFeature> features;
+	};
+
+	// gameResult: const Position&, position keys, result -> bool
+	// Tells the result of a game from its final position, from White's point of view.
+	// Returns false if the game did not end in a way that can be told.
+	bool gameResult(const Position& pos, const std::vector<Key>& keys, float& result) {
+		if (MoveList(pos).size() == 0) {
+			result = !pos.inCheck() ? 0.5f : pos.sideToMove() == White ? 0.0f : 1.0f;
+			return true;
+		}
+		if (pos.halfmoveClock() >= 100 || insufficientMaterial(pos) || std::count(keys.begin(), keys.end(), pos.key()) >= 3) {
+			result = 0.5f;
+			return true;
+		}
+
+		TBResult tb;
+		if (popCount(pos.pieces()) <= tablebasePieces() && probeTablebase(pos, tb)) {
+			int wdl = pos.sideToMove() == White ? tb.wdl : -tb.wdl;
+			result = wdl > 0 ? 1.0f : wdl < 0 ? 0.0f : 0.5f;
+			return true;
+		}
+		return false;
+	}
+
+	// isQuiet: const Position& -> bool
+	// A position is quiet if its evaluation is not about to change by force: the side to
+	// move is not in check and has neither a winning capture nor a promotion.
+	bool isQuiet(const Position& pos) {
+		if (pos.inCheck())
+			return false;
+
+		for (const ScoredMove& sm : MoveList(pos)) {
+			if (moveKind(sm.move) == PromotionMove)
+				return false;
+			if (pos.isCapture(sm.move) && seeGE(pos, sm.move, 1))
+				return false;
+		}
+		return true;
+	}
+
+	// addPosition: const Position&, result, TuneData& -> void
+	// Traces the position into the data, unless it is one the evaluation knows to be drawn.
+	void addPosition(const Position& pos, float result, TuneData& data) {
+		EvalTrace trace;
+		if (!traceEvaluation(pos, trace))
+			return;
+
+		TunePosition tp;
+		tp.first = uint32_t(data.features.size());
+		tp.mgFactor = float(trace.phase) / maxPhase;
+		tp.egFactor = float(maxPhase - trace.phase) * trace.scale / (maxPhase * scaleNormal);
+		tp.result = result;
+
+		for (int i = 0; i < evalTermCount; i++)
+			if (trace.count[i] != 0)
+				data.features.push_back(TuneFeature{ uint16_t(i), int16_t(trace.count[i]) });
+
+		tp.size = uint16_t(data.features.size() - tp.first);
+		data.positions.push_back(tp);
+	}
+
+	// extractPositions: game files, const TuneOptions&, threads, TuneData&, TuneStats& -> void
+	// Replays the games, shared out among the threads, and collects their quiet positions.
+	void extractPositions(const std::vector<std::string>& files, const TuneOptions& options, int threadCount,
+						  TuneData& data, TuneStats& stats) {
+		std::atomic<size_t> nextFile(0);
+		std::mutex dataMutex;
+
+		auto work = [&] {
+			TuneData local;
+			TuneStats counts;
+			std::vector<Move> moves;
+			std::vector<Key> keys;
+
+			for (size_t f = nextFile++; f < files.size(); f = nextFile++) {
+				counts.games++;
+				if (!readSavedGame(files[f], moves)) {
+					counts.badGames++;
+					continue;
+				}
+
+				Position pos;
+				pos.setFromFEN(Position::startFEN);
+				keys.assign(1, pos.key());
+				for (Move m : moves) {
+					pos.makeMove(m);
+					keys.push_back(pos.key());
+				}
+
+				float result;
+				if (!gameResult(pos, keys, result)) {
+					counts.unknownResults++;
+					continue;
+				}
+
+				pos.setFromFEN(Position::startFEN);
+				for (int ply = 0; ply < int(moves.size()); ply++) {
+					if (ply >= options.skipPlies && isQuiet(pos))
+						addPosition(pos, result, local);
+					pos.makeMove(moves[ply]);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(dataMutex);
+			uint32_t offset = uint32_t(data.features.size());
+			for (TunePosition& tp : local.positions) {
+				tp.first += offset;
+				data.positions.push_back(tp);
+			}
+			data.features.insert(data.features.end(), local.features.begin(), local.features.end());
+			stats.games += counts.games;
+			stats.badGames += counts.badGames;
+			stats.unknownResults += counts.unknownResults;
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; t++)
+			threads.emplace_back(work);
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	// Tuner:
+	// Works out the loss and its gradient over the training positions with a pool of threads,
+	// each taking an equal slice of the positions. The weights are held as doubles, the mg
+	// value of term i at 2 * i and its eg value at 2 * i + 1.
+	class Tuner
+	{
+	private:
+		const TuneData& data;
+		int threadCount;
+
+		// sigmoid: K, eval -> double
+		// The expected score of White at the given evaluation.
+		static double sigmoid(double k, double eval) {
+			return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+		}
+
+		double evaluate(const TunePosition& tp, const std::vector<double>& w) const {
+			double mg = 0.0, eg = 0.0;
+			for (const TuneFeature* f = &data.features[tp.first], *end = f + tp.size; f < end; f++) {
+				mg += f->count * w[2 * f->index];
+				eg += f->count * w[2 * f->index + 1];
+			}
+			return tp.mgFactor * mg + tp.egFactor * eg;
+		}
+
+		// run: slice function -> void
+		// Calls the function with each thread's slice of the positions, [begin, end), and
+		// the thread's number.
+		template <typename Slice>
+		void run(Slice slice) const {
+			size_t count = data.positions.size();
+			std::vector<std::thread> threads;
+			for (int t = 0; t < threadCount; t++)
+				threads.emplace_back(slice, count * t / threadCount, count * (t + 1) / threadCount, t);
+			for (std::thread& t : threads)
+				t.join();
+		}
+
+	public:
+		Tuner(const TuneData& data, int threadCount) : data(data), threadCount(threadCount) {}
+
+		// loss: K, weights -> double
+		// The mean squared error of the expected scores.
+		double loss(double k, const std::vector<double>& w) const {
+			std::vector<double> sums(threadCount, 0.0);
+			run([&](size_t begin, size_t end, int t) {
+				for (size_t i = begin; i < end; i++) {
+					const TunePosition& tp = data.positions[i];
+					double error = tp.result - sigmoid(k, evaluate(tp, w));
+					sums[t] += error * error;
+				}
+			});
+
+			double sum = 0.0;
+			for (double s : sums)
+				sum += s;
+			return sum / data.positions.size();
+		}
+
+		// gradient: K, weights, gradient -> double
+		// Works out the gradient of the loss with respect to the weights and returns the loss.
+		double gradient(double k, const std::vector<double>& w, std::vector<double>& grad) const {
+			std::vector<std::vector<double>> grads(threadCount, std::vector<double>(w.size(), 0.0));
+			std::vector<double> sums(threadCount, 0.0);
+
+			run([&](size_t begin, size_t end, int t) {
+				std::vector<double>& g = grads[t];
+				for (size_t i = begin; i < end; i++) {
+					const TunePosition& tp = data.positions[i];
+					double s = sigmoid(k, evaluate(tp, w));
+					double error = tp.result - s;
+					sums[t] += error * error;
+
+					// d(error^2)/d(eval), before the division by the number of positions:
+					double d = -2.0 * error * s * (1.0 - s) * std::log(10.0) * k / 400.0;
+					double dMg = d * tp.mgFactor, dEg = d * tp.egFactor;
+					for (const TuneFeature* f = &data.features[tp.first], *fEnd = f + tp.size; f < fEnd; f++) {
+						g[2 * f->index] += dMg * f->count;
+						g[2 * f->index + 1] += dEg * f->count;
+					}
+				}
+			});
+
+			double sum = 0.0;
+			std::fill(grad.begin(), grad.end(), 0.0);
+			for (int t = 0; t < threadCount; t++) {
+				sum += sums[t];
+				for (size_t i = 0; i < grad.size(); i++)
+					grad[i] += grads[t][i] / data.positions.size();
+			}
+			return sum / data.positions.size();
+		}
+
+		// fitK: weights -> double
+		// Finds the K that minimizes the loss under the given weights, by narrowing down a
+		// scan of the range 0 to 10 to ever smaller steps.
+		double fitK(const std::vector<double>& w) const {
+			double best = 1.0, bestLoss = loss(best, w);
+			double low = 0.0, high = 10.0;
+
+			for (double step = 0.5; step >= 0.0005; step /= 10.0) {
+				for (double k = low + step; k <= high; k += step) {
+					double l = loss(k, w);
+					if (l < bestLoss) {
+						bestLoss = l;
+						best = k;
+					}
+				}
+				low = (std::max)(0.0, best - step);
+				high = best + step;
+			}
+			return best;
+		}
+	};
+}
+
+bool tuneEvaluation(const std::vector<std::string>& gameFiles, const TuneOptions& options, EvalWeights& weights,
+					TuneStats& stats, std::function<void(const std::string&)> report, std::string& errorMsg) {
+	int threadCount = options.threads > 0 ? options.threads : (std::max)(1, int(std::thread::hardware_concurrency()));
+	stats = TuneStats();
+
+	// The phase and the scale factors of the traces depend on the weights in use:
+	setEvalWeights(weights);
+
+	TuneData data;
+	TimePoint start = now();
+	extractPositions(savedGameFiles(gameFiles), options, threadCount, data, stats);
+	stats.positions = data.positions.size();
+	stats.features = data.features.size();
+	if (data.positions.empty()) {
+		errorMsg = "TUNE ERROR: no quiet positions with a known result found in the games";
+		return false;
+	}
+
+	std::ostringstream line;
+	line << stats.positions << " positions (" << stats.features << " features) extracted from " << stats.games
+		 << " games in " << now() - start << " ms";
+	report(line.str());
+
+	std::vector<double> w(2 * evalTermCount);
+	for (int i = 0; i < evalTermCount; i++) {
+		w[2 * i] = weights[i].mg;
+		w[2 * i + 1] = weights[i].eg;
+	}
+
+	Tuner tuner(data, threadCount);
+	stats.k = tuner.fitK(w);
+	stats.initialLoss = stats.finalLoss = tuner.loss(stats.k, w);
+	line.str("");
+	line.precision(6);
+	line << "K = " << stats.k << ", initial loss " << stats.initialLoss;
+	report(line.str());
+
+	// Adam, with the usual decay rates of the moment estimates:
+	const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+	std::vector<double> grad(w.size()), m(w.size(), 0.0), v(w.size(), 0.0);
+
+	for (int epoch = 1; epoch <= options.epochs; epoch++) {
+		auto epochStart = std::chrono::steady_clock::now();
+		stats.finalLoss = tuner.gradient(stats.k, w, grad);
+
+		double correction1 = 1.0 - std::pow(beta1, epoch), correction2 = 1.0 - std::pow(beta2, epoch);
+		for (size_t i = 0; i < w.size(); i++) {
+			m[i] = beta1 * m[i] + (1.0 - beta1) * grad[i];
+			v[i] = beta2 * v[i] + (1.0 - beta2) * grad[i] * grad[i];
+			w[i] -= options.learningRate * (m[i] / correction1) / (std::sqrt(v[i] / correction2) + epsilon);
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epochStart).count();
+		line.str("");
+		line << "Epoch " << epoch << ": loss " << stats.finalLoss << ", " << uint64_t(stats.positions / (std::max)(seconds, 1e-6)) << " positions/s";
+		report(line.str());
+	}
+	stats.finalLoss = tuner.loss(stats.k, w);
+
+	for (int i = 0; i < evalTermCount; i++)
+		weights[i] = EvalTerm{ int(std::lround(w[2 * i])), int(std::lround(w[2 * i + 1])) };
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Evaluation.h"
+
+// TuneOptions controls which positions of the games are trained on and how:
+struct TuneOptions {
+	int epochs;					// The passes of the optimizer over all the positions.
+	int threads;				// The threads extracting the positions and working out the gradients; 0 for one per core.
+	double learningRate;		// The Adam step size, in centipawns.
+	int skipPlies;				// The first plies of every game are left out.
+
+	TuneOptions() { epochs = 200; threads = 0; learningRate = 1.0; skipPlies = 8; }
+};
+
+// TuneStats reports what the tuning went through:
+struct TuneStats {
+	uint64_t games;				// The games read,
+	uint64_t badGames;			// of which this many had a move that could not be replayed,
+	uint64_t unknownResults;	// and this many ended without a result that could be told from the final position.
+	uint64_t positions;			// The quiet positions trained on,
+	uint64_t features;			// and their non-zero term counts.
+	double k;					// The scaling of the evaluation into an expected score.
+	double initialLoss;
+	double finalLoss;
+
+	TuneStats() { games = badGames = unknownResults = positions = features = 0; k = initialLoss = finalLoss = 0.0; }
+};
+
+// tuneEvaluation: game files, const TuneOptions&, EvalWeights&, TuneStats&, report, error message -> bool
+// Tunes the weights of the classical evaluation on the saved games (in the .clc format
+// written by GameManager::save; directories are searched for .clc files), starting from
+// the given weights and leaving the tuned ones in them.
+//
+// The result of a game is told from its final position: checkmate, stalemate, insufficient
+// material, the fifty-move rule, a threefold repetition, or a loaded tablebase. Games with
+// any other ending are left out. Of the rest, the positions after the first skipPlies plies
+// that are neither in check nor have a winning capture or a promotion are traced (see
+// traceEvaluation) into a sparse list of the term counts of each position, stored one after
+// another in a single array.
+//
+// The evaluation is linear in the weights once the game phase and the endgame scale are
+// fixed, which they are at their values under the starting weights. The tuner first finds
+// the scaling K with which 1 / (1 + 10^(-K * eval / 400)) best predicts the results, then
+// minimizes the mean squared error of that prediction with Adam, the gradients of each
+// epoch being summed over the positions by all the threads at once. Each epoch is reported
+// with its loss and the positions gone through per second.
+//
+// Returns false, with the reason in errorMsg, if no positions could be extracted.
+bool tuneEvaluation(const std::vector<std::string>& gameFiles, const TuneOptions& options, EvalWeights& weights,
+					TuneStats& stats, std::function<void(const std::string&)> report, std::string& errorMsg);
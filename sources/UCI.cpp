@@ -0,0 +1,298 @@
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include "UCI.h"
+#include "Bench.h"
+#include "Book.h"
+#include "Engine.h"
+#include "Evaluation.h"
+#include "MoveGen.h"
+#include "NNUE.h"
+#include "Position.h"
+#include "Tablebase.h"
+#include "CLIChessExceptions.h"
+
+namespace {
+
+	const int defaultHashMB = 16;
+	const int maxHashMB = 65536;
+	const int maxThreads = 256;
+	const int maxMultiPV = 64;
+
+	// The number of best moves to report, set with the MultiPV option:
+	int multiPV = 1;
+
+	// The opening book, and whether the engine plays its moves (the OwnBook option):
+	Book book;
+	bool ownBook = false;
+
+	// The search thread and the input thread both write to the standard output,
+	// one whole line at a time:
+	std::mutex outputMutex;
+
+	void send(const std::string& line) {
+		std::lock_guard<std::mutex> lock(outputMutex);
+		std::cout << line << std::endl;
+	}
+
+	// infoLine: const SearchResult&, index, Engine& -> std::string
+	// Returns the "info" line reporting one of the lines of a completed iteration.
+	// The line number is only given in the Multi-PV mode.
+	std::string infoLine(const SearchResult& result, size_t index, Engine& engine) {
+		uint64_t nodes = engine.nodes();
+		TimePoint elapsed = engine.elapsed();
+		const PVLine& line = result.lines[index];
+		std::ostringstream out;
+
+		out << "info depth " << result.depth;
+		if (multiPV > 1)
+			out << " multipv " << index + 1;
+		out << " score " << scoreToUCI(line.score)
+			<< " nodes " << nodes
+			<< " nps " << nodes * 1000 / uint64_t(elapsed > 0 ? elapsed : 1)
+			<< " time " << elapsed
+			<< " hashfull " << engine.table().hashfull();
+		if (tablebasePieces())
+			out << " tbhits " << result.tbHits;
+		out << " pv";
+		for (Move m : line.pv)
+			out << " " << moveToUCI(m);
+
+		return out.str();
+	}
+
+	// position: Position&, istringstream& -> void
+	// Handles "position startpos|fen <fen> [moves <move>...]".
+	// The position is left unchanged if the FEN is invalid. The moves are played
+	// up to the first illegal one.
+	void position(Position& pos, std::istringstream& is) {
+		std::string token, fen;
+		is >> token;
+
+		if (token == "startpos") {
+			fen = Position::startFEN;
+			is >> token;
+		}
+		else if (token == "fen") {
+			while (is >> token && token != "moves")
+				fen += token + " ";
+		}
+		else
+			return;
+
+		Position next;
+		try {
+			next.setFromFEN(fen);
+		}
+		catch (ParseException const& e) {
+			send("info string " + e.what());
+			return;
+		}
+
+		while (is >> token) {
+			Move m = moveFromUCI(next, token);
+			if (m == noMove) {
+				send("info string Illegal move: " + token);
+				break;
+			}
+			next.makeMove(m);
+		}
+
+		pos = next;
+	}
+
+	// go: Engine&, const Position&, istringstream& -> void
+	// Handles "go" with any of its limits and starts the search.
+	void go(Engine& engine, const Position& pos, std::istringstream& is) {
+		SearchLimits limits;
+		std::string token;
+
+		while (is >> token) {
+			if (token == "wtime")			is >> limits.time[White];
+			else if (token == "btime")		is >> limits.time[Black];
+			else if (token == "winc")		is >> limits.inc[White];
+			else if (token == "binc")		is >> limits.inc[Black];
+			else if (token == "movestogo")	is >> limits.movesToGo;
+			else if (token == "depth")		is >> limits.depth;
+			else if (token == "nodes")		is >> limits.nodes;
+			else if (token == "movetime")	is >> limits.moveTime;
+			else if (token == "infinite")	limits.infinite = true;
+			else if (token == "ponder")		limits.ponder = true;
+		}
+
+		limits.multiPV = multiPV;
+
+		// A book move is played at once, without searching:
+		if (ownBook && !limits.infinite && !limits.ponder) {
+			Move m = book.probe(pos);
+			if (m != noMove) {
+				send("bestmove " + moveToUCI(m));
+				return;
+			}
+		}
+
+		auto onIteration = [&engine](const SearchResult& result) {
+			for (size_t i = 0; i < result.lines.size(); i++)
+				send(infoLine(result, i, engine));
+		};
+		auto onBestMove = [](const SearchResult& result) {
+			std::string line = "bestmove " + moveToUCI(result.bestMove);
+			if (result.pv.size() > 1)
+				line += " ponder " + moveToUCI(result.pv[1]);
+			send(line);
+		};
+
+		engine.start(pos, limits, onIteration, onBestMove);
+	}
+
+	// setOption: Engine&, istringstream& -> void
+	// Handles "setoption name <name> [value <value>]".
+	void setOption(Engine& engine, std::istringstream& is) {
+		std::string token, name, value;
+		is >> token;
+
+		while (is >> token && token != "value")
+			name += (name.empty() ? "" : " ") + token;
+		while (is >> token)
+			value += (value.empty() ? "" : " ") + token;
+
+		if (name == "Hash") {
+			int mb = std::atoi(value.c_str());
+			engine.setHashSize(size_t(mb < 1 ? 1 : (mb > maxHashMB ? maxHashMB : mb)));
+		}
+		else if (name == "Threads") {
+			int threads = std::atoi(value.c_str());
+			engine.setThreads(threads > maxThreads ? maxThreads : threads);
+		}
+		else if (name == "MultiPV") {
+			int lines = std::atoi(value.c_str());
+			multiPV = lines < 1 ? 1 : (lines > maxMultiPV ? maxMultiPV : lines);
+		}
+		else if (name == "OwnBook")
+			ownBook = value == "true";
+		else if (name == "BookFile") {
+			if (value.empty() || value == "<empty>")
+				book.close();
+			else if (!book.open(value))
+				send("info string Could not open the book file: " + value);
+		}
+		else if (name == "SearchMode")
+			engine.setSearchMode(value == "MonteCarlo" ? SearchMode::MonteCarlo : SearchMode::AlphaBeta);
+		else if (name == "TablebasePath") {
+			if (!value.empty() && value != "<empty>")
+				send("info string " + std::to_string(loadTablebases(value)) + " tablebases loaded from " + value);
+		}
+		else if (name == "WeightsFile") {
+			std::string errorMsg;
+			if (value.empty() || value == "<empty>")
+				setEvalWeights(EvalWeights());
+			else if (!loadEvalWeights(value, errorMsg))
+				send("info string " + errorMsg);
+		}
+		else if (name == "EvalFile") {
+			if (value.empty() || value == "<empty>")
+				unloadNetwork();
+			else if (!loadNetwork(value))
+				send("info string Could not load the network file: " + value);
+		}
+		else if (name != "Ponder")
+			send("info string Unknown option: " + name);
+	}
+}
+
+std::string moveToUCI(Move m) {
+	if (m == noMove || m == nullMove)
+		return "0000";
+
+	std::string str;
+	str += char('a' + fileOf(moveFrom(m)));
+	str += char('1' + rankOf(moveFrom(m)));
+	str += char('a' + fileOf(moveTo(m)));
+	str += char('1' + rankOf(moveTo(m)));
+	if (moveKind(m) == PromotionMove)
+		str += "nbrq"[promotionType(m) - KnightType];
+
+	return str;
+}
+
+Move moveFromUCI(const Position& pos, const std::string& str) {
+	for (const ScoredMove& sm : MoveList(pos))
+		if (moveToUCI(sm.move) == str)
+			return sm.move;
+
+	return noMove;
+}
+
+std::string scoreToUCI(int score) {
+	if (score >= mateBound)
+		return "mate " + std::to_string((mateScore - score + 1) / 2);
+	if (score <= -mateBound)
+		return "mate " + std::to_string(-(mateScore + score) / 2);
+	return "cp " + std::to_string(score);
+}
+
+void uciLoop(const std::string& firstCommand) {
+	Engine engine;
+	Position pos;
+	std::string line = firstCommand, token;
+
+	do {
+		std::istringstream is(line);
+		token.clear();
+		is >> token;
+
+		if (token == "uci") {
+			send("id name CLIChess");
+			send("id author CLIChess authors");
+			send("option name Hash type spin default " + std::to_string(defaultHashMB) + " min 1 max " + std::to_string(maxHashMB));
+			send("option name Threads type spin default 1 min 1 max " + std::to_string(maxThreads));
+			send("option name Ponder type check default false");
+			send("option name MultiPV type spin default 1 min 1 max " + std::to_string(maxMultiPV));
+			send("option name OwnBook type check default false");
+			send("option name BookFile type string default <empty>");
+			send("option name TablebasePath type string default <empty>");
+			send("option name WeightsFile type string default <empty>");
+			send("option name EvalFile type string default <empty>");
+			send("option name SearchMode type combo default AlphaBeta var AlphaBeta var MonteCarlo");
+			send("uciok");
+		}
+		else if (token == "isready")
+			send("readyok");
+		else if (token == "ucinewgame") {
+			engine.stop();
+			engine.newGame();
+		}
+		else if (token == "position") {
+			engine.stop();
+			engine.wait();
+			position(pos, is);
+		}
+		else if (token == "go")
+			go(engine, pos, is);
+		else if (token == "stop")
+			engine.stop();
+		else if (token == "ponderhit")
+			engine.ponderhit();
+		else if (token == "setoption")
+			setOption(engine, is);
+		else if (token == "bench") {
+			// Not a UCI command, but handy for checking a build from a GUI's console:
+			int depth = defaultBenchDepth;
+			is >> depth;
+			engine.stop();
+			engine.wait();
+			BenchResult result = runBench(depth, defaultBenchHashMB, SearchOptions(), [](const std::string& line) { send("info string " + line); });
+			std::istringstream report(benchReport(result, SearchOptions()));
+			for (std::string reportLine; std::getline(report, reportLine); )
+				send("info string " + reportLine);
+		}
+		else if (token == "quit")
+			break;
+		else if (!token.empty())
+			send("info string Unknown command: " + token);
+	} while (std::getline(std::cin, line));
+
+	engine.stop();
+	engine.wait();
+}
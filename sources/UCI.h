@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include "EngineDefinitions.h"
+
+class Position;
+
+// uciLoop: first command -> void
+// Runs the engine in UCI (Universal Chess Interface) mode: reads the commands of a
+// chess GUI or a match runner from the standard input and answers on the standard
+// output until "quit" is received or the input ends. The first command, if any, has
+// already been read from the input by the caller.
+//
+// The commands are read on the calling thread while the search runs on its own
+// thread, so that "stop" and "ponderhit" are acted on immediately.
+void uciLoop(const std::string& firstCommand = "");
+
+// moveToUCI: Move -> std::string
+// Returns the move in long algebraic notation, e.g. "e2e4" or "e7e8q".
+std::string moveToUCI(Move m);
+
+// moveFromUCI: const Position&, const std::string& -> Move
+// Returns the legal move of the position given in long algebraic notation,
+// or noMove if there is no such move.
+Move moveFromUCI(const Position& pos, const std::string& str);
+
+// scoreToUCI: score -> std::string
+// Returns the score in UCI form: "cp <centipawns>" or "mate <moves>".
+std::string scoreToUCI(int score);
@@ -0,0 +1,71 @@
+#include "WorkStealingQueue.h"
+
+WorkStealingQueue::WorkStealingQueue(size_t count, int workers) {
+	if (workers < 1)
+		workers = 1;
+
+	for (int w = 0; w < workers; w++) {
+		blocks.emplace_back(new Block());
+		blocks.back()->begin = count * w / workers;
+		blocks.back()->end = count * (w + 1) / workers;
+	}
+}
+
+// Private methods:
+// -----------------------------
+
+// steal: worker -> bool
+// Moves the back half of the largest block of the other workers into the worker's own
+// block. Returns false if there was nothing left to steal.
+bool WorkStealingQueue::steal(int worker) {
+	while (true) {
+		// The sizes are only read here, so the victim may have shrunk by the time it is locked:
+		int victim = -1;
+		size_t largest = 0;
+		for (int w = 0; w < int(blocks.size()); w++) {
+			if (w == worker)
+				continue;
+			std::lock_guard<std::mutex> lock(blocks[w]->mutex);
+			if (blocks[w]->end - blocks[w]->begin > largest) {
+				largest = blocks[w]->end - blocks[w]->begin;
+				victim = w;
+			}
+		}
+		if (victim < 0)
+			return false;
+
+		size_t begin, end;
+		{
+			std::lock_guard<std::mutex> lock(blocks[victim]->mutex);
+			Block& b = *blocks[victim];
+			if (b.begin == b.end)
+				continue;
+			end = b.end;
+			b.end -= (b.end - b.begin + 1) / 2;
+			begin = b.end;
+		}
+
+		std::lock_guard<std::mutex> lock(blocks[worker]->mutex);
+		blocks[worker]->begin = begin;
+		blocks[worker]->end = end;
+		return true;
+	}
+}
+
+// Public methods:
+// -----------------------------
+
+// next: worker, job -> bool
+// Hands the worker its next job. Returns false once all the jobs have been handed out.
+bool WorkStealingQueue::next(int worker, size_t& job) {
+	do {
+		std::lock_guard<std::mutex> lock(blocks[worker]->mutex);
+		Block& b = *blocks[worker];
+		if (b.begin < b.end) {
+			job = b.begin++;
+			return true;
+		}
+	} while (steal(worker));
+
+	return false;
+}
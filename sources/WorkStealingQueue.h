@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// WorkStealingQueue:
+// Shares out the jobs 0 to count - 1 among a fixed number of workers.
+//
+// Every worker starts with a contiguous block of the jobs and takes them from the front
+// of its block. A worker whose block has run out steals the back half of the largest
+// block left, so that the workers finish together even when some jobs (like long games)
+// take much longer than others. Each block has a lock of its own, which is only contended
+// when a worker steals from it.
+class WorkStealingQueue
+{
+private:
+	struct Block {
+		std::mutex mutex;
+		size_t begin, end;
+	};
+
+	std::vector<std::unique_ptr<Block>> blocks;
+
+	bool steal(int worker);
+
+public:
+	WorkStealingQueue(size_t count, int workers);
+	bool next(int worker, size_t& job);
+};
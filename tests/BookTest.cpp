@@ -0,0 +1,106 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Book.h"
+#include "Notation.h"
+#include "Position.h"
+
+// BookTest checks that the opening books are compatible with Polyglot: the keys of known
+// positions, set up from FEN strings and reached by playing their moves, must be the ones
+// published with the Polyglot book format, and the book moves must be encoded like
+// Polyglot's. It returns 0 if all the checks pass.
+//
+// Built like the benchmark programs, from this file and the sources except CLIChess.cpp:
+//
+//   g++ -std=c++17 -O2 -Isources tests/BookTest.cpp <sources> -o booktest
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const std::string& what) {
+		if (!condition) {
+			std::cout << "FAILED: " << what << std::endl;
+			failures++;
+		}
+	}
+
+	// KnownKey is a position with its key as published with the Polyglot book format.
+	// The moves lead to it from the initial position.
+	struct KnownKey {
+		const char* moves;
+		const char* fen;
+		Key key;
+	};
+
+	const KnownKey knownKeys[] = {
+		{ "", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463B96181691FC9CULL },
+		{ "e4", "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823C9B50FD114196ULL },
+		{ "e4 d5", "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756B94461C50FB0ULL },
+		{ "e4 d5 e5", "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662FAFB965DB29D4ULL },
+		{ "e4 d5 e5 f5", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22A48B5A8E47FF78ULL },
+		{ "e4 d5 e5 f5 Ke2", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652A607CA3F242C1ULL },
+		{ "e4 d5 e5 f5 Ke2 Kf7", "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00FDD303C946BDD9ULL },
+		{ "a4 b5 h4 b4 c4", "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3C8123EA7B067637ULL },
+		{ "a4 b5 h4 b4 c4 bxc3 Ra3", "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5C3F9B829B279560ULL }
+	};
+
+	std::string hex(Key key) {
+		std::ostringstream out;
+		out << std::hex << key;
+		return out.str();
+	}
+
+	// testKnownKeys: void -> void
+	void testKnownKeys() {
+		for (const KnownKey& known : knownKeys) {
+			Position fromFEN;
+			fromFEN.setFromFEN(known.fen);
+			check(polyglotKey(fromFEN) == known.key,
+				  std::string("the key of ") + known.fen + " is " + hex(polyglotKey(fromFEN)) + ", not " + hex(known.key));
+
+			Position played;
+			std::istringstream moves(known.moves);
+			std::string san;
+			bool legal = true;
+			while (legal && moves >> san) {
+				Move m = moveFromSAN(played, san);
+				legal = m != noMove;
+				if (legal)
+					played.makeMove(m);
+			}
+			if (!legal) {
+				check(false, std::string("playing the moves \"") + known.moves + "\"");
+				continue;
+			}
+			check(polyglotKey(played) == known.key, std::string("the key after the moves \"") + known.moves + "\"");
+		}
+	}
+
+	// testMoveEncoding: void -> void
+	// Castling is written as the king capturing its own rook, and promotions carry the piece.
+	void testMoveEncoding() {
+		Position pos;
+		pos.setFromFEN("r3k2r/1P6/8/8/8/8/8/R3K2R w KQkq - 0 1");
+		const std::pair<const char*, uint16_t> moves[] = {
+			{ "O-O", uint16_t(7 | (4 << 6)) },					// e1h1
+			{ "O-O-O", uint16_t(0 | (4 << 6)) },				// e1a1
+			{ "bxa8=Q", uint16_t(56 | (49 << 6) | (4 << 12)) },	// b7a8q
+			{ "b8=N", uint16_t(57 | (49 << 6) | (1 << 12)) }	// b7b8n
+		};
+
+		for (const auto& m : moves) {
+			Move move = moveFromSAN(pos, m.first);
+			check(encodeBookMove(move) == m.second, std::string("the book move of ") + m.first);
+			check(decodeBookMove(pos, m.second) == move, std::string("decoding the book move of ") + m.first);
+		}
+	}
+}
+
+int main() {
+	testKnownKeys();
+	testMoveEncoding();
+
+	if (failures == 0)
+		std::cout << "All the book checks passed." << std::endl;
+	return failures == 0 ? 0 : 1;
+}
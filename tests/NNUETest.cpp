@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "MoveGen.h"
+#include "NNUE.h"
+#include "Position.h"
+
+// NNUETest checks the network evaluation against itself: a small network with random
+// weights is written into a file and loaded, and along random games, with captures,
+// castlings, en passant captures and promotions, the incrementally updated accumulator
+// of every position must equal the one computed from scratch, both after making and
+// after unmaking moves. It returns 0 if all the checks pass.
+//
+// Built like the benchmark programs, from this file and the sources except CLIChess.cpp:
+//
+//   g++ -std=c++17 -O2 -Isources tests/NNUETest.cpp <sources> -o nnuetest
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const std::string& what) {
+		if (!condition) {
+			std::cout << "FAILED: " << what << std::endl;
+			failures++;
+		}
+	}
+
+	// The positions the random games start from. They have castlings, en passant captures
+	// and promotions close at hand:
+	const char* startFENs[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"rnbqkb1r/pp1p1ppp/5n2/2pPp3/8/8/PPP1PPPP/RNBQKBNR w KQkq c6 0 4",
+		"8/2P3k1/8/8/8/8/5p2/2K5 w - - 0 1",
+		"r3k2r/1P4pp/8/8/8/8/1p4PP/R3K2R b KQkq - 0 1"
+	};
+
+	// writeNetwork: filename, seed -> bool
+	// Writes a network with small random weights in the format loadNetwork reads.
+	bool writeNetwork(const std::string& filename, uint64_t seed) {
+		std::mt19937_64 rng(seed);
+		std::uniform_int_distribution<int> small(-32, 32);
+		std::ofstream out(filename, std::ios::binary);
+
+		auto write = [&](const void* data, size_t size) { out.write(reinterpret_cast<const char*>(data), size); };
+		auto writeRandom16 = [&](size_t count) { for (size_t i = 0; i < count; i++) { int16_t v = int16_t(small(rng)); write(&v, 2); } };
+		auto writeRandom32 = [&](size_t count) { for (size_t i = 0; i < count; i++) { int32_t v = small(rng) * 64; write(&v, 4); } };
+		auto writeRandom8 = [&](size_t count) { for (size_t i = 0; i < count; i++) { int8_t v = int8_t(small(rng)); write(&v, 1); } };
+
+		const uint32_t header[5] = { 1, nnueInputs, nnueHidden, nnueL2, nnueL3 };
+		write("CLICNNUE", 8);
+		write(header, sizeof(header));
+		writeRandom16(nnueHidden);
+		writeRandom16(size_t(nnueInputs) * nnueHidden);
+		writeRandom32(nnueL2);
+		writeRandom8(size_t(nnueL2) * 2 * nnueHidden);
+		writeRandom32(nnueL3);
+		writeRandom8(size_t(nnueL3) * nnueL2);
+		writeRandom32(1);
+		writeRandom8(nnueL3);
+		return bool(out);
+	}
+
+	// matchesRefresh: Position& -> bool
+	// Evaluates the position, which updates its accumulator incrementally when it can,
+	// and compares the accumulator with one computed from scratch.
+	bool matchesRefresh(Position& pos) {
+		evaluateNNUE(pos);
+		Accumulator fresh;
+		refreshAccumulator(pos, fresh);
+		return std::memcmp(pos.accumulator(0).values, fresh.values, sizeof(fresh.values)) == 0;
+	}
+
+	// randomLegalMove: const Position&, rng -> Move
+	// Returns a random legal move, or noMove if there is none.
+	Move randomLegalMove(const Position& pos, std::mt19937_64& rng) {
+		MoveList moves(pos);
+		if (moves.size() == 0)
+			return noMove;
+		return moves.begin()[rng() % moves.size()].move;
+	}
+
+	// testRandomGames: void -> void
+	// Plays random games, evaluating after some moves only, so that the accumulator is
+	// updated over one or several moves or refreshed, and takes back a few moves now and then.
+	void testRandomGames() {
+		std::mt19937_64 rng(2024);
+
+		for (const char* fen : startFENs) {
+			for (int game = 0; game < 20; game++) {
+				Position pos;
+				pos.setFromFEN(fen);
+				std::vector<Move> played;
+				check(matchesRefresh(pos), std::string("the first accumulator of ") + fen);
+
+				for (int ply = 0; ply < 120; ply++) {
+					Move m = randomLegalMove(pos, rng);
+					if (m == noMove)
+						break;
+					pos.makeMove(m);
+					played.push_back(m);
+
+					if (rng() % 3 == 0)
+						continue;
+					check(matchesRefresh(pos), "an accumulator after a move from " + std::string(fen));
+
+					if (rng() % 8 == 0) {
+						for (int back = int(rng() % 4); back > 0 && !played.empty(); back--) {
+							pos.unmakeMove(played.back());
+							played.pop_back();
+						}
+						check(matchesRefresh(pos), "an accumulator after taking moves back from " + std::string(fen));
+					}
+				}
+			}
+		}
+	}
+
+	// testTakeBackRestoresEvaluation: void -> void
+	// After a line is played and taken back, the evaluation must be what it was at the start,
+	// and a copy of the position must evaluate to the same as the original.
+	void testTakeBackRestoresEvaluation() {
+		std::mt19937_64 rng(7);
+
+		for (const char* fen : startFENs) {
+			Position pos;
+			pos.setFromFEN(fen);
+			int before = evaluateNNUE(pos);
+			std::vector<Move> line;
+
+			for (int ply = 0; ply < 12; ply++) {
+				Move m = randomLegalMove(pos, rng);
+				if (m == noMove)
+					break;
+				pos.makeMove(m);
+				line.push_back(m);
+				evaluateNNUE(pos);
+			}
+
+			Position copy = pos;
+			check(evaluateNNUE(copy) == evaluateNNUE(pos), std::string("the evaluation of a copy from ") + fen);
+
+			for (size_t i = line.size(); i > 0; i--)
+				pos.unmakeMove(line[i - 1]);
+			check(evaluateNNUE(pos) == before, std::string("the evaluation after taking back a line from ") + fen);
+		}
+	}
+}
+
+int main() {
+	const std::string networkFile = "nnuetest.net";
+	const std::string badFile = "nnuetest_bad.net";
+
+	check(!networkLoaded(), "no network is loaded at the start");
+	check(!loadNetwork("nnuetest_missing.net"), "loading a missing file fails");
+
+	std::ofstream(badFile, std::ios::binary) << "NOTANNUE";
+	check(!loadNetwork(badFile), "loading a file of the wrong format fails");
+	check(!networkLoaded(), "a failed load loads nothing");
+
+	check(writeNetwork(networkFile, 1), "writing the network file");
+	check(loadNetwork(networkFile), "loading the network file");
+	check(networkLoaded(), "the network is loaded");
+
+	if (networkLoaded()) {
+		testRandomGames();
+		testTakeBackRestoresEvaluation();
+	}
+
+	unloadNetwork();
+	check(!networkLoaded(), "the network is unloaded");
+
+	std::remove(networkFile.c_str());
+	std::remove(badFile.c_str());
+
+	if (failures == 0)
+		std::cout << "All the NNUE checks passed." << std::endl;
+	return failures == 0 ? 0 : 1;
+}